@@ -0,0 +1,270 @@
+// Copyright 2016 AUV-IITK
+#include <ros/ros.h>
+#include <std_msgs/Float64.h>
+#include <hardware_arduino/ThrusterCommand.h>
+#include <hardware_arduino/DepthSample.h>
+#include <hardware_arduino/link_protocol.h>
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/sensor_board.h>
+#include <hardware_commons/trace.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <termios.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+// ROS side of src/link_node.cpp, stands in for serial_node.sh when that firmware is flashed
+
+int fd = -1;
+LinkFrameWriter writer;
+LinkFrameReader reader;
+uint8_t txSeq = 0;
+uint8_t rxSeq = 0;
+bool rxSeen = false;
+int rxFrames = 0, rxLost = 0;
+
+LinkConfig config;
+ros::Time nextConfig;
+const double configPeriod = 1;  // resent so a reset board picks it up again
+
+ros::Publisher depthPub, depthSamplePub, echoPub;
+double depthInterval = 0.1;
+ros::Time lastDepth;
+// every depth sample goes on the board, the topic is thinned to depth_rate
+hardware_commons::SensorBoard sensorBoard;
+
+// commands on their way to the arduino by the low byte of their seq, closed when the echo reports them applied
+struct SentCommand
+{
+  uint16_t seq;
+  hardware_commons::trace::Id trace;
+  int64_t at;
+};
+SentCommand sent[256];
+
+speed_t baudConstant(int baud)
+{
+  switch (baud)
+  {
+    case 57600:
+      return B57600;
+    case 115200:
+      return B115200;
+    case 230400:
+      return B230400;
+    case 460800:
+      return B460800;
+    case 500000:
+      return B500000;
+    case 1000000:
+      return B1000000;
+    default:
+      return B0;
+  }
+}
+
+bool openPort(const std::string &port, int baud)
+{
+  fd = open(port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0)
+    return false;
+  termios tty;
+  if (tcgetattr(fd, &tty) != 0)
+    return false;
+  cfmakeraw(&tty);
+  cfsetispeed(&tty, baudConstant(baud));
+  cfsetospeed(&tty, baudConstant(baud));
+  tty.c_cflag |= CLOCAL | CREAD;
+  tty.c_cc[VMIN] = 0;
+  tty.c_cc[VTIME] = 0;
+  if (tcsetattr(fd, TCSANOW, &tty) != 0)
+    return false;
+  tcflush(fd, TCIOFLUSH);
+  return true;
+}
+
+void writeFrame()
+{
+  uint8_t encoded[linkMaxEncoded];
+  uint8_t length = writer.finish(encoded);
+  if (write(fd, encoded, length) != length)
+    ROS_WARN_THROTTLE(1, "link_bridge: short write to the arduino");
+}
+
+bool addConfigIfDue(const ros::Time &now)
+{
+  if (now < nextConfig)
+    return false;
+  nextConfig = now + ros::Duration(configPeriod);
+  return writer.add(LINK_CONFIG, &config, sizeof(config));
+}
+
+// written out right away, with the config riding along when it is due
+void thrustersCb(hardware_arduino::ThrusterCommand msg)
+{
+  hardware_commons::trace::Span span("link", hardware_commons::trace::follow("/pwm/thrusters"));
+  LinkThrusters cmd;
+  cmd.seq = msg.seq;
+  for (int i = 0; i < THRUSTER_COUNT; i++)
+    cmd.pwm[i] = msg.pwm[i];
+
+  writer.begin(txSeq++, 0);
+  writer.add(LINK_THRUSTERS, &cmd, sizeof(cmd));
+  addConfigIfDue(ros::Time::now());
+  writeFrame();
+
+  SentCommand &command = sent[msg.seq & 0xff];
+  command.seq = msg.seq;
+  command.trace = hardware_commons::trace::current();
+  command.at = hardware_commons::SensorBoard::now();
+}
+
+void handleFrame(const ros::Time &received)
+{
+  const LinkHeader &header = reader.header();
+  if (rxSeen)
+    rxLost += static_cast<uint8_t>(header.seq - rxSeq - 1);
+  rxSeen = true;
+  rxSeq = header.seq;
+  rxFrames++;
+
+  uint8_t type, length;
+  const uint8_t *payload;
+  while (reader.next(type, payload, length))
+  {
+    if (type == LINK_DEPTH && length == sizeof(LinkDepth))
+    {
+      LinkDepth depth;
+      memcpy(&depth, payload, sizeof(depth));
+      hardware_arduino::DepthSample sample;
+      // age of the sample on the arduino clock, the link delay itself is not accounted for
+      sample.stamp = received - ros::Duration((header.micros - depth.sampleMicros) * 1e-6);
+      sample.depth = depth.depth;
+      sample.depth_rate = depth.depthRate;
+      sample.temperature = depth.temperature;
+      depthSamplePub.publish(sample);
+      // the depth in the units of the legacy topic and its filtered rate per second, the D term of the upward server
+      double legacyDepth = depth.depth * 100;
+      double board[2] = { legacyDepth, depth.depthRate * 100 };
+      sensorBoard.write(hardware_commons::DEPTH, board, 2,
+                        hardware_commons::SensorBoard::now() - (header.micros - depth.sampleMicros) * 1000LL);
+
+      if ((received - lastDepth).toSec() >= depthInterval)
+      {
+        lastDepth = received;
+        std_msgs::Float64 legacy;
+        legacy.data = legacyDepth;
+        depthPub.publish(legacy);
+      }
+    }
+    else if (type == LINK_THRUSTER_ECHO && length == sizeof(LinkThrusters))
+    {
+      LinkThrusters applied;
+      memcpy(&applied, payload, sizeof(applied));
+      // the last hop of a frame: from the command going out until the arduino says it drives the thrusters with it
+      const SentCommand &command = sent[applied.seq & 0xff];
+      if (command.at && command.seq == applied.seq)
+        hardware_commons::trace::record("applied", command.trace, command.at, hardware_commons::SensorBoard::now());
+      hardware_arduino::ThrusterCommand echo;
+      echo.seq = applied.seq;
+      for (int i = 0; i < THRUSTER_COUNT; i++)
+        echo.pwm[i] = applied.pwm[i];
+      echoPub.publish(echo);
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "link_bridge");
+  ros::NodeHandle nh;
+  std::string port = "/dev/arduino";
+  int baud = linkBaud, depth_rate = 10, telemetry_rate = 50, depth_osr = 1024, temperature_interval = 10,
+      command_timeout = 500;
+  std::vector<double> gains;
+  nh.getParam("link_bridge/port", port);
+  nh.getParam("link_bridge/baud", baud);
+  nh.getParam("link_bridge/depth_rate", depth_rate);
+  nh.getParam("link_bridge/telemetry_rate", telemetry_rate);
+  nh.getParam("link_bridge/depth_osr", depth_osr);
+  nh.getParam("link_bridge/temperature_interval", temperature_interval);
+  nh.getParam("link_bridge/command_timeout", command_timeout);
+  nh.getParam("link_bridge/depth_filter_gains", gains);
+
+  // the rates become periods in whole ms on the arduino, which it keeps in 16 bits
+  if (telemetry_rate <= 0 || telemetry_rate > 1000 || depth_rate <= 0)
+  {
+    ROS_ERROR("link_bridge: telemetry_rate has to be 1 to 1000 Hz and depth_rate above 0, not %d and %d",
+              telemetry_rate, depth_rate);
+    return 1;
+  }
+  if (command_timeout < 0 || command_timeout > UINT16_MAX || temperature_interval < 1 || temperature_interval > 255)
+  {
+    ROS_ERROR("link_bridge: command_timeout has to be 0 to %d ms and temperature_interval 1 to 255, not %d and %d",
+              UINT16_MAX, command_timeout, temperature_interval);
+    return 1;
+  }
+
+  // same mapping of the datasheet ratio as arduino_node.cpp
+  config.depthOsr = 0;
+  while (config.depthOsr < 5 && (256 << config.depthOsr) < depth_osr)
+    config.depthOsr++;
+  config.temperatureInterval = temperature_interval;
+  config.telemetryInterval = 1000 / telemetry_rate;
+  config.commandTimeout = command_timeout;
+  config.filterAlpha = gains.size() == 2 ? gains[0] : 0.2;
+  config.filterBeta = gains.size() == 2 ? gains[1] : 0.005;
+  depthInterval = 1.0 / depth_rate;
+
+  if (baudConstant(baud) == B0 || !openPort(port, baud))
+  {
+    ROS_ERROR("link_bridge: cannot open %s at %d baud", port.c_str(), baud);
+    return 1;
+  }
+  if (!sensorBoard.open())
+    ROS_WARN("link_bridge: %s, depth only goes out on the topics", sensorBoard.error().c_str());
+
+  ros::Subscriber subThrusters = hardware_commons::subscribe<hardware_arduino::ThrusterCommand>(
+      nh, "/pwm/thrusters", hardware_commons::LATEST, &thrustersCb, ros::TransportHints().tcpNoDelay());
+  depthPub = hardware_commons::advertise<std_msgs::Float64>(nh, "/varun/sensors/pressure_sensor/depth",
+                                                            hardware_commons::LATEST);
+  // every sample and every echo is wanted by whoever records them, not only the newest
+  depthSamplePub = hardware_commons::advertise<hardware_arduino::DepthSample>(
+      nh, "/varun/sensors/pressure_sensor/depth_sample", hardware_commons::EVENTS);
+  echoPub = hardware_commons::advertise<hardware_arduino::ThrusterCommand>(nh, "/pwm/thrusters_echo",
+                                                                           hardware_commons::EVENTS);
+
+  pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  uint8_t buffer[256];
+  while (ros::ok())
+  {
+    ros::spinOnce();
+
+    // commands normally carry the config, this only covers the time no one is commanding
+    ros::Time now = ros::Time::now();
+    if (now >= nextConfig + ros::Duration(0.1))
+    {
+      writer.begin(txSeq++, 0);
+      addConfigIfDue(now);
+      writeFrame();
+    }
+
+    // short timeout so a thruster command never waits long for the serial read
+    if (poll(&pfd, 1, 2) <= 0)
+      continue;
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    ros::Time received = ros::Time::now();
+    for (ssize_t i = 0; i < n; i++)
+    {
+      if (reader.push(buffer[i]))
+        handleFrame(received);
+    }
+    ROS_INFO_THROTTLE(10, "link_bridge: %d frames received, %d lost, %d bad", rxFrames, rxLost, reader.errors());
+  }
+  close(fd);
+  return 0;
+}
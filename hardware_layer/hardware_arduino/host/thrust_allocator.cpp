@@ -0,0 +1,162 @@
+// Copyright 2016 AUV-IITK
+#include <hardware_arduino/thrust_allocator.h>
+#include <math.h>
+
+namespace
+{
+const int axes = ThrustAllocator::AXIS_COUNT;
+
+// output the firmware writes for a command, same steps as the btd0xx functions in arduino_node.cpp
+float linearizedOutput(const ThrusterCurve &curve, int pwm)
+{
+  int normalized = pwm * curve.span / 255 + normalizeOffset;
+  if (normalized <= normalizeOffset)
+    return 0;
+  return (c099 + s099 * normalized - curve.c) / curve.s;
+}
+
+// Gauss-Jordan elimination with partial pivoting, m is destroyed
+void invert(float m[axes][axes], float inv[axes][axes])
+{
+  for (int i = 0; i < axes; i++)
+    for (int j = 0; j < axes; j++)
+      inv[i][j] = (i == j) ? 1 : 0;
+
+  for (int col = 0; col < axes; col++)
+  {
+    int pivot = col;
+    for (int row = col + 1; row < axes; row++)
+      if (fabs(m[row][col]) > fabs(m[pivot][col]))
+        pivot = row;
+    for (int j = 0; j < axes; j++)
+    {
+      float temp = m[col][j];
+      m[col][j] = m[pivot][j];
+      m[pivot][j] = temp;
+      temp = inv[col][j];
+      inv[col][j] = inv[pivot][j];
+      inv[pivot][j] = temp;
+    }
+
+    float diag = m[col][col];
+    for (int j = 0; j < axes; j++)
+    {
+      m[col][j] /= diag;
+      inv[col][j] /= diag;
+    }
+    for (int row = 0; row < axes; row++)
+    {
+      if (row == col)
+        continue;
+      float factor = m[row][col];
+      for (int j = 0; j < axes; j++)
+      {
+        m[row][j] -= factor * m[col][j];
+        inv[row][j] -= factor * inv[col][j];
+      }
+    }
+  }
+}
+}  // namespace
+
+ThrustAllocator::ThrustAllocator(float eastWestArm, float swayArm)
+{
+  // effect of every thruster on every axis, scaled so a demand of n on an axis is pwm n on the pair driving it; yaw
+  // is driven by two pairs and gets n/2 on each
+  float config[AXIS_COUNT][THRUSTER_COUNT] = {};
+  config[AXIS_SURGE][THRUSTER_EAST] = 0.5;
+  config[AXIS_SURGE][THRUSTER_WEST] = 0.5;
+  config[AXIS_SWAY][THRUSTER_NORTH_SWAY] = 0.5;
+  config[AXIS_SWAY][THRUSTER_SOUTH_SWAY] = 0.5;
+  config[AXIS_HEAVE][THRUSTER_NORTH_UP] = 0.5;
+  config[AXIS_HEAVE][THRUSTER_SOUTH_UP] = 0.5;
+  // positive yaw pushes east forward, west backward, north sway left and south sway right
+  config[AXIS_YAW][THRUSTER_EAST] = 0.5 * eastWestArm;
+  config[AXIS_YAW][THRUSTER_WEST] = -0.5 * eastWestArm;
+  config[AXIS_YAW][THRUSTER_NORTH_SWAY] = -0.5 * swayArm;
+  config[AXIS_YAW][THRUSTER_SOUTH_SWAY] = 0.5 * swayArm;
+
+  // allocation = config^T * (config * config^T)^-1, the least effort thrust giving the wrench
+  float gram[AXIS_COUNT][AXIS_COUNT];
+  float inverse[AXIS_COUNT][AXIS_COUNT];
+  for (int i = 0; i < AXIS_COUNT; i++)
+  {
+    for (int j = 0; j < AXIS_COUNT; j++)
+    {
+      gram[i][j] = 0;
+      for (int k = 0; k < THRUSTER_COUNT; k++)
+        gram[i][j] += config[i][k] * config[j][k];
+    }
+  }
+  for (int i = 0; i < AXIS_COUNT; i++)
+  {
+    // no thruster acts on this axis (zero arm), its allocation column comes out as zero
+    if (gram[i][i] < 1e-6)
+      gram[i][i] = 1;
+  }
+  invert(gram, inverse);
+  for (int k = 0; k < THRUSTER_COUNT; k++)
+  {
+    for (int j = 0; j < AXIS_COUNT; j++)
+    {
+      allocation_[k][j] = 0;
+      for (int i = 0; i < AXIS_COUNT; i++)
+        allocation_[k][j] += config[i][k] * inverse[i][j];
+    }
+  }
+
+  for (int k = 0; k < THRUSTER_COUNT; k++)
+  {
+    limit_[k] = thrusterMaxPWM;
+    while (limit_[k] > 0 && linearizedOutput(thrusterCurves[k], limit_[k]) > thrusterMaxPWM)
+      limit_[k]--;
+  }
+
+  for (int k = 0; k < THRUSTER_COUNT; k++)
+    group_[k] = k;
+  for (int i = 0; i < AXIS_COUNT; i++)
+  {
+    int first = -1;
+    for (int k = 0; k < THRUSTER_COUNT; k++)
+    {
+      if (config[i][k] == 0)
+        continue;
+      if (first < 0)
+      {
+        first = k;
+        continue;
+      }
+      int merged = group_[k];
+      for (int m = 0; m < THRUSTER_COUNT; m++)
+        if (group_[m] == merged)
+          group_[m] = group_[first];
+    }
+  }
+}
+
+void ThrustAllocator::allocate(const float wrench[AXIS_COUNT], int out[THRUSTER_COUNT]) const
+{
+  float thrust[THRUSTER_COUNT];
+  float scale[THRUSTER_COUNT];
+  for (int k = 0; k < THRUSTER_COUNT; k++)
+  {
+    thrust[k] = 0;
+    for (int j = 0; j < AXIS_COUNT; j++)
+      thrust[k] += allocation_[k][j] * wrench[j];
+    scale[k] = 1;
+  }
+
+  // shrink a whole group until its most loaded thruster is within limits
+  for (int k = 0; k < THRUSTER_COUNT; k++)
+  {
+    if (fabs(thrust[k]) <= limit_[k])
+      continue;
+    float s = limit_[k] / fabs(thrust[k]);
+    for (int m = 0; m < THRUSTER_COUNT; m++)
+      if (group_[m] == group_[k] && s < scale[m])
+        scale[m] = s;
+  }
+
+  for (int k = 0; k < THRUSTER_COUNT; k++)
+    out[k] = static_cast<int>(thrust[k] * scale[k]);
+}
@@ -0,0 +1,149 @@
+// Copyright 2016 AUV-IITK
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <std_msgs/Int32.h>
+#include <std_msgs/String.h>
+#include <hardware_arduino/ThrusterCommand.h>
+#include <hardware_arduino/thrusters.h>
+#include <hardware_arduino/thrust_allocator.h>
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/trace.h>
+#include <pthread.h>
+#include <string.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// the /pwm topic of every axis, in the order of ThrustAllocator::Axis
+const char *const axisNames[ThrustAllocator::AXIS_COUNT] = { "forward", "sideward", "upward", "turn" };
+
+// latest output of every motion server, mixed into one ThrusterCommand per control tick
+int axisPWM[ThrustAllocator::AXIS_COUNT] = {};
+// trace of the axis that changed last, the ticks after it carry its command to the thrusters
+hardware_commons::trace::Id latestTrace = 0;
+// an axis stopped by a preempt ignores its topic until the motion server's 0 comes in there too, or for stopHold at
+// most: a pwm that was already on its way when the stop overtook it must not start the thruster again
+ros::WallTime heldUntil[ThrustAllocator::AXIS_COUNT];
+ros::WallDuration stopHold(0.2);
+
+// the tick and the stop thread both mix and send, one at a time
+std::mutex mixMutex;
+ThrustAllocator *allocator;
+ros::Publisher thrusters;
+hardware_arduino::ThrusterCommand cmd;
+
+void axisCb(int axis, const std_msgs::Int32ConstPtr &msg)
+{
+  std::lock_guard<std::mutex> lock(mixMutex);
+  if (!heldUntil[axis].isZero())
+  {
+    if (msg->data != 0 && ros::WallTime::now() < heldUntil[axis])
+      return;
+    heldUntil[axis] = ros::WallTime();
+  }
+  axisPWM[axis] = msg->data;
+  latestTrace = hardware_commons::trace::follow(std::string("/pwm/") + axisNames[axis]);
+}
+
+void mix()
+{
+  float wrench[ThrustAllocator::AXIS_COUNT];
+  for (int i = 0; i < ThrustAllocator::AXIS_COUNT; i++)
+    wrench[i] = axisPWM[i];
+
+  int out[THRUSTER_COUNT];
+  allocator->allocate(wrench, out);
+  for (int i = 0; i < THRUSTER_COUNT; i++)
+    cmd.pwm[i] = out[i];
+}
+
+// mixes and sends with the calling thread's trace, the caller holds mixMutex
+void send()
+{
+  mix();
+  hardware_commons::trace::publish(thrusters, cmd);
+  cmd.seq++;
+}
+
+// a preempted motion server: zero its axis and send right away, the tick may be up to 1/rate away
+void stopCb(const std_msgs::StringConstPtr &msg)
+{
+  hardware_commons::trace::Span span("stop", hardware_commons::trace::follow("/pwm/stop"));
+  std::lock_guard<std::mutex> lock(mixMutex);
+  for (int i = 0; i < ThrustAllocator::AXIS_COUNT; i++)
+  {
+    if (msg->data != axisNames[i])
+      continue;
+    axisPWM[i] = 0;
+    heldUntil[i] = ros::WallTime::now() + stopHold;
+    send();
+    return;
+  }
+  ROS_WARN("thruster_mixer: stop for unknown axis %s", msg->data.c_str());
+}
+
+// serves /pwm/stop and nothing else, so a stop never queues behind the axis topics or waits for the tick
+void stopLoop(ros::CallbackQueue *queue)
+{
+  while (ros::ok())
+    queue->callAvailable(ros::WallDuration(0.1));
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "thruster_mixer");
+  ros::NodeHandle nh;
+  double rate = 50, east_west_arm = 1, sway_arm = 1;
+  nh.getParam("thruster_mixer/rate", rate);
+  nh.getParam("thruster_mixer/east_west_arm", east_west_arm);
+  nh.getParam("thruster_mixer/sway_arm", sway_arm);
+
+  int stop_priority = 0;
+  double stop_hold = stopHold.toSec();
+  nh.getParam("thruster_mixer/stop_priority", stop_priority);
+  nh.getParam("thruster_mixer/stop_hold", stop_hold);
+  stopHold = ros::WallDuration(stop_hold);
+
+  allocator = new ThrustAllocator(east_west_arm, sway_arm);
+  for (int i = 0; i < THRUSTER_COUNT; i++)
+    ROS_INFO("thruster %d limited to pwm %d", i, allocator->limit(i));
+
+  // only the newest pwm of every axis matters, older ones are overwritten before the next tick anyway
+  std::vector<ros::Subscriber> axes;
+  for (int i = 0; i < ThrustAllocator::AXIS_COUNT; i++)
+    axes.push_back(hardware_commons::subscribe<std_msgs::Int32>(nh, std::string("/pwm/") + axisNames[i],
+                                                                hardware_commons::LATEST, boost::bind(&axisCb, i, _1)));
+  thrusters = hardware_commons::advertise<hardware_arduino::ThrusterCommand>(nh, "/pwm/thrusters",
+                                                                             hardware_commons::LATEST);
+
+  ros::CallbackQueue stopQueue;
+  ros::NodeHandle stopNh;
+  stopNh.setCallbackQueue(&stopQueue);
+  ros::Subscriber subStop = hardware_commons::subscribe<std_msgs::String>(
+      stopNh, "/pwm/stop", hardware_commons::EVENTS, &stopCb, ros::TransportHints().tcpNoDelay());
+  std::thread stopThread(&stopLoop, &stopQueue);
+  if (stop_priority > 0)
+  {
+    sched_param param;
+    param.sched_priority = stop_priority;
+    int error = pthread_setschedparam(stopThread.native_handle(), SCHED_FIFO, &param);
+    if (error)
+      ROS_WARN("thruster_mixer: no SCHED_FIFO %d for the stop thread (%s)", stop_priority, strerror(error));
+  }
+
+  cmd.seq = 0;
+  ros::Rate loop_rate(rate);
+  while (ros::ok())
+  {
+    ros::spinOnce();
+    {
+      hardware_commons::trace::Span span("mix", latestTrace);
+      std::lock_guard<std::mutex> lock(mixMutex);
+      send();
+    }
+    loop_rate.sleep();
+  }
+  stopThread.join();
+  return 0;
+}
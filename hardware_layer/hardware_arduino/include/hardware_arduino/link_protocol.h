@@ -0,0 +1,248 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_LINK_PROTOCOL_H
+#define HARDWARE_ARDUINO_LINK_PROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+#include <hardware_arduino/thrusters.h>
+
+/*! \file
+* \brief Framed binary protocol between the host and the arduino, used instead of rosserial by link_node
+*
+* A frame is a LinkHeader, any number of records (type, length, payload) and a CRC16 over all of it. The frame is
+* COBS encoded so it holds no zero byte, and a zero byte ends it. Several records go in one frame, so commands and
+* telemetry are batched instead of paying the framing for every value. Both ends are little endian, payloads are the
+* packed structs below copied as they are. Everything here is shared by the firmware and the host bridge, so it sticks
+* to fixed size buffers and no allocation.
+*/
+
+const long linkBaud = 115200;
+
+// header + records + crc, before encoding; fits the 64 byte serial buffer of the uno
+const uint8_t linkMaxFrame = 60;
+// one COBS code byte per 254 bytes plus the leading code and the delimiter
+const uint8_t linkMaxEncoded = linkMaxFrame + linkMaxFrame / 254 + 2;
+
+enum LinkRecordType
+{
+  LINK_THRUSTERS = 1,  // host -> arduino, LinkThrusters
+  LINK_CONFIG,         // host -> arduino, LinkConfig
+  LINK_DEPTH,          // arduino -> host, LinkDepth
+  LINK_THRUSTER_ECHO   // arduino -> host, LinkThrusters as applied
+};
+
+struct LinkHeader
+{
+  uint8_t seq;      // per sender, a gap means frames were lost
+  uint32_t micros;  // sender clock when the frame was written
+} __attribute__((packed));
+
+struct LinkThrusters
+{
+  uint16_t seq;                   // seq of the ThrusterCommand
+  int16_t pwm[THRUSTER_COUNT];    // same meaning as ThrusterCommand.pwm
+} __attribute__((packed));
+
+struct LinkConfig
+{
+  uint8_t depthOsr;             // MS5837Async::Oversampling
+  uint8_t temperatureInterval;  // pressure conversions per temperature conversion
+  uint16_t telemetryInterval;   // ms
+  uint16_t commandTimeout;      // ms without LINK_THRUSTERS before the thrusters are stopped, 0 never
+  float filterAlpha;
+  float filterBeta;
+} __attribute__((packed));
+
+struct LinkDepth
+{
+  uint32_t sampleMicros;  // arduino clock, compare with LinkHeader::micros for the age of the sample
+  float depth;            // m
+  float depthRate;        // m/s
+  float temperature;      // deg C
+} __attribute__((packed));
+
+// CRC-16/CCITT-FALSE
+inline uint16_t linkCrc16(const uint8_t *data, uint8_t length)
+{
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < length; i++)
+  {
+    crc ^= static_cast<uint16_t>(data[i]) << 8;
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+  }
+  return crc;
+}
+
+// out needs length + length / 254 + 2 bytes, returns the encoded length including the trailing zero
+inline uint8_t cobsEncode(const uint8_t *in, uint8_t length, uint8_t *out)
+{
+  uint8_t codeIndex = 0, outIndex = 1, code = 1;
+  for (uint8_t i = 0; i < length; i++)
+  {
+    if (in[i] == 0)
+    {
+      out[codeIndex] = code;
+      codeIndex = outIndex++;
+      code = 1;
+      continue;
+    }
+    out[outIndex++] = in[i];
+    if (++code == 0xFF)
+    {
+      out[codeIndex] = code;
+      codeIndex = outIndex++;
+      code = 1;
+    }
+  }
+  out[codeIndex] = code;
+  out[outIndex++] = 0;
+  return outIndex;
+}
+
+// in is one frame without its trailing zero, returns the decoded length or 0 if the frame is malformed
+inline uint8_t cobsDecode(const uint8_t *in, uint8_t length, uint8_t *out)
+{
+  uint8_t inIndex = 0, outIndex = 0;
+  while (inIndex < length)
+  {
+    uint8_t code = in[inIndex++];
+    if (code == 0 || inIndex + code - 1 > length)
+      return 0;
+    for (uint8_t i = 1; i < code; i++)
+      out[outIndex++] = in[inIndex++];
+    if (code != 0xFF && inIndex < length)
+      out[outIndex++] = 0;
+  }
+  return outIndex;
+}
+
+// collects records into one frame
+class LinkFrameWriter
+{
+public:
+  LinkFrameWriter() : length_(0)
+  {
+  }
+
+  void begin(uint8_t seq, uint32_t micros)
+  {
+    LinkHeader header;
+    header.seq = seq;
+    header.micros = micros;
+    memcpy(frame_, &header, sizeof(header));
+    length_ = sizeof(header);
+  }
+
+  // false if the record does not fit, the frame is left as it was
+  bool add(uint8_t type, const void *payload, uint8_t length)
+  {
+    if (length_ + 2 + length + 2 > linkMaxFrame)
+      return false;
+    frame_[length_++] = type;
+    frame_[length_++] = length;
+    memcpy(frame_ + length_, payload, length);
+    length_ += length;
+    return true;
+  }
+
+  bool empty() const
+  {
+    return length_ <= sizeof(LinkHeader);
+  }
+
+  // appends the crc and encodes, out needs linkMaxEncoded bytes; returns the bytes to send
+  uint8_t finish(uint8_t *out)
+  {
+    uint16_t crc = linkCrc16(frame_, length_);
+    frame_[length_++] = crc & 0xFF;
+    frame_[length_++] = crc >> 8;
+    uint8_t encoded = cobsEncode(frame_, length_, out);
+    length_ = 0;
+    return encoded;
+  }
+
+private:
+  uint8_t frame_[linkMaxFrame];
+  uint8_t length_;
+};
+
+// fed one received byte at a time, holds the last good frame until the next one completes
+class LinkFrameReader
+{
+public:
+  LinkFrameReader() : received_(0), length_(0), cursor_(0), overflow_(false), errors_(0)
+  {
+  }
+
+  // true when byte completed a frame with a good crc
+  bool push(uint8_t byte)
+  {
+    if (byte != 0)
+    {
+      if (received_ < linkMaxEncoded)
+        buffer_[received_++] = byte;
+      else
+        overflow_ = true;
+      return false;
+    }
+
+    bool good = false;
+    if (received_ > 0)
+    {
+      uint8_t length = overflow_ ? 0 : cobsDecode(buffer_, received_, frame_);
+      if (length >= sizeof(LinkHeader) + 2 &&
+          linkCrc16(frame_, length - 2) == (frame_[length - 2] | (frame_[length - 1] << 8)))
+      {
+        length_ = length - 2;
+        cursor_ = sizeof(LinkHeader);
+        memcpy(&header_, frame_, sizeof(header_));
+        good = true;
+      }
+      else
+      {
+        errors_++;
+      }
+    }
+    received_ = 0;
+    overflow_ = false;
+    return good;
+  }
+
+  const LinkHeader &header() const
+  {
+    return header_;
+  }
+
+  // walks the records of the last good frame, false once all are read
+  bool next(uint8_t &type, const uint8_t *&payload, uint8_t &length)
+  {
+    if (cursor_ + 2 > length_)
+      return false;
+    type = frame_[cursor_];
+    length = frame_[cursor_ + 1];
+    if (cursor_ + 2 + length > length_)
+      return false;
+    payload = frame_ + cursor_ + 2;
+    cursor_ += 2 + length;
+    return true;
+  }
+
+  // frames dropped for a bad crc, bad encoding or overflow
+  uint16_t errors() const
+  {
+    return errors_;
+  }
+
+private:
+  uint8_t buffer_[linkMaxEncoded];
+  uint8_t frame_[linkMaxEncoded];
+  uint8_t received_;
+  uint8_t length_;
+  uint8_t cursor_;
+  bool overflow_;
+  uint16_t errors_;
+  LinkHeader header_;
+};
+
+#endif  // HARDWARE_ARDUINO_LINK_PROTOCOL_H
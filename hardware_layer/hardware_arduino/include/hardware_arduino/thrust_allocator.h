@@ -0,0 +1,45 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_THRUST_ALLOCATOR_H
+#define HARDWARE_ARDUINO_THRUST_ALLOCATOR_H
+
+#include <hardware_arduino/thrusters.h>
+
+/*! \file
+* \brief Maps a surge, sway, heave and yaw demand onto the six thrusters
+*
+* The allocation matrix (pseudo inverse of the thruster configuration) and the per thruster limits are computed once
+* in the constructor, so allocate() is a 6x4 multiply and a scaling pass per control tick.
+*/
+class ThrustAllocator
+{
+public:
+  enum Axis
+  {
+    AXIS_SURGE = 0,
+    AXIS_SWAY,
+    AXIS_HEAVE,
+    AXIS_YAW,
+    AXIS_COUNT
+  };
+
+  // arms are relative to each other; with both arms 1 a yaw demand of n is split over the surge and the sway pair,
+  // pwm n/2 on each of the four thrusters, about the torque of the old "turn n" on one pair
+  ThrustAllocator(float eastWestArm, float swayArm);
+
+  // wrench is in pwm units per axis, out is the signed pwm of every thruster in Thruster order
+  void allocate(const float wrench[AXIS_COUNT], int out[THRUSTER_COUNT]) const;
+
+  // largest command the thruster can follow before its linearized output leaves the 8 bit pwm range
+  int limit(int thruster) const
+  {
+    return limit_[thruster];
+  }
+
+private:
+  float allocation_[THRUSTER_COUNT][AXIS_COUNT];
+  int limit_[THRUSTER_COUNT];
+  // thrusters sharing an axis are scaled together so a saturated demand keeps its direction
+  int group_[THRUSTER_COUNT];
+};
+
+#endif  // HARDWARE_ARDUINO_THRUST_ALLOCATOR_H
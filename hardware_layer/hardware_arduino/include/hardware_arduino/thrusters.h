@@ -0,0 +1,57 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_THRUSTERS_H
+#define HARDWARE_ARDUINO_THRUSTERS_H
+
+// Position of every thruster inside ThrusterCommand.pwm, shared by the host mixer and the firmware.
+// Positive pwm means forward for east/west, right for the sway pair and up for the upward pair.
+enum Thruster
+{
+  THRUSTER_EAST = 0,
+  THRUSTER_WEST,
+  THRUSTER_NORTH_SWAY,
+  THRUSTER_SOUTH_SWAY,
+  THRUSTER_NORTH_UP,
+  THRUSTER_SOUTH_UP,
+  THRUSTER_COUNT
+};
+
+constexpr int thrusterMaxPWM = 255;
+
+// Measured linear curves of the individual thrusters (c + s * pwm). Every command is mapped onto the curve of 099 so
+// all thrusters give the same thrust for the same command.
+constexpr float c092 = 506.22;
+constexpr float s092 = -2.65;
+constexpr float c093 = 448.62;
+constexpr float s093 = -2.92;
+constexpr float c099 = 397.65;  // reference as their graph is at lowest
+constexpr float s099 = -2.71;   // reference as their graph is at lowest
+constexpr float c113 = 539.85;
+constexpr float s113 = -3.38;
+constexpr float c117 = 441.32;
+constexpr float s117 = -3.03;
+constexpr float c122 = 547.39;
+constexpr float s122 = -2.93;
+
+// commands are squeezed into the usable band of the drivers before linearization
+constexpr int normalizeOffset = 147;
+constexpr int normalizeSpan = 53;
+constexpr int normalizeUpwardSpan = 73;
+
+struct ThrusterCurve
+{
+  float c;
+  float s;
+  int span;
+};
+
+// curve mounted at every position of the Thruster enum
+constexpr ThrusterCurve thrusterCurves[THRUSTER_COUNT] = {
+  { c092, s092, normalizeSpan },        // east
+  { c099, s099, normalizeSpan },        // west
+  { c113, s113, normalizeSpan },        // north sway
+  { c122, s122, normalizeSpan },        // south sway
+  { c117, s117, normalizeUpwardSpan },  // north up
+  { c093, s093, normalizeUpwardSpan },  // south up
+};
+
+#endif  // HARDWARE_ARDUINO_THRUSTERS_H
@@ -0,0 +1,268 @@
+// Copyright 2016 AUV-IITK
+// Runs one firmware (linked in by CMake) on the simulated board with a synthetic command stream and reports how long
+// commands take to reach the pwm pins. SIM_INPUT_* picks how commands are sent, matching what the firmware listens to.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "sim_board.h"
+
+#if defined(SIM_INPUT_THRUSTER_COMMAND)
+#include <hardware_arduino/ThrusterCommand.h>
+const long defaultBaud = 57600;
+#elif defined(SIM_INPUT_INT32)
+#include <std_msgs/Int32.h>
+const long defaultBaud = 57600;
+#elif defined(SIM_INPUT_LINK)
+#include <hardware_arduino/link_protocol.h>
+const long defaultBaud = linkBaud;
+#else
+#error "define one of SIM_INPUT_THRUSTER_COMMAND, SIM_INPUT_INT32, SIM_INPUT_LINK"
+#endif
+
+#ifndef SIM_FIRMWARE
+#define SIM_FIRMWARE "firmware"
+#endif
+
+void setup();
+void loop();
+
+#if defined(SIM_INPUT_LINK)
+LinkFrameReader telemetry;
+unsigned long telemetryFrames = 0;
+#endif
+
+// a changing, never repeated command so every one of them should end in pwm writes
+void sendCommand(int k)
+{
+  int id = sim::newCommand();
+  int pwm = (k * 37) % 511 - 255;
+#if defined(SIM_INPUT_THRUSTER_COMMAND)
+  hardware_arduino::ThrusterCommand cmd;
+  cmd.seq = k + 1;
+  for (int i = 0; i < 6; i++)
+    cmd.pwm[i] = (i % 2) ? pwm : -pwm;
+  sim::rosInject("/pwm/thrusters", cmd, id);
+#elif defined(SIM_INPUT_INT32)
+  std_msgs::Int32 cmd;
+  cmd.data = pwm;
+  sim::rosInject("/pwm/forward", cmd, id);
+#elif defined(SIM_INPUT_LINK)
+  LinkThrusters cmd;
+  cmd.seq = k + 1;
+  for (int i = 0; i < THRUSTER_COUNT; i++)
+    cmd.pwm[i] = (i % 2) ? pwm : -pwm;
+  LinkFrameWriter writer;
+  uint8_t encoded[linkMaxEncoded];
+  writer.begin(k, 0);
+  writer.add(LINK_THRUSTERS, &cmd, sizeof(cmd));
+  sim::serialInject(encoded, writer.finish(encoded), id);
+#endif
+}
+
+void collectOutput()
+{
+#if defined(SIM_INPUT_LINK)
+  std::vector<uint8_t> out = sim::takeSerialOutput();
+  for (size_t i = 0; i < out.size(); i++)
+    telemetryFrames += telemetry.push(out[i]);
+#endif
+}
+
+unsigned long percentile(const std::vector<unsigned long> &sorted, double p)
+{
+  if (sorted.empty())
+    return 0;
+  return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+void writeTrace(const char *path)
+{
+  FILE *file = fopen(path, "w");
+  if (!file)
+  {
+    fprintf(stderr, "cannot write %s\n", path);
+    return;
+  }
+  fprintf(file, "time_us,pin,value,kind\n");
+  const std::vector<sim::PinWrite> &writes = sim::pinWrites();
+  for (size_t i = 0; i < writes.size(); i++)
+    fprintf(file, "%lu,%d,%d,%s\n", writes[i].time, writes[i].pin, writes[i].value,
+            writes[i].analog ? "analog" : "digital");
+  fclose(file);
+}
+
+// taken when the command stream starts, so rates leave out setup
+unsigned long serialAtStart = 0;
+std::vector<std::pair<std::string, unsigned long> > publishedAtStart;
+#if defined(SIM_INPUT_LINK)
+unsigned long telemetryAtStart = 0;
+#endif
+
+void report(double seconds, double rate, unsigned long passes, unsigned long longestPass)
+{
+  const std::vector<sim::CommandRecord> &commands = sim::commands();
+  std::vector<unsigned long> latency;
+  int applied = 0, ignored = 0, waiting = 0;
+  for (size_t i = 0; i < commands.size(); i++)
+  {
+    if (commands[i].state == sim::CommandRecord::APPLIED)
+    {
+      applied++;
+      latency.push_back(commands[i].applied - commands[i].injected);
+    }
+    else if (commands[i].state == sim::CommandRecord::IGNORED)
+      ignored++;
+    else
+      waiting++;
+  }
+  std::sort(latency.begin(), latency.end());
+  unsigned long sum = 0;
+  for (size_t i = 0; i < latency.size(); i++)
+    sum += latency[i];
+
+  int analog = 0, digital = 0;
+  const std::vector<sim::PinWrite> &writes = sim::pinWrites();
+  for (size_t i = 0; i < writes.size(); i++)
+    (writes[i].analog ? analog : digital)++;
+
+  printf("%s: %.1f s simulated, commands at %.1f Hz\n", SIM_FIRMWARE, seconds, rate);
+  printf("loop: %lu passes, mean %.0f us, longest %lu us\n", passes, seconds * 1e6 / passes, longestPass);
+  printf("commands: %zu sent, %d applied, %d ignored, %d still waiting\n", commands.size(), applied, ignored, waiting);
+  printf("command to pwm latency (us): min %lu  mean %lu  p50 %lu  p99 %lu  max %lu\n", percentile(latency, 0),
+         latency.empty() ? 0 : sum / latency.size(), percentile(latency, 0.5), percentile(latency, 0.99),
+         latency.empty() ? 0 : latency.back());
+  printf("throughput: %.1f commands/s applied, %.1f analog and %.1f digital writes/s\n", applied / seconds,
+         analog / seconds, digital / seconds);
+  printf("serial out: %.0f bytes/s\n", (sim::serialBytesWritten() - serialAtStart) / seconds);
+  std::vector<std::pair<std::string, unsigned long> > published = sim::publishedCounts();
+  for (size_t i = 0; i < published.size(); i++)
+    printf("  %s: %.1f Hz\n", published[i].first.c_str(),
+           (published[i].second - publishedAtStart[i].second) / seconds);
+#if defined(SIM_INPUT_LINK)
+  printf("  telemetry frames: %.1f Hz, %u bad\n", (telemetryFrames - telemetryAtStart) / seconds, telemetry.errors());
+#endif
+  printf("MS5837 reads before the conversion finished: %lu\n", sim::earlyAdcReads());
+}
+
+void usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [--rate HZ] [--seconds S] [--baud BAUD] [--param NAME=V[,V...]] [--trace FILE]%s\n",
+          name,
+#if defined(SIM_INPUT_LINK)
+          " [--pty]"
+#else
+          ""
+#endif
+          );  // NOLINT(whitespace/parens)
+}
+
+int main(int argc, char **argv)
+{
+  double rate = 50, seconds = 10;
+  long baud = defaultBaud;
+  const char *trace = NULL;
+  bool pty = false;
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--rate" && hasValue)
+      rate = atof(argv[++i]);
+    else if (arg == "--seconds" && hasValue)
+      seconds = atof(argv[++i]);
+    else if (arg == "--baud" && hasValue)
+      baud = atol(argv[++i]);
+    else if (arg == "--trace" && hasValue)
+      trace = argv[++i];
+    else if (arg == "--param" && hasValue)
+    {
+      // rosserial resolves ~name against serial_node, the firmware asks for it with the ~
+      std::string param = argv[++i];
+      size_t equals = param.find('=');
+      if (equals == std::string::npos)
+      {
+        usage(argv[0]);
+        return 1;
+      }
+      std::vector<double> values;
+      std::string list = param.substr(equals + 1);
+      for (char *v = strtok(&list[0], ","); v; v = strtok(NULL, ","))
+        values.push_back(atof(v));
+      sim::setParam(param.substr(0, equals), values);
+    }
+#if defined(SIM_INPUT_LINK)
+    else if (arg == "--pty")
+      pty = true;
+#endif
+    else
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  // wall clock and a real serial port for a host node (link_bridge) instead of the synthetic stream
+  if (pty)
+  {
+    std::string slave;
+    sim::configure(baud, true);
+    if (!sim::openPty(slave))
+    {
+      fprintf(stderr, "cannot open a pty\n");
+      return 1;
+    }
+    printf("%s listening on %s\n", SIM_FIRMWARE, slave.c_str());
+    fflush(stdout);
+    setup();
+    while (true)
+    {
+      loop();
+      sim::pumpPty();
+    }
+  }
+
+  sim::configure(baud, false);
+  setup();
+  sim::endLoop();
+
+  // commands start once setup has settled
+  const unsigned long start = 500000, end = start + seconds * 1e6;
+  const double period = 1e6 / rate;
+  double nextCommand = start;
+  int k = 0;
+  unsigned long passes = 0, longestPass = 0;
+  while (sim::now() < end)
+  {
+    if (passes == 0 && sim::now() >= start)
+    {
+      serialAtStart = sim::serialBytesWritten();
+      publishedAtStart = sim::publishedCounts();
+#if defined(SIM_INPUT_LINK)
+      telemetryAtStart = telemetryFrames;
+#endif
+    }
+    while (sim::now() >= nextCommand)
+    {
+      sendCommand(k++);
+      nextCommand += period;
+    }
+    unsigned long before = sim::now();
+    loop();
+    sim::advance(sim::costs.loopPass);
+    sim::endLoop();
+    collectOutput();
+    if (before >= start)
+    {
+      passes++;
+      longestPass = std::max(longestPass, sim::now() - before);
+    }
+  }
+
+  report(seconds, rate, passes, longestPass);
+  if (trace)
+    writeTrace(trace);
+  return 0;
+}
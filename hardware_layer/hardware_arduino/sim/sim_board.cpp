@@ -0,0 +1,544 @@
+// Copyright 2016 AUV-IITK
+#include "sim_board.h"
+#include <Arduino.h>
+#include <Wire.h>
+#include <ros.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <thread>
+
+HardwareSerial Serial;
+TwoWire Wire;
+
+namespace sim
+{
+Costs costs = { 10, 5, 100, 100 };
+
+namespace
+{
+long baud = 57600;
+bool realTime = false;
+unsigned long simClock = 0;
+std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+std::vector<PinWrite> writes;
+std::vector<CommandRecord> records;
+std::vector<int> consumedThisPass;
+
+struct RxByte
+{
+  unsigned long arrival;
+  uint8_t byte;
+  int id;
+};
+std::deque<RxByte> rx;
+
+struct RxMessage
+{
+  unsigned long arrival;
+  std::string topic;
+  std::shared_ptr<void> msg;
+  int id;
+};
+std::deque<RxMessage> rxMessages;
+// host and board share one wire per direction, a new message queues behind the last one
+unsigned long rxFreeAt = 0;
+unsigned long txFreeAt = 0;
+unsigned long txBytes = 0;
+std::vector<uint8_t> txCaptured;
+// the AVR core buffers this much before Serial.write blocks
+const unsigned long txBuffer = 64;
+
+int ptyMaster = -1;
+
+std::vector<ros::SubscriberBase *> subscribers;
+std::vector<ros::Publisher *> publishers;
+std::map<std::string, std::vector<double> > params;
+
+unsigned long byteTime()
+{
+  // 8N1, ten bits a byte
+  return 10000000 / baud;
+}
+
+void markConsumed(int id)
+{
+  if (id < 0 || id >= static_cast<int>(records.size()))
+    return;
+  records[id].consumed = now();
+  records[id].state = CommandRecord::CONSUMED;
+  consumedThisPass.push_back(id);
+}
+
+void charge(unsigned long us)
+{
+  if (!realTime)
+    simClock += us;
+}
+
+// MS5837-30BA on the I2C bus, answering with fixed raw values close to the datasheet example
+class FakeMS5837
+{
+public:
+  FakeMS5837() : conversion_(NONE), osr_(0), started_(0), read_(READ_NONE), promIndex_(0), noise_(1), early_(0)
+  {
+    uint16_t prom[8] = { 0, 34982, 36352, 20328, 22354, 26646, 26146, 0 };
+    prom[0] = crc4(prom) << 12;
+    for (int i = 0; i < 8; i++)
+      prom_[i] = prom[i];
+  }
+
+  void command(uint8_t cmd)
+  {
+    if ((cmd & 0xF0) == 0xA0)
+    {
+      read_ = READ_PROM;
+      promIndex_ = (cmd >> 1) & 0x07;
+    }
+    else if (cmd == 0x00)
+    {
+      read_ = READ_ADC;
+    }
+    else if ((cmd & 0xF0) == 0x40 || (cmd & 0xF0) == 0x50)
+    {
+      conversion_ = (cmd & 0xF0) == 0x40 ? D1 : D2;
+      osr_ = (cmd & 0x0F) / 2;
+      started_ = now();
+    }
+  }
+
+  int respond(uint8_t *out, int quantity)
+  {
+    uint32_t value = 0;
+    int length = 0;
+    if (read_ == READ_PROM)
+    {
+      value = prom_[promIndex_];
+      length = 2;
+    }
+    else if (read_ == READ_ADC)
+    {
+      // typical conversion times, the driver waits for the maximum
+      static const unsigned long typical[] = { 560, 1100, 2170, 4320, 8610, 17200 };
+      if (conversion_ == NONE || now() - started_ < typical[osr_])
+        early_++;
+      else
+        value = conversion_ == D1 ? 4958179 + noise() : 6815414;
+      conversion_ = NONE;
+      length = 3;
+    }
+    read_ = READ_NONE;
+    if (quantity < length)
+      length = quantity;
+    for (int i = 0; i < length; i++)
+      out[i] = value >> (8 * (length - 1 - i));
+    return length;
+  }
+
+  unsigned long early() const
+  {
+    return early_;
+  }
+
+private:
+  enum Conversion
+  {
+    NONE,
+    D1,
+    D2
+  };
+  enum Read
+  {
+    READ_NONE,
+    READ_PROM,
+    READ_ADC
+  };
+  Conversion conversion_;
+  int osr_;
+  unsigned long started_;
+  Read read_;
+  int promIndex_;
+  uint16_t prom_[8];
+  uint32_t noise_;
+  unsigned long early_;
+
+  // a few counts of deterministic noise
+  int noise()
+  {
+    noise_ = noise_ * 1103515245 + 12345;
+    return static_cast<int>((noise_ >> 16) % 81) - 40;
+  }
+
+  static uint16_t crc4(uint16_t prom[8])
+  {
+    uint16_t rem = 0;
+    for (int i = 0; i < 16; i++)
+    {
+      rem ^= (i % 2 == 1) ? (prom[i >> 1] & 0x00FF) : (prom[i >> 1] >> 8);
+      for (int bit = 8; bit > 0; bit--)
+        rem = (rem & 0x8000) ? (rem << 1) ^ 0x3000 : (rem << 1);
+    }
+    return (rem >> 12) & 0x000F;
+  }
+};
+
+FakeMS5837 ms5837;
+const int ms5837Address = 0x76;
+int i2cAddress = 0;
+std::vector<uint8_t> i2cTx;
+std::deque<uint8_t> i2cRx;
+}  // namespace
+
+void configure(long linkBaud, bool wallClock)
+{
+  baud = linkBaud;
+  realTime = wallClock;
+  started = std::chrono::steady_clock::now();
+}
+
+unsigned long now()
+{
+  if (realTime)
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+  return simClock;
+}
+
+void advance(unsigned long us)
+{
+  if (realTime)
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+  else
+    simClock += us;
+}
+
+void endLoop()
+{
+  for (size_t i = 0; i < consumedThisPass.size(); i++)
+  {
+    CommandRecord &record = records[consumedThisPass[i]];
+    record.state = record.applied >= record.consumed && record.applied != 0 ? CommandRecord::APPLIED :
+                                                                             CommandRecord::IGNORED;
+  }
+  consumedThisPass.clear();
+}
+
+int newCommand()
+{
+  CommandRecord record = { now(), 0, 0, CommandRecord::SENT };
+  records.push_back(record);
+  return records.size() - 1;
+}
+
+void rosQueue(const char *topic, std::shared_ptr<void> msg, int wireBytes, int id)
+{
+  rxFreeAt = std::max(rxFreeAt, now()) + wireBytes * byteTime();
+  RxMessage pending = { rxFreeAt, topic, msg, id };
+  rxMessages.push_back(pending);
+}
+
+void serialInject(const uint8_t *data, size_t length, int id)
+{
+  for (size_t i = 0; i < length; i++)
+  {
+    rxFreeAt = std::max(rxFreeAt, now()) + byteTime();
+    RxByte byte = { rxFreeAt, data[i], i + 1 == length ? id : -1 };
+    rx.push_back(byte);
+  }
+}
+
+void setParam(const std::string &name, const std::vector<double> &values)
+{
+  params[name] = values;
+}
+
+bool openPty(std::string &slave)
+{
+  ptyMaster = posix_openpt(O_RDWR | O_NOCTTY);
+  if (ptyMaster < 0 || grantpt(ptyMaster) != 0 || unlockpt(ptyMaster) != 0)
+    return false;
+  fcntl(ptyMaster, F_SETFL, fcntl(ptyMaster, F_GETFL) | O_NONBLOCK);
+  slave = ptsname(ptyMaster);
+  return true;
+}
+
+void pumpPty()
+{
+  if (ptyMaster < 0)
+    return;
+  uint8_t buffer[256];
+  ssize_t n;
+  while ((n = read(ptyMaster, buffer, sizeof(buffer))) > 0)
+  {
+    for (ssize_t i = 0; i < n; i++)
+    {
+      RxByte byte = { now(), buffer[i], -1 };
+      rx.push_back(byte);
+    }
+  }
+  if (!txCaptured.empty() && write(ptyMaster, txCaptured.data(), txCaptured.size()) > 0)
+    txCaptured.clear();
+}
+
+const std::vector<PinWrite> &pinWrites()
+{
+  return writes;
+}
+
+const std::vector<CommandRecord> &commands()
+{
+  return records;
+}
+
+std::vector<uint8_t> takeSerialOutput()
+{
+  std::vector<uint8_t> out;
+  out.swap(txCaptured);
+  return out;
+}
+
+unsigned long serialBytesWritten()
+{
+  return txBytes;
+}
+
+std::vector<std::pair<std::string, unsigned long> > publishedCounts()
+{
+  std::vector<std::pair<std::string, unsigned long> > counts;
+  for (size_t i = 0; i < publishers.size(); i++)
+    counts.push_back(std::make_pair(std::string(publishers[i]->topic_), publishers[i]->count_));
+  return counts;
+}
+
+unsigned long earlyAdcReads()
+{
+  return ms5837.early();
+}
+
+// blocks like the AVR core once the transmit buffer is full
+void serialWrite(const uint8_t *data, size_t length)
+{
+  txFreeAt = std::max(txFreeAt, now()) + length * byteTime();
+  unsigned long backlog = txFreeAt - now();
+  if (backlog > txBuffer * byteTime())
+    charge(backlog - txBuffer * byteTime());
+  txBytes += length;
+  if (data)
+    txCaptured.insert(txCaptured.end(), data, data + length);
+}
+}  // namespace sim
+
+using sim::now;
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  sim::charge(sim::costs.pinWrite);
+  sim::PinWrite write = { now(), pin, value, false };
+  sim::writes.push_back(write);
+}
+
+void analogWrite(uint8_t pin, int value)
+{
+  sim::charge(sim::costs.pinWrite);
+  sim::PinWrite write = { now(), pin, value, true };
+  sim::writes.push_back(write);
+  for (size_t i = 0; i < sim::consumedThisPass.size(); i++)
+    sim::records[sim::consumedThisPass[i]].applied = now();
+}
+
+int analogRead(uint8_t pin)
+{
+  sim::charge(112);
+  return 0;
+}
+
+unsigned long millis()
+{
+  return now() / 1000;
+}
+
+unsigned long micros()
+{
+  return now();
+}
+
+void delay(unsigned long ms)
+{
+  sim::advance(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  sim::advance(us);
+}
+
+void HardwareSerial::begin(long baud)
+{
+}
+
+int HardwareSerial::available()
+{
+  sim::pumpPty();
+  int count = 0;
+  for (size_t i = 0; i < sim::rx.size() && sim::rx[i].arrival <= now(); i++)
+    count++;
+  return count;
+}
+
+int HardwareSerial::read()
+{
+  if (sim::rx.empty() || sim::rx.front().arrival > now())
+    return -1;
+  sim::RxByte byte = sim::rx.front();
+  sim::rx.pop_front();
+  sim::markConsumed(byte.id);
+  return byte.byte;
+}
+
+size_t HardwareSerial::write(uint8_t byte)
+{
+  sim::serialWrite(&byte, 1);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  sim::serialWrite(buffer, size);
+  return size;
+}
+
+void TwoWire::begin()
+{
+}
+
+void TwoWire::beginTransmission(int address)
+{
+  sim::i2cAddress = address;
+  sim::i2cTx.clear();
+}
+
+size_t TwoWire::write(uint8_t byte)
+{
+  sim::i2cTx.push_back(byte);
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission()
+{
+  sim::charge((1 + sim::i2cTx.size()) * sim::costs.i2cByte);
+  if (sim::i2cAddress != sim::ms5837Address)
+    return 2;  // address not acknowledged
+  for (size_t i = 0; i < sim::i2cTx.size(); i++)
+    sim::ms5837.command(sim::i2cTx[i]);
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity)
+{
+  sim::charge((1 + quantity) * sim::costs.i2cByte);
+  sim::i2cRx.clear();
+  if (address != sim::ms5837Address)
+    return 0;
+  uint8_t buffer[4];
+  int length = sim::ms5837.respond(buffer, quantity < 4 ? quantity : 4);
+  sim::i2cRx.assign(buffer, buffer + length);
+  return length;
+}
+
+int TwoWire::available()
+{
+  return sim::i2cRx.size();
+}
+
+int TwoWire::read()
+{
+  if (sim::i2cRx.empty())
+    return -1;
+  int byte = sim::i2cRx.front();
+  sim::i2cRx.pop_front();
+  return byte;
+}
+
+namespace ros
+{
+int Publisher::publish(const Msg *msg)
+{
+  sim::serialWrite(NULL, msg->serializedLength() + sim::rosFrameOverhead);
+  count_++;
+  return 0;
+}
+
+void NodeHandle::initNode()
+{
+}
+
+bool NodeHandle::subscribe(SubscriberBase &s)
+{
+  sim::subscribers.push_back(&s);
+  return true;
+}
+
+bool NodeHandle::advertise(Publisher &p)
+{
+  sim::publishers.push_back(&p);
+  return true;
+}
+
+// hands every message that has fully arrived to its subscriber
+int NodeHandle::spinOnce()
+{
+  while (!sim::rxMessages.empty() && sim::rxMessages.front().arrival <= sim::now())
+  {
+    sim::RxMessage message = sim::rxMessages.front();
+    sim::rxMessages.pop_front();
+    sim::charge(sim::costs.rosDispatch);
+    sim::markConsumed(message.id);
+    for (size_t i = 0; i < sim::subscribers.size(); i++)
+    {
+      if (message.topic == sim::subscribers[i]->topic_)
+        sim::subscribers[i]->deliver(message.msg.get());
+    }
+  }
+  return 0;
+}
+
+bool NodeHandle::connected()
+{
+  return true;
+}
+
+Time NodeHandle::now()
+{
+  Time t;
+  t.sec = sim::now() / 1000000;
+  t.nsec = (sim::now() % 1000000) * 1000;
+  return t;
+}
+
+bool NodeHandle::getParam(const char *name, int *param, int length, int timeout)
+{
+  std::map<std::string, std::vector<double> >::const_iterator it = sim::params.find(name);
+  if (it == sim::params.end() || static_cast<int>(it->second.size()) != length)
+    return false;
+  for (int i = 0; i < length; i++)
+    param[i] = static_cast<int>(it->second[i]);
+  return true;
+}
+
+bool NodeHandle::getParam(const char *name, float *param, int length, int timeout)
+{
+  std::map<std::string, std::vector<double> >::const_iterator it = sim::params.find(name);
+  if (it == sim::params.end() || static_cast<int>(it->second.size()) != length)
+    return false;
+  for (int i = 0; i < length; i++)
+    param[i] = it->second[i];
+  return true;
+}
+}  // namespace ros
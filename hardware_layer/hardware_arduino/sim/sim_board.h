@@ -0,0 +1,92 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_SIM_BOARD_H
+#define HARDWARE_ARDUINO_SIM_BOARD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*! \file
+* \brief Simulated board behind the stubs in sim/stubs
+*
+* Time is virtual. It only moves when the firmware spends it: pin writes, I2C bytes, serial transmit, rosserial
+* dispatch, delay(), and a fixed cost per pass of loop(). The costs roughly match a 16 MHz AVR, so the numbers are
+* good for comparing firmware changes, not for absolute timing. Commands sent from the host side are tracked from
+* injection until the firmware consumes them and writes pwm, which gives the command to pwm latency.
+*/
+namespace sim
+{
+// microseconds of simulated time charged per operation
+struct Costs
+{
+  unsigned long loopPass;     // loop() call overhead
+  unsigned long pinWrite;     // digitalWrite or analogWrite
+  unsigned long i2cByte;      // one byte at 100 kHz, address included
+  unsigned long rosDispatch;  // rosserial checksum and deserialize per message
+};
+
+extern Costs costs;
+// rosserial adds sync, length, topic id and checksums around every message
+const int rosFrameOverhead = 8;
+
+struct PinWrite
+{
+  unsigned long time;
+  uint8_t pin;
+  int value;
+  bool analog;
+};
+
+struct CommandRecord
+{
+  enum State
+  {
+    SENT,      // still on the wire or waiting to be read
+    CONSUMED,  // read by the firmware in the current loop() pass
+    APPLIED,   // followed by pwm writes in the same pass
+    IGNORED    // read but no pwm was written
+  };
+  unsigned long injected;
+  unsigned long consumed;
+  unsigned long applied;
+  State state;
+};
+
+// link baud for both directions; realTime runs on the wall clock instead (see openPty)
+void configure(long baud, bool realTime);
+unsigned long now();
+void advance(unsigned long us);
+// closes the loop() pass, commands consumed in it become APPLIED or IGNORED
+void endLoop();
+
+// host side: a new command id, then its message or bytes
+int newCommand();
+void rosQueue(const char *topic, std::shared_ptr<void> msg, int wireBytes, int id);
+template <typename MsgT>
+void rosInject(const char *topic, const MsgT &msg, int id)
+{
+  rosQueue(topic, std::make_shared<MsgT>(msg), msg.serializedLength() + rosFrameOverhead, id);
+}
+// id is attached to the last byte, the command counts as consumed once that byte is read
+void serialInject(const uint8_t *data, size_t length, int id);
+void setParam(const std::string &name, const std::vector<double> &values);
+
+// pty whose other end behaves like the board's serial port, for running host nodes against the firmware
+bool openPty(std::string &slave);
+// moves bytes between the pty and the simulated serial port
+void pumpPty();
+
+const std::vector<PinWrite> &pinWrites();
+const std::vector<CommandRecord> &commands();
+// bytes the firmware wrote to the serial port since the last call
+std::vector<uint8_t> takeSerialOutput();
+unsigned long serialBytesWritten();
+// published message count per rosserial topic
+std::vector<std::pair<std::string, unsigned long> > publishedCounts();
+// ADC reads of the MS5837 issued before the conversion had finished; the sensor returns 0 for those
+unsigned long earlyAdcReads();
+}  // namespace sim
+
+#endif  // HARDWARE_ARDUINO_SIM_BOARD_H
@@ -0,0 +1,43 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_SIM_ARDUINO_H
+#define HARDWARE_ARDUINO_SIM_ARDUINO_H
+
+// The parts of the Arduino core the firmware uses, backed by the simulated board in sim_board.cpp
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define A0 54
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+void analogWrite(uint8_t pin, int value);
+int analogRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+class HardwareSerial
+{
+public:
+  void begin(long baud);
+  int available();
+  int read();
+  size_t write(uint8_t byte);
+  size_t write(const uint8_t *buffer, size_t size);
+};
+
+extern HardwareSerial Serial;
+
+#endif  // HARDWARE_ARDUINO_SIM_ARDUINO_H
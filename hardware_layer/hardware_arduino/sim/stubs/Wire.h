@@ -0,0 +1,22 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_SIM_WIRE_H
+#define HARDWARE_ARDUINO_SIM_WIRE_H
+
+#include <Arduino.h>
+
+// I2C master; the only device on the bus is the simulated MS5837
+class TwoWire
+{
+public:
+  void begin();
+  void beginTransmission(int address);
+  size_t write(uint8_t byte);
+  uint8_t endTransmission();
+  uint8_t requestFrom(int address, int quantity);
+  int available();
+  int read();
+};
+
+extern TwoWire Wire;
+
+#endif  // HARDWARE_ARDUINO_SIM_WIRE_H
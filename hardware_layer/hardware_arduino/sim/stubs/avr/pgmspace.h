@@ -0,0 +1,11 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_SIM_PGMSPACE_H
+#define HARDWARE_ARDUINO_SIM_PGMSPACE_H
+
+#include <stdint.h>
+
+// flash and ram share one address space on the host
+#define PROGMEM
+#define pgm_read_byte(address) (*reinterpret_cast<const uint8_t *>(address))
+
+#endif  // HARDWARE_ARDUINO_SIM_PGMSPACE_H
@@ -0,0 +1,27 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_SIM_DEPTH_SAMPLE_H
+#define HARDWARE_ARDUINO_SIM_DEPTH_SAMPLE_H
+
+#include <ros.h>
+
+// same fields as the rosserial message generated from msg/DepthSample.msg
+namespace hardware_arduino
+{
+class DepthSample : public ros::Msg
+{
+public:
+  ros::Time stamp;
+  float depth;
+  float depth_rate;
+  float temperature;
+  DepthSample() : depth(0), depth_rate(0), temperature(0)
+  {
+  }
+  int serializedLength() const
+  {
+    return 8 + 3 * 4;
+  }
+};
+}  // namespace hardware_arduino
+
+#endif  // HARDWARE_ARDUINO_SIM_DEPTH_SAMPLE_H
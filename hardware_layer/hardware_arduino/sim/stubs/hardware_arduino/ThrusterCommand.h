@@ -0,0 +1,25 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_SIM_THRUSTER_COMMAND_H
+#define HARDWARE_ARDUINO_SIM_THRUSTER_COMMAND_H
+
+#include <ros.h>
+
+// same fields as the rosserial message generated from msg/ThrusterCommand.msg
+namespace hardware_arduino
+{
+class ThrusterCommand : public ros::Msg
+{
+public:
+  uint16_t seq;
+  int16_t pwm[6];
+  ThrusterCommand() : seq(0), pwm()
+  {
+  }
+  int serializedLength() const
+  {
+    return 2 + 6 * 2;
+  }
+};
+}  // namespace hardware_arduino
+
+#endif  // HARDWARE_ARDUINO_SIM_THRUSTER_COMMAND_H
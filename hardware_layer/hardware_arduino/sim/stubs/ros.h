@@ -0,0 +1,122 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_SIM_ROS_H
+#define HARDWARE_ARDUINO_SIM_ROS_H
+
+// The rosserial client API as far as the firmware uses it. Messages do not go through a real serial link; the
+// simulated board charges their wire time at the link baud and hands them to the callbacks in spinOnce().
+
+#include <Arduino.h>
+
+namespace ros
+{
+class Msg
+{
+public:
+  virtual ~Msg()
+  {
+  }
+  // bytes of the serialized message, without the rosserial frame around it
+  virtual int serializedLength() const = 0;
+};
+
+class Duration
+{
+public:
+  int32_t sec, nsec;
+  Duration() : sec(0), nsec(0)
+  {
+  }
+  Duration(int32_t s, int32_t n) : sec(s + n / 1000000000), nsec(n % 1000000000)
+  {
+  }
+};
+
+class Time
+{
+public:
+  uint32_t sec, nsec;
+  Time() : sec(0), nsec(0)
+  {
+  }
+  Time &operator+=(const Duration &d)
+  {
+    int64_t ns = toNsec() + static_cast<int64_t>(d.sec) * 1000000000 + d.nsec;
+    return fromNsec(ns);
+  }
+  Time &operator-=(const Duration &d)
+  {
+    int64_t ns = toNsec() - static_cast<int64_t>(d.sec) * 1000000000 - d.nsec;
+    return fromNsec(ns);
+  }
+
+private:
+  int64_t toNsec() const
+  {
+    return static_cast<int64_t>(sec) * 1000000000 + nsec;
+  }
+  Time &fromNsec(int64_t ns)
+  {
+    if (ns < 0)
+      ns = 0;
+    sec = ns / 1000000000;
+    nsec = ns % 1000000000;
+    return *this;
+  }
+};
+
+class SubscriberBase
+{
+public:
+  explicit SubscriberBase(const char *topic) : topic_(topic)
+  {
+  }
+  virtual ~SubscriberBase()
+  {
+  }
+  virtual void deliver(const void *msg) = 0;
+  const char *topic_;
+};
+
+template <typename MsgT>
+class Subscriber : public SubscriberBase
+{
+public:
+  typedef void (*CallbackT)(const MsgT &);
+  Subscriber(const char *topic, CallbackT cb, int endpoint = 0) : SubscriberBase(topic), cb_(cb)
+  {
+  }
+  void deliver(const void *msg)
+  {
+    cb_(*static_cast<const MsgT *>(msg));
+  }
+
+private:
+  CallbackT cb_;
+};
+
+class Publisher
+{
+public:
+  Publisher(const char *topic, Msg *msg, int endpoint = 0) : topic_(topic), count_(0)
+  {
+  }
+  int publish(const Msg *msg);
+  const char *topic_;
+  unsigned long count_;
+};
+
+class NodeHandle
+{
+public:
+  void initNode();
+  bool subscribe(SubscriberBase &s);
+  bool advertise(Publisher &p);
+  int spinOnce();
+  bool connected();
+  Time now();
+  bool getParam(const char *name, int *param, int length = 1, int timeout = 1000);
+  bool getParam(const char *name, float *param, int length = 1, int timeout = 1000);
+};
+}  // namespace ros
+
+#endif  // HARDWARE_ARDUINO_SIM_ROS_H
@@ -0,0 +1,23 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_SIM_STD_MSGS_FLOAT64_H
+#define HARDWARE_ARDUINO_SIM_STD_MSGS_FLOAT64_H
+
+#include <ros.h>
+
+namespace std_msgs
+{
+class Float64 : public ros::Msg
+{
+public:
+  double data;
+  Float64() : data(0)
+  {
+  }
+  int serializedLength() const
+  {
+    return 8;
+  }
+};
+}  // namespace std_msgs
+
+#endif  // HARDWARE_ARDUINO_SIM_STD_MSGS_FLOAT64_H
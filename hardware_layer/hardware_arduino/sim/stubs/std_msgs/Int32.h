@@ -0,0 +1,23 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_SIM_STD_MSGS_INT32_H
+#define HARDWARE_ARDUINO_SIM_STD_MSGS_INT32_H
+
+#include <ros.h>
+
+namespace std_msgs
+{
+class Int32 : public ros::Msg
+{
+public:
+  int32_t data;
+  Int32() : data(0)
+  {
+  }
+  int serializedLength() const
+  {
+    return 4;
+  }
+};
+}  // namespace std_msgs
+
+#endif  // HARDWARE_ARDUINO_SIM_STD_MSGS_INT32_H
@@ -1,362 +1,143 @@
 // Copyright 2016 AUV-IITK
 #include <ros.h>
 #include <Arduino.h>
-#include <std_msgs/Int32.h>
 #include <std_msgs/Float64.h>
+#include <hardware_arduino/ThrusterCommand.h>
+#include <hardware_arduino/DepthSample.h>
 #include <math.h>
 #include <Wire.h>
-#include "MS5837.h"
-
-#define pwmPinWest 3
-#define pwmPinEast 2
-#define directionPinWest1 30
-#define directionPinWest2 31
-#define directionPinEast1 33
-#define directionPinEast2 32
-
-#define pwmPinNorthSway 5
-#define pwmPinSouthSway 4
-#define directionPinNorthSway1 27
-#define directionPinNorthSway2 26
-#define directionPinSouthSway1 29
-#define directionPinSouthSway2 28
-
-#define pwmPinNorthUp 6
-#define pwmPinSouthUp 7
-#define directionPinNorthUp1 24
-#define directionPinNorthUp2 25
-#define directionPinSouthUp1 22
-#define directionPinSouthUp2 23
+#include "ms5837_async.h"
+#include "depth_filter.h"
+#include "hardware_arduino/thrusters.h"
+#include "thruster_output.h"
 
 #define analogPinPressureSensor A0
 
-const float c092 = 506.22;
-const float s092 = -2.65;
-const float c093 = 448.62;
-const float s093 = -2.92;
-const float c099 = 397.65;  // reference as their graph is at lowest
-const float s099 = -2.71;   // reference as their graph is at lowest
-const float c113 = 539.85;
-const float s113 = -3.38;
-const float c117 = 441.32;
-const float s117 = -3.03;
-const float c122 = 547.39;
-const float s122 = -2.93;
+MS5837Async sensor;
+DepthFilter depthFilter;
 
-MS5837 sensor;
+// publish periods in ms, overridden by the ~depth_rate and ~depth_sample_rate params once the host is connected
+unsigned long depthPublishInterval = 100;
+unsigned long depthSamplePublishInterval = 20;
+unsigned long lastDepthPublish = 0;
+unsigned long lastDepthSamplePublish = 0;
+bool paramsLoaded = false;
 
 int count, sum;
-bool isMovingForward = true;
+uint16_t lastSeq = 0;
 float v;
 std_msgs::Float64 voltage;
+hardware_arduino::DepthSample depthSample;
 ros::NodeHandle nh;
 
-int NormalizePWM(int pwm)
-{
-  return pwm * 53 / 255 + 147;
-}
-
-int NormalizeUpwardPWM(int pwm)
-{
-  return pwm * 73 / 255 + 147;
-}
-
-int btd092(int pwm)
-{
-  pwm = NormalizePWM(pwm);
-  if (pwm <= 147)
-  {
-    return 0;
-  }
-  pwm = (c099 + s099 * pwm - c092) / (s092);
-  return pwm;
-}
-
-int btd093(int pwm)
+// the host mixes all axes and sends every thruster once per control tick
+void PWMCbThrusters(const hardware_arduino::ThrusterCommand& msg)
 {
-  pwm = NormalizeUpwardPWM(pwm);
-  if (pwm <= 147)
+  // a frame repeating the last sequence number carries nothing new
+  if (msg.seq == lastSeq && msg.seq != 0)
   {
-    return 0;
+    return;
   }
-  pwm = (c099 + s099 * pwm - c093) / (s093);
-  return pwm;
+  lastSeq = msg.seq;
+  setThrusters(msg.pwm);
 }
 
-int btd099(int pwm)
-{
-  pwm = NormalizePWM(pwm);
-  if (pwm <= 147)
-  {
-    return 0;
-  }
-  return pwm;
-}
-
-int btd113(int pwm)
-{
-  pwm = NormalizePWM(pwm);
-  if (pwm <= 147)
-  {
-    return 0;
-  }
-  pwm = (c099 + s099 * pwm - c113) / (s113);
-  return pwm;
-}
-
-int btd117(int pwm)
-{
-  pwm = NormalizeUpwardPWM(pwm);
-  if (pwm <= 147)
-  {
-    return 0;
-  }
-  pwm = (c099 + s099 * pwm - c117) / (s117);
-  return pwm;
-}
-
-int btd122(int pwm)
-{
-  pwm = NormalizePWM(pwm);
-  if (pwm <= 147)
-  {
-    return 0;
-  }
-  pwm = (c099 + s099 * pwm - c122) / (s122);
-  return pwm;
-}
+ros::Subscriber<hardware_arduino::ThrusterCommand> subPwmThrusters("/pwm/thrusters", &PWMCbThrusters);
+ros::Publisher ps_voltage("/varun/sensors/pressure_sensor/depth", &voltage);
+ros::Publisher ps_depthSample("/varun/sensors/pressure_sensor/depth_sample", &depthSample);
 
-void thrusterNorthUp(int pwm, int isUpward)
+void setup()
 {
-  pwm = abs(pwm);
-  pwm = btd117(pwm);
-  analogWrite(pwmPinNorthUp, 255 - pwm);
-  if (isUpward)
-  {
-    digitalWrite(directionPinNorthUp1, HIGH);
-    digitalWrite(directionPinNorthUp2, LOW);
-  }
-  else
-  {
-    digitalWrite(directionPinNorthUp1, LOW);
-    digitalWrite(directionPinNorthUp2, HIGH);
-  }
-}
+  nh.initNode();
+  Wire.begin();
 
-void thrusterSouthUp(int pwm, int isUpward)
-{
-  pwm = abs(pwm);
-  pwm = btd093(pwm);
-  analogWrite(pwmPinSouthUp, 255 - pwm);
-  if (isUpward)
-  {
-    digitalWrite(directionPinSouthUp1, HIGH);
-    digitalWrite(directionPinSouthUp2, LOW);
-  }
-  else
-  {
-    digitalWrite(directionPinSouthUp1, LOW);
-    digitalWrite(directionPinSouthUp2, HIGH);
-  }
-}
+  sensor.init();
+  sensor.setFluidDensity(997);  // kg/m^3 (freshwater, 1029 for seawater)
+  sensor.setOversampling(MS5837Async::OSR_1024);
+  sensor.setTemperatureInterval(10);
+  setupThrusters();
 
-void thrusterNorthSway(int pwm, int isRight)
-{
-  pwm = abs(pwm);
-  pwm = btd113(pwm);
-  analogWrite(pwmPinNorthSway, 255 - pwm);
-  if (isRight)
-  {
-    digitalWrite(directionPinNorthSway1, HIGH);
-    digitalWrite(directionPinNorthSway2, LOW);
-  }
-  else
-  {
-    digitalWrite(directionPinNorthSway1, LOW);
-    digitalWrite(directionPinNorthSway2, HIGH);
-  }
+  nh.subscribe(subPwmThrusters);
+  nh.advertise(ps_voltage);
+  nh.advertise(ps_depthSample);
+  Serial.begin(57600);
+  stopThrusters();
+  count = 0;
+  sum = 0;
 }
 
-void thrusterSouthSway(int pwm, int isRight)
+void loadParams()
 {
-  pwm = abs(pwm);
-  pwm = btd122(pwm);
-  analogWrite(pwmPinSouthSway, 255 - pwm);
-  if (isRight)
+  int rate, osr, interval;
+  float gains[2];
+  if (nh.getParam("~depth_rate", &rate) && rate > 0)
   {
-    digitalWrite(directionPinSouthSway1, HIGH);
-    digitalWrite(directionPinSouthSway2, LOW);
+    depthPublishInterval = 1000 / rate;
   }
-  else
-  {
-    digitalWrite(directionPinSouthSway1, LOW);
-    digitalWrite(directionPinSouthSway2, HIGH);
-  }
-}
-
-void thrusterEast(int pwm, int isForward)
-{
-  pwm = abs(pwm);
-  pwm = btd092(pwm);
-  analogWrite(pwmPinEast, 255 - pwm);
-  if (isForward)
+  if (nh.getParam("~depth_sample_rate", &rate) && rate > 0)
   {
-    digitalWrite(directionPinEast1, HIGH);
-    digitalWrite(directionPinEast2, LOW);
+    depthSamplePublishInterval = 1000 / rate;
   }
-  else
+  // ratio as in the datasheet, 256 to 8192
+  if (nh.getParam("~depth_osr", &osr))
   {
-    digitalWrite(directionPinEast1, LOW);
-    digitalWrite(directionPinEast2, HIGH);
+    int i = MS5837Async::OSR_256;
+    while (i < MS5837Async::OSR_8192 && (256 << i) < osr)
+    {
+      i++;
+    }
+    sensor.setOversampling(static_cast<MS5837Async::Oversampling>(i));
   }
-}
-
-void thrusterWest(int pwm, int isForward)
-{
-  pwm = abs(pwm);
-  pwm = btd099(pwm);
-  analogWrite(pwmPinWest, 255 - pwm);
-  if (isForward)
+  if (nh.getParam("~temperature_interval", &interval))
   {
-    digitalWrite(directionPinWest1, HIGH);
-    digitalWrite(directionPinWest2, LOW);
+    sensor.setTemperatureInterval(interval);
   }
-  else
+  if (nh.getParam("~depth_filter_gains", gains, 2))
   {
-    digitalWrite(directionPinWest1, LOW);
-    digitalWrite(directionPinWest2, HIGH);
+    depthFilter.setGains(gains[0], gains[1]);
   }
+  paramsLoaded = true;
 }
 
-void PWMCbForward(const std_msgs::Int32& msg)
+void publishDepthSample()
 {
-  if (msg.data > 0)
-  {
-    thrusterEast(msg.data, true);
-    thrusterWest(msg.data, true);
-  }
-  else
-  {
-    thrusterEast(msg.data, false);
-    thrusterWest(msg.data, false);
-  }
-  isMovingForward = true;
+  // the filter time is on micros(), move it back from the synced ros time by the age of the sample
+  depthSample.stamp = nh.now();
+  depthSample.stamp -= ros::Duration(0, (micros() - depthFilter.time()) * 1000);
+  depthSample.depth = depthFilter.depth();
+  depthSample.depth_rate = depthFilter.rate();
+  depthSample.temperature = sensor.temperature();
+  ps_depthSample.publish(&depthSample);
 }
 
-void PWMCbSideward(const std_msgs::Int32& msg)
+// nothing in here may block, thruster commands are only serviced by spinOnce
+void loop()
 {
-  if (msg.data > 0)
-  {
-    thrusterNorthSway(msg.data, true);
-    thrusterSouthSway(msg.data, true);
-  }
-  else
+  nh.spinOnce();
+  if (!paramsLoaded && nh.connected())
   {
-    thrusterNorthSway(msg.data, false);
-    thrusterSouthSway(msg.data, false);
+    loadParams();
   }
-  isMovingForward = false;
-}
 
-void PWMCbUpward(const std_msgs::Int32& msg)
-{
-  if (msg.data > 0)
+  if (sensor.update())
   {
-    thrusterNorthUp(msg.data, true);
-    thrusterSouthUp(msg.data, true);
+    depthFilter.update(sensor.depth(), sensor.sampleTime());
   }
-  else
+  if (!depthFilter.valid())
   {
-    thrusterNorthUp(msg.data, false);
-    thrusterSouthUp(msg.data, false);
+    return;
   }
-}
 
-void PWMCbTurn(const std_msgs::Int32& msg)
-{
-  if (!isMovingForward)
+  unsigned long now = millis();
+  if (now - lastDepthSamplePublish >= depthSamplePublishInterval)
   {
-    if (msg.data > 0)
-    {
-      thrusterEast(msg.data, true);
-      thrusterWest(msg.data, false);
-    }
-    else
-    {
-      thrusterEast(msg.data, false);
-      thrusterWest(msg.data, true);
-    }
+    lastDepthSamplePublish = now;
+    publishDepthSample();
   }
-  else
+  if (now - lastDepthPublish >= depthPublishInterval)
   {
-    if (msg.data > 0)
-    {
-      thrusterNorthSway(msg.data, false);
-      thrusterSouthSway(msg.data, true);
-    }
-    else
-    {
-      thrusterNorthSway(msg.data, true);
-      thrusterSouthSway(msg.data, false);
-    }
+    lastDepthPublish = now;
+    voltage.data = depthFilter.depth() * 100;
+    ps_voltage.publish(&voltage);
   }
 }
-
-ros::Subscriber<std_msgs::Int32> subPwmForward("/pwm/forward", &PWMCbForward);
-ros::Subscriber<std_msgs::Int32> subPwmSideward("/pwm/sideward", &PWMCbSideward);
-ros::Subscriber<std_msgs::Int32> subPwmUpward("/pwm/upward", &PWMCbUpward);
-ros::Subscriber<std_msgs::Int32> subPwmTurn("/pwm/turn", &PWMCbTurn);
-ros::Publisher ps_voltage("/varun/sensors/pressure_sensor/depth", &voltage);
-
-void setup()
-{
-  nh.initNode();
-  Wire.begin();
-
-  sensor.init();
-  
-  sensor.setFluidDensity(997); // kg/m^3 (freshwater, 1029 for seawater)
-  pinMode(pwmPinEast, OUTPUT);
-  pinMode(directionPinEast1, OUTPUT);
-  pinMode(directionPinEast2, OUTPUT);
-  pinMode(pwmPinWest, OUTPUT);
-  pinMode(directionPinWest1, OUTPUT);
-  pinMode(directionPinWest2, OUTPUT);
-
-  pinMode(directionPinSouthSway1, OUTPUT);
-  pinMode(directionPinSouthSway2, OUTPUT);
-  pinMode(pwmPinNorthSway, OUTPUT);
-  pinMode(directionPinNorthSway2, OUTPUT);
-  pinMode(pwmPinSouthSway, OUTPUT);
-  pinMode(directionPinNorthSway1, OUTPUT);
-
-  pinMode(directionPinSouthUp1, OUTPUT);
-  pinMode(directionPinSouthUp2, OUTPUT);
-  pinMode(pwmPinNorthUp, OUTPUT);
-  pinMode(directionPinNorthUp2, OUTPUT);
-  pinMode(pwmPinSouthUp, OUTPUT);
-  pinMode(directionPinNorthUp1, OUTPUT);
-
-  nh.subscribe(subPwmForward);
-  nh.subscribe(subPwmSideward);
-  nh.subscribe(subPwmUpward);
-  nh.subscribe(subPwmTurn);
-  nh.advertise(ps_voltage);
-  Serial.begin(57600);
-  std_msgs::Int32 msg;
-  msg.data = 0;
-  PWMCbForward(msg);
-  PWMCbSideward(msg);
-  PWMCbUpward(msg);
-  PWMCbTurn(msg);
-  count = 0;
-  sum = 0;
-}
-
-void loop()
-{
-  sensor.read();
-  ps_voltage.publish(sensor.depth()*100);
-  delay(200);
-  nh.spinOnce();
-}
@@ -0,0 +1,97 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_DEPTH_FILTER_H
+#define HARDWARE_ARDUINO_DEPTH_FILTER_H
+
+#include <Arduino.h>
+
+/*! \file
+* \brief Depth and depth rate from raw MS5837 samples
+*
+* A median of the last three samples drops single spikes (bubbles, I2C glitches), then an alpha-beta filter tracks
+* depth and its rate together. The rate is what the heave controller uses as derivative, so it is estimated here at
+* the sampling rate instead of differencing published depths on the host.
+*/
+class DepthFilter
+{
+public:
+  DepthFilter() : next_(0), count_(0), alpha_(0.2), beta_(0.005), depth_(0), rate_(0), time_(0)
+  {
+  }
+
+  // alpha weighs the depth residual, beta the rate correction; both in (0, 1)
+  void setGains(float alpha, float beta)
+  {
+    alpha_ = alpha;
+    beta_ = beta;
+  }
+
+  // depth in m, time in micros() of the sample
+  void update(float depth, unsigned long time)
+  {
+    window_[next_] = depth;
+    next_ = (next_ + 1) % 3;
+    if (count_ < 3)
+      count_++;
+    if (count_ < 3)
+    {
+      depth_ = depth;
+      time_ = time;
+      return;
+    }
+
+    float dt = (time - time_) * 1e-6;
+    time_ = time;
+    if (dt <= 0)
+      return;
+    float predicted = depth_ + rate_ * dt;
+    float residual = median(window_[0], window_[1], window_[2]) - predicted;
+    depth_ = predicted + alpha_ * residual;
+    rate_ += beta_ * residual / dt;
+  }
+
+  bool valid() const
+  {
+    return count_ >= 3;
+  }
+
+  float depth() const
+  {
+    return depth_;
+  }
+
+  float rate() const
+  {
+    return rate_;
+  }
+
+  unsigned long time() const
+  {
+    return time_;
+  }
+
+private:
+  float window_[3];
+  uint8_t next_;
+  uint8_t count_;
+  float alpha_, beta_;
+  float depth_, rate_;
+  unsigned long time_;
+
+  static float median(float a, float b, float c)
+  {
+    if (a > b)
+    {
+      float t = a;
+      a = b;
+      b = t;
+    }
+    // a <= b now
+    if (c < a)
+      return a;
+    if (c > b)
+      return b;
+    return c;
+  }
+};
+
+#endif  // HARDWARE_ARDUINO_DEPTH_FILTER_H
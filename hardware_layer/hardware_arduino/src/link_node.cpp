@@ -0,0 +1,138 @@
+// Copyright 2016 AUV-IITK
+// Same job as arduino_node.cpp, but talks the framed protocol of link_protocol.h to host/link_bridge.cpp instead of
+// rosserial
+#include <Arduino.h>
+#include <Wire.h>
+#include "hardware_arduino/link_protocol.h"
+#include "ms5837_async.h"
+#include "depth_filter.h"
+#include "thruster_output.h"
+
+MS5837Async sensor;
+DepthFilter depthFilter;
+LinkFrameReader reader;
+LinkFrameWriter writer;
+uint8_t encoded[linkMaxEncoded];
+
+uint8_t txSeq = 0;
+uint16_t lastSeq = 0;
+bool commandSeen = false;
+LinkThrusters applied;
+
+// replaced by the first LINK_CONFIG from the bridge
+unsigned long telemetryInterval = 20;
+unsigned long commandTimeout = 500;
+unsigned long lastTelemetry = 0;
+unsigned long lastCommand = 0;
+
+void applyThrusters(const LinkThrusters &cmd)
+{
+  lastCommand = millis();
+  // a frame repeating the last sequence number carries nothing new
+  if (commandSeen && cmd.seq == lastSeq && cmd.seq != 0)
+  {
+    return;
+  }
+  commandSeen = true;
+  lastSeq = cmd.seq;
+  applied = cmd;
+  // the packed struct may leave pwm unaligned
+  int16_t pwm[THRUSTER_COUNT];
+  memcpy(pwm, cmd.pwm, sizeof(pwm));
+  setThrusters(pwm);
+}
+
+void applyConfig(const LinkConfig &config)
+{
+  sensor.setOversampling(static_cast<MS5837Async::Oversampling>(config.depthOsr));
+  sensor.setTemperatureInterval(config.temperatureInterval);
+  depthFilter.setGains(config.filterAlpha, config.filterBeta);
+  if (config.telemetryInterval > 0)
+  {
+    telemetryInterval = config.telemetryInterval;
+  }
+  commandTimeout = config.commandTimeout;
+}
+
+void handleFrame()
+{
+  uint8_t type, length;
+  const uint8_t *payload;
+  while (reader.next(type, payload, length))
+  {
+    if (type == LINK_THRUSTERS && length == sizeof(LinkThrusters))
+    {
+      LinkThrusters cmd;
+      memcpy(&cmd, payload, sizeof(cmd));
+      applyThrusters(cmd);
+    }
+    else if (type == LINK_CONFIG && length == sizeof(LinkConfig))
+    {
+      LinkConfig config;
+      memcpy(&config, payload, sizeof(config));
+      applyConfig(config);
+    }
+  }
+}
+
+// depth and the applied thruster command go out together in one frame
+void sendTelemetry()
+{
+  writer.begin(txSeq++, micros());
+  if (depthFilter.valid())
+  {
+    LinkDepth depth;
+    depth.sampleMicros = depthFilter.time();
+    depth.depth = depthFilter.depth();
+    depth.depthRate = depthFilter.rate();
+    depth.temperature = sensor.temperature();
+    writer.add(LINK_DEPTH, &depth, sizeof(depth));
+  }
+  writer.add(LINK_THRUSTER_ECHO, &applied, sizeof(applied));
+  Serial.write(encoded, writer.finish(encoded));
+}
+
+void setup()
+{
+  Serial.begin(linkBaud);
+  Wire.begin();
+
+  sensor.init();
+  sensor.setFluidDensity(997);  // kg/m^3 (freshwater, 1029 for seawater)
+  sensor.setOversampling(MS5837Async::OSR_1024);
+  sensor.setTemperatureInterval(10);
+  setupThrusters();
+  stopThrusters();
+  memset(&applied, 0, sizeof(applied));
+}
+
+// nothing in here may block, commands are read on every pass
+void loop()
+{
+  while (Serial.available() > 0)
+  {
+    if (reader.push(Serial.read()))
+    {
+      handleFrame();
+    }
+  }
+
+  if (sensor.update())
+  {
+    depthFilter.update(sensor.depth(), sensor.sampleTime());
+  }
+
+  unsigned long now = millis();
+  // host gone quiet, do not keep driving on the last command
+  if (commandTimeout > 0 && commandSeen && now - lastCommand > commandTimeout)
+  {
+    stopThrusters();
+    memset(applied.pwm, 0, sizeof(applied.pwm));
+    commandSeen = false;
+  }
+  if (now - lastTelemetry >= telemetryInterval)
+  {
+    lastTelemetry = now;
+    sendTelemetry();
+  }
+}
@@ -0,0 +1,255 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_MS5837_ASYNC_H
+#define HARDWARE_ARDUINO_MS5837_ASYNC_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+/*! \file
+* \brief Non blocking driver for the MS5837-30BA pressure sensor
+*
+* The BlueRobotics library blocks for two 20 ms conversions inside read(). Here a conversion is started, the main
+* loop keeps running, and the ADC is collected once the conversion time has passed. The next conversion is started
+* in the same call, so the sensor is never idle. Temperature moves slowly, so D2 is only converted once every few
+* pressure conversions and the latest one is reused in between. The compensation math is the one from the datasheet,
+* same as the library.
+*/
+class MS5837Async
+{
+public:
+  enum Oversampling
+  {
+    OSR_256 = 0,
+    OSR_512,
+    OSR_1024,
+    OSR_2048,
+    OSR_4096,
+    OSR_8192
+  };
+
+  MS5837Async()
+    : state_(IDLE)
+    , osr_(OSR_8192)
+    , temperatureInterval_(1)
+    , sinceTemperature_(0)
+    , fluidDensity_(1029)
+    , valid_(false)
+    , D1_(0)
+    , D2_(0)
+    , P_(0)
+    , TEMP_(0)
+  {
+  }
+
+  // blocking, only called from setup()
+  bool init()
+  {
+    command(CMD_RESET);
+    delay(10);
+    for (uint8_t i = 0; i < 7; i++)
+    {
+      Wire.beginTransmission(ADDR);
+      Wire.write(CMD_PROM_READ + i * 2);
+      Wire.endTransmission();
+      Wire.requestFrom(ADDR, 2);
+      C_[i] = (Wire.read() << 8) | Wire.read();
+    }
+    uint8_t crcRead = C_[0] >> 12;
+    return crcRead == crc4(C_);
+  }
+
+  // kg/m^3, 997 for freshwater and 1029 for seawater
+  void setFluidDensity(float density)
+  {
+    fluidDensity_ = density;
+  }
+
+  // higher ratios are less noisy but slower, from 0.6 ms at OSR_256 to 20 ms at OSR_8192 per conversion
+  void setOversampling(Oversampling osr)
+  {
+    osr_ = osr;
+  }
+
+  // one temperature conversion for every n pressure conversions
+  void setTemperatureInterval(uint8_t n)
+  {
+    temperatureInterval_ = n > 0 ? n : 1;
+  }
+
+  // advances the conversion pipeline, returns true when a new pressure sample has been computed
+  bool update()
+  {
+    unsigned long now = micros();
+    if (state_ == IDLE)
+    {
+      // compensation needs a temperature before the first pressure
+      start(CONVERTING_D2, now);
+      return false;
+    }
+    if (now - started_ < conversionTime_)
+      return false;
+
+    bool fresh = false;
+    State next = CONVERTING_D1;
+    if (state_ == CONVERTING_D2)
+    {
+      D2_ = readADC();
+    }
+    else
+    {
+      D1_ = readADC();
+      sampleTime_ = started_ + conversionTime_ / 2;
+      calculate();
+      valid_ = true;
+      fresh = true;
+      if (++sinceTemperature_ >= temperatureInterval_)
+      {
+        sinceTemperature_ = 0;
+        next = CONVERTING_D2;
+      }
+    }
+    // reading the ADC took a few hundred us of I2C, the next conversion starts from here
+    start(next, micros());
+    return fresh;
+  }
+
+  // micros() at the middle of the conversion behind the newest pressure sample
+  unsigned long sampleTime() const
+  {
+    return sampleTime_;
+  }
+
+  bool valid() const
+  {
+    return valid_;
+  }
+
+  float pressure() const  // Pa
+  {
+    return P_ * 10.0f;
+  }
+
+  float temperature() const  // deg C
+  {
+    return TEMP_ / 100.0f;
+  }
+
+  float depth() const  // m
+  {
+    return (pressure() - 101300) / (fluidDensity_ * 9.80665);
+  }
+
+private:
+  enum State
+  {
+    IDLE,
+    CONVERTING_D1,
+    CONVERTING_D2
+  };
+
+  static const uint8_t ADDR = 0x76;
+  static const uint8_t CMD_RESET = 0x1E;
+  static const uint8_t CMD_ADC_READ = 0x00;
+  static const uint8_t CMD_PROM_READ = 0xA0;
+  static const uint8_t CMD_CONVERT_D1 = 0x40;  // + 2 * osr
+  static const uint8_t CMD_CONVERT_D2 = 0x50;  // + 2 * osr
+
+  State state_;
+  Oversampling osr_;
+  uint8_t temperatureInterval_;
+  uint8_t sinceTemperature_;
+  unsigned long started_;
+  unsigned long conversionTime_;
+  unsigned long sampleTime_;
+  float fluidDensity_;
+  bool valid_;
+  uint16_t C_[8];
+  uint32_t D1_, D2_;
+  int32_t P_, TEMP_;
+
+  // a new oversampling ratio only applies from the next conversion on
+  void start(State state, unsigned long now)
+  {
+    // datasheet maximum conversion time with some margin
+    static const uint16_t us[] = { 600, 1200, 2300, 4600, 9100, 20000 };
+    command((state == CONVERTING_D1 ? CMD_CONVERT_D1 : CMD_CONVERT_D2) + 2 * osr_);
+    conversionTime_ = us[osr_];
+    started_ = now;
+    state_ = state;
+  }
+
+  void command(uint8_t cmd)
+  {
+    Wire.beginTransmission(ADDR);
+    Wire.write(cmd);
+    Wire.endTransmission();
+  }
+
+  uint32_t readADC()
+  {
+    command(CMD_ADC_READ);
+    Wire.requestFrom(ADDR, 3);
+    uint32_t value = Wire.read();
+    value = (value << 8) | Wire.read();
+    value = (value << 8) | Wire.read();
+    return value;
+  }
+
+  // first and second order compensation from the MS5837-30BA datasheet
+  void calculate()
+  {
+    int32_t dT = D2_ - uint32_t(C_[5]) * 256l;
+    int64_t SENS = int64_t(C_[1]) * 32768l + (int64_t(C_[3]) * dT) / 256l;
+    int64_t OFF = int64_t(C_[2]) * 65536l + (int64_t(C_[4]) * dT) / 128l;
+    TEMP_ = 2000l + int64_t(dT) * C_[6] / 8388608LL;
+
+    int32_t Ti, OFFi, SENSi;
+    if ((TEMP_ / 100) < 20)
+    {
+      Ti = (3 * int64_t(dT) * int64_t(dT)) / (8589934592LL);
+      OFFi = (3 * (TEMP_ - 2000) * (TEMP_ - 2000)) / 2;
+      SENSi = (5 * (TEMP_ - 2000) * (TEMP_ - 2000)) / 8;
+      if ((TEMP_ / 100) < -15)
+      {
+        OFFi = OFFi + 7 * (TEMP_ + 1500l) * (TEMP_ + 1500l);
+        SENSi = SENSi + 4 * (TEMP_ + 1500l) * (TEMP_ + 1500l);
+      }
+    }
+    else
+    {
+      Ti = 2 * (int64_t(dT) * dT) / (137438953472LL);
+      OFFi = (1 * (TEMP_ - 2000) * (TEMP_ - 2000)) / 16;
+      SENSi = 0;
+    }
+
+    int64_t OFF2 = OFF - OFFi;
+    int64_t SENS2 = SENS - SENSi;
+    TEMP_ = TEMP_ - Ti;
+    P_ = (((D1_ * SENS2) / 2097152l - OFF2) / 8192l);
+  }
+
+  static uint8_t crc4(uint16_t n_prom[])
+  {
+    uint16_t n_rem = 0;
+    n_prom[0] = n_prom[0] & 0x0FFF;
+    n_prom[7] = 0;
+    for (uint8_t i = 0; i < 16; i++)
+    {
+      if (i % 2 == 1)
+        n_rem ^= static_cast<uint16_t>(n_prom[i >> 1] & 0x00FF);
+      else
+        n_rem ^= static_cast<uint16_t>(n_prom[i >> 1] >> 8);
+      for (uint8_t n_bit = 8; n_bit > 0; n_bit--)
+      {
+        if (n_rem & 0x8000)
+          n_rem = (n_rem << 1) ^ 0x3000;
+        else
+          n_rem = (n_rem << 1);
+      }
+    }
+    n_rem = ((n_rem >> 12) & 0x000F);
+    return n_rem ^ 0x00;
+  }
+};
+
+#endif  // HARDWARE_ARDUINO_MS5837_ASYNC_H
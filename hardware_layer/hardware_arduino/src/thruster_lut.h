@@ -0,0 +1,60 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_THRUSTER_LUT_H
+#define HARDWARE_ARDUINO_THRUSTER_LUT_H
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+#include "hardware_arduino/thrusters.h"
+
+/*! \file
+* \brief Thruster linearization tables kept in flash
+*
+* Every entry is evaluated by the compiler from the curves in thrusters.h, so the firmware does no float math when a
+* command arrives. An entry holds exactly what NormalizePWM followed by the btd0xx remap used to return.
+*/
+
+constexpr int normalizedCommand(int pwm, int span)
+{
+  return pwm * span / 255 + normalizeOffset;
+}
+
+// float to int conversion truncates, as the old int assignment did
+constexpr uint8_t clampedOutput(float out)
+{
+  return out <= 0 ? 0 : (out >= thrusterMaxPWM ? thrusterMaxPWM : static_cast<uint8_t>(out));
+}
+
+constexpr uint8_t linearizedEntry(int pwm, ThrusterCurve curve)
+{
+  return normalizedCommand(pwm, curve.span) <= normalizeOffset ?
+             0 :
+             // the reference thruster passes straight through
+             (curve.c == c099 && curve.s == s099) ?
+             clampedOutput(normalizedCommand(pwm, curve.span)) :
+             clampedOutput((c099 + s099 * normalizedCommand(pwm, curve.span) - curve.c) / curve.s);
+}
+
+#define THRUSTER_LUT_4(t, i)                                                                                           \
+  linearizedEntry((i), thrusterCurves[t]), linearizedEntry((i) + 1, thrusterCurves[t]),                                \
+      linearizedEntry((i) + 2, thrusterCurves[t]), linearizedEntry((i) + 3, thrusterCurves[t])
+#define THRUSTER_LUT_16(t, i)                                                                                          \
+  THRUSTER_LUT_4(t, i), THRUSTER_LUT_4(t, (i) + 4), THRUSTER_LUT_4(t, (i) + 8), THRUSTER_LUT_4(t, (i) + 12)
+#define THRUSTER_LUT_64(t, i)                                                                                          \
+  THRUSTER_LUT_16(t, i), THRUSTER_LUT_16(t, (i) + 16), THRUSTER_LUT_16(t, (i) + 32), THRUSTER_LUT_16(t, (i) + 48)
+#define THRUSTER_LUT(t) THRUSTER_LUT_64(t, 0), THRUSTER_LUT_64(t, 64), THRUSTER_LUT_64(t, 128), THRUSTER_LUT_64(t, 192)
+
+const uint8_t thrusterLUT[THRUSTER_COUNT][thrusterMaxPWM + 1] PROGMEM = {
+  { THRUSTER_LUT(THRUSTER_EAST) },       { THRUSTER_LUT(THRUSTER_WEST) },     { THRUSTER_LUT(THRUSTER_NORTH_SWAY) },
+  { THRUSTER_LUT(THRUSTER_SOUTH_SWAY) }, { THRUSTER_LUT(THRUSTER_NORTH_UP) }, { THRUSTER_LUT(THRUSTER_SOUTH_UP) },
+};
+
+// one flash read per command, the sign of pwm only selects the direction pins
+inline uint8_t linearizedPWM(int thruster, int pwm)
+{
+  pwm = abs(pwm);
+  if (pwm > thrusterMaxPWM)
+    pwm = thrusterMaxPWM;
+  return pgm_read_byte(&thrusterLUT[thruster][pwm]);
+}
+
+#endif  // HARDWARE_ARDUINO_THRUSTER_LUT_H
@@ -0,0 +1,175 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_ARDUINO_THRUSTER_OUTPUT_H
+#define HARDWARE_ARDUINO_THRUSTER_OUTPUT_H
+
+#include <Arduino.h>
+#include "hardware_arduino/thrusters.h"
+#include "thruster_lut.h"
+
+/*! \file
+* \brief Pins and drive functions of the six thrusters, shared by every firmware that moves the vehicle
+*/
+
+#define pwmPinWest 3
+#define pwmPinEast 2
+#define directionPinWest1 30
+#define directionPinWest2 31
+#define directionPinEast1 33
+#define directionPinEast2 32
+
+#define pwmPinNorthSway 5
+#define pwmPinSouthSway 4
+#define directionPinNorthSway1 27
+#define directionPinNorthSway2 26
+#define directionPinSouthSway1 29
+#define directionPinSouthSway2 28
+
+#define pwmPinNorthUp 6
+#define pwmPinSouthUp 7
+#define directionPinNorthUp1 24
+#define directionPinNorthUp2 25
+#define directionPinSouthUp1 22
+#define directionPinSouthUp2 23
+
+inline void thrusterNorthUp(int pwm, int isUpward)
+{
+  pwm = linearizedPWM(THRUSTER_NORTH_UP, pwm);
+  analogWrite(pwmPinNorthUp, 255 - pwm);
+  if (isUpward)
+  {
+    digitalWrite(directionPinNorthUp1, HIGH);
+    digitalWrite(directionPinNorthUp2, LOW);
+  }
+  else
+  {
+    digitalWrite(directionPinNorthUp1, LOW);
+    digitalWrite(directionPinNorthUp2, HIGH);
+  }
+}
+
+inline void thrusterSouthUp(int pwm, int isUpward)
+{
+  pwm = linearizedPWM(THRUSTER_SOUTH_UP, pwm);
+  analogWrite(pwmPinSouthUp, 255 - pwm);
+  if (isUpward)
+  {
+    digitalWrite(directionPinSouthUp1, HIGH);
+    digitalWrite(directionPinSouthUp2, LOW);
+  }
+  else
+  {
+    digitalWrite(directionPinSouthUp1, LOW);
+    digitalWrite(directionPinSouthUp2, HIGH);
+  }
+}
+
+inline void thrusterNorthSway(int pwm, int isRight)
+{
+  pwm = linearizedPWM(THRUSTER_NORTH_SWAY, pwm);
+  analogWrite(pwmPinNorthSway, 255 - pwm);
+  if (isRight)
+  {
+    digitalWrite(directionPinNorthSway1, HIGH);
+    digitalWrite(directionPinNorthSway2, LOW);
+  }
+  else
+  {
+    digitalWrite(directionPinNorthSway1, LOW);
+    digitalWrite(directionPinNorthSway2, HIGH);
+  }
+}
+
+inline void thrusterSouthSway(int pwm, int isRight)
+{
+  pwm = linearizedPWM(THRUSTER_SOUTH_SWAY, pwm);
+  analogWrite(pwmPinSouthSway, 255 - pwm);
+  if (isRight)
+  {
+    digitalWrite(directionPinSouthSway1, HIGH);
+    digitalWrite(directionPinSouthSway2, LOW);
+  }
+  else
+  {
+    digitalWrite(directionPinSouthSway1, LOW);
+    digitalWrite(directionPinSouthSway2, HIGH);
+  }
+}
+
+inline void thrusterEast(int pwm, int isForward)
+{
+  pwm = linearizedPWM(THRUSTER_EAST, pwm);
+  analogWrite(pwmPinEast, 255 - pwm);
+  if (isForward)
+  {
+    digitalWrite(directionPinEast1, HIGH);
+    digitalWrite(directionPinEast2, LOW);
+  }
+  else
+  {
+    digitalWrite(directionPinEast1, LOW);
+    digitalWrite(directionPinEast2, HIGH);
+  }
+}
+
+inline void thrusterWest(int pwm, int isForward)
+{
+  pwm = linearizedPWM(THRUSTER_WEST, pwm);
+  analogWrite(pwmPinWest, 255 - pwm);
+  if (isForward)
+  {
+    digitalWrite(directionPinWest1, HIGH);
+    digitalWrite(directionPinWest2, LOW);
+  }
+  else
+  {
+    digitalWrite(directionPinWest1, LOW);
+    digitalWrite(directionPinWest2, HIGH);
+  }
+}
+
+inline void stopThrusters()
+{
+  thrusterEast(0, false);
+  thrusterWest(0, false);
+  thrusterNorthSway(0, false);
+  thrusterSouthSway(0, false);
+  thrusterNorthUp(0, false);
+  thrusterSouthUp(0, false);
+}
+
+// pwm in Thruster order, signed as in ThrusterCommand
+inline void setThrusters(const int16_t pwm[THRUSTER_COUNT])
+{
+  thrusterEast(pwm[THRUSTER_EAST], pwm[THRUSTER_EAST] > 0);
+  thrusterWest(pwm[THRUSTER_WEST], pwm[THRUSTER_WEST] > 0);
+  thrusterNorthSway(pwm[THRUSTER_NORTH_SWAY], pwm[THRUSTER_NORTH_SWAY] > 0);
+  thrusterSouthSway(pwm[THRUSTER_SOUTH_SWAY], pwm[THRUSTER_SOUTH_SWAY] > 0);
+  thrusterNorthUp(pwm[THRUSTER_NORTH_UP], pwm[THRUSTER_NORTH_UP] > 0);
+  thrusterSouthUp(pwm[THRUSTER_SOUTH_UP], pwm[THRUSTER_SOUTH_UP] > 0);
+}
+
+inline void setupThrusters()
+{
+  pinMode(pwmPinEast, OUTPUT);
+  pinMode(directionPinEast1, OUTPUT);
+  pinMode(directionPinEast2, OUTPUT);
+  pinMode(pwmPinWest, OUTPUT);
+  pinMode(directionPinWest1, OUTPUT);
+  pinMode(directionPinWest2, OUTPUT);
+
+  pinMode(directionPinSouthSway1, OUTPUT);
+  pinMode(directionPinSouthSway2, OUTPUT);
+  pinMode(pwmPinNorthSway, OUTPUT);
+  pinMode(directionPinNorthSway2, OUTPUT);
+  pinMode(pwmPinSouthSway, OUTPUT);
+  pinMode(directionPinNorthSway1, OUTPUT);
+
+  pinMode(directionPinSouthUp1, OUTPUT);
+  pinMode(directionPinSouthUp2, OUTPUT);
+  pinMode(pwmPinNorthUp, OUTPUT);
+  pinMode(directionPinNorthUp2, OUTPUT);
+  pinMode(pwmPinSouthUp, OUTPUT);
+  pinMode(directionPinNorthUp1, OUTPUT);
+}
+
+#endif  // HARDWARE_ARDUINO_THRUSTER_OUTPUT_H
@@ -0,0 +1,153 @@
+// Copyright 2016 AUV-IITK
+#include <ros/ros.h>
+#include <image_transport/image_transport.h>
+#include <opencv2/highgui/highgui.hpp>
+#include <cv_bridge/cv_bridge.h>
+#include <message_filters/synchronizer.h>
+#include <message_filters/sync_policies/approximate_time.h>
+#include <sensor_msgs/Image.h>
+#include <hardware_camera/ImagePair.h>
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/trace.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Every camera of the vehicle in one process, each read by a thread of its own so a slow or stalled camera does not
+// hold up the others, and one that cannot be opened is retried without taking the rest down. A frame is stamped the
+// moment grab() hands it over, before it is decoded, from the clock all threads share, so stamps of different cameras
+// compare. Each camera goes out on its own image topic as with vid_pub. The two cameras in ~pair also go out together
+// on ~pair_topic, matched by the approximate time policy of message_filters, for whoever needs both views of one
+// moment: the vision scheduler runs the front and the bottom detectors of a task on the frames of one pair.
+
+typedef message_filters::sync_policies::ApproximateTime<sensor_msgs::Image, sensor_msgs::Image> PairPolicy;
+
+struct Camera
+{
+  std::string name;
+  std::string topic;
+  int device;
+  int pairIndex;  // position in the pair, -1 if the camera is not in it
+  image_transport::Publisher pub;
+};
+
+message_filters::Synchronizer<PairPolicy> *pairs = 0;
+ros::Publisher pairPub;
+std::vector<std::string> pairTopics;
+
+// called by the capture thread whose frame completed the pair
+void pairCb(const sensor_msgs::ImageConstPtr &first, const sensor_msgs::ImageConstPtr &second)
+{
+  // the pair copies both frames, not worth it for nobody
+  if (pairPub.getNumSubscribers() == 0)
+    return;
+  hardware_camera::ImagePair pair;
+  pair.header.stamp = std::max(first->header.stamp, second->header.stamp);
+  pair.topics = pairTopics;
+  pair.images.push_back(*first);
+  pair.images.push_back(*second);
+  pairPub.publish(pair);
+}
+
+void capture(Camera *camera)
+{
+  cv::VideoCapture cap;
+  cv::Mat frame;
+  // the stamp is when the frame came out of the driver and doubles as its trace id, see hardware_commons/trace.h
+  std_msgs::Header header;
+  header.frame_id = "camera" + std::to_string(camera->device);
+  while (ros::ok())
+  {
+    if (!cap.isOpened() && !cap.open(camera->device))
+    {
+      ROS_WARN_THROTTLE(10, "camera_pub: cannot open %s (device %d), retrying", camera->name.c_str(), camera->device);
+      ros::WallDuration(1).sleep();
+      continue;
+    }
+    if (!cap.grab())
+    {
+      ROS_WARN("camera_pub: %s stopped delivering frames, reopening it", camera->name.c_str());
+      cap.release();
+      continue;
+    }
+    header.stamp = ros::Time::now();
+    hardware_commons::trace::Span span("capture", header.stamp.toNSec());
+    if (!cap.retrieve(frame) || frame.empty())
+      continue;
+    sensor_msgs::ImageConstPtr msg = cv_bridge::CvImage(header, "bgr8", frame).toImageMsg();
+    camera->pub.publish(msg);
+    header.seq++;
+    if (camera->pairIndex == 0)
+      pairs->add<0>(msg);
+    else if (camera->pairIndex == 1)
+      pairs->add<1>(msg);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "camera_pub");
+  ros::NodeHandle nh;
+  ros::NodeHandle pnh("~");
+  std::vector<std::string> names, pair;
+  std::string pairTopic;
+  double pairSlop = 0.05;
+  int pairQueue = 5;
+  pnh.getParam("cameras", names);
+  pnh.getParam("pair", pair);
+  pnh.getParam("pair_topic", pairTopic);
+  pnh.getParam("pair_slop", pairSlop);
+  pnh.getParam("pair_queue", pairQueue);
+  if (names.empty())
+  {
+    ROS_ERROR("camera_pub: no cameras in ~cameras");
+    return 1;
+  }
+
+  image_transport::ImageTransport it(nh);
+  std::vector<Camera> cameras(names.size());
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    Camera &camera = cameras[i];
+    camera.name = names[i];
+    if (!pnh.getParam(names[i] + "/device", camera.device) || !pnh.getParam(names[i] + "/topic", camera.topic))
+    {
+      ROS_ERROR("camera_pub: %s needs ~%s/device and ~%s/topic", names[i].c_str(), names[i].c_str(), names[i].c_str());
+      return 1;
+    }
+    camera.pairIndex = -1;
+    for (size_t j = 0; !pairTopic.empty() && j < pair.size(); j++)
+      if (pair[j] == names[i])
+        camera.pairIndex = j;
+    camera.pub = it.advertise(camera.topic, 1);
+    ROS_INFO("camera_pub: %s from device %d on %s", camera.name.c_str(), camera.device, camera.topic.c_str());
+  }
+
+  if (!pairTopic.empty())
+  {
+    pairTopics.resize(2);
+    for (size_t i = 0; pair.size() == 2 && i < cameras.size(); i++)
+      if (cameras[i].pairIndex >= 0)
+        pairTopics[cameras[i].pairIndex] = cameras[i].topic;
+    if (pairTopics[0].empty() || pairTopics[1].empty())
+    {
+      ROS_ERROR("camera_pub: ~pair has to name two of the ~cameras");
+      return 1;
+    }
+    pairs = new message_filters::Synchronizer<PairPolicy>(PairPolicy(pairQueue));
+    pairs->setMaxIntervalDuration(ros::Duration(pairSlop));
+    pairs->registerCallback(&pairCb);
+    pairPub = hardware_commons::advertise<hardware_camera::ImagePair>(nh, pairTopic, hardware_commons::LATEST);
+    ROS_INFO("camera_pub: %s and %s at most %.0f ms apart on %s", pair[0].c_str(), pair[1].c_str(), pairSlop * 1e3,
+             pairTopic.c_str());
+  }
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < cameras.size(); i++)
+    threads.push_back(std::thread(&capture, &cameras[i]));
+  ros::spin();
+  for (size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+  return 0;
+}
@@ -3,6 +3,7 @@
 #include <image_transport/image_transport.h>
 #include <opencv2/highgui/highgui.hpp>
 #include <cv_bridge/cv_bridge.h>
+#include <hardware_commons/trace.h>
 #include <sstream>  // for converting the command line parameter to integer
 #include  <string>
 
@@ -40,6 +41,9 @@ int main(int argc, char **argv)
     return 1;
   cv::Mat frame;
   sensor_msgs::ImagePtr msg;
+  // the stamp is when the frame came out of the driver and doubles as its trace id, see hardware_commons/trace.h
+  std_msgs::Header header;
+  header.frame_id = "camera" + camera_number;
   int loopRate = 10;
   ros::Rate loop_rate(loopRate);
   while (nh.ok())
@@ -48,8 +52,11 @@ int main(int argc, char **argv)
     // Check if grabbed frame is actually full with some content
     if (!frame.empty())
     {
-      msg = cv_bridge::CvImage(std_msgs::Header(), "bgr8", frame).toImageMsg();
+      header.stamp = ros::Time::now();
+      hardware_commons::trace::Span span("capture", header.stamp.toNSec());
+      msg = cv_bridge::CvImage(header, "bgr8", frame).toImageMsg();
       pub.publish(msg);
+      header.seq++;
       // loop_rate.sleep();
     }
     ros::spinOnce();
@@ -0,0 +1,272 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_COMMONS_QUEUE_POLICY_H
+#define HARDWARE_COMMONS_QUEUE_POLICY_H
+
+#include <ros/ros.h>
+#include <ros/callback_queue_interface.h>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/function.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <stdint.h>
+#include <deque>
+#include <string>
+
+/*! \file
+* \brief How many messages wait between the nodes, and which of them are dropped
+*
+* Every topic of the vehicle is one of two kinds. LATEST is control data, the detector outputs, yaw, depth, motion
+* inputs and pwm: one message waits at most and a newer one takes its place, so a callback that fell behind gets the
+* newest sample instead of working through seconds old ones and the control loops never act on stale data. EVENTS
+* is for messages that each matter, detector switches, stops and action feedback: they wait in order, but no more
+* than eventDepth of them, beyond that the oldest is dropped so a consumer that hangs cannot grow its node for good.
+*
+* advertise() gives the publisher queue of the policy. subscribe() puts an Inbox of the policy in place of the
+* subscription queue of roscpp, which drops without telling anyone: roscpp hands each message over the moment it
+* arrives, it waits in the inbox and the callback runs on the callback queue of the node handle like before. Every
+* inbox counts the messages it received, handled and dropped (a sample replaced by a newer one counts as dropped)
+* and each process reports its queues on /diagnostics once a second, rqt_runtime_monitor lists them. Drops of an
+* EVENTS queue are reported as a warning, drops of a LATEST queue are what it is for.
+*
+* Like with roscpp, no callback runs once the last copy of the returned subscriber is shut down or destroyed: roscpp
+* drops its end of the inbox then, which closes the inbox and takes what still waits out of the callback queue.
+*/
+namespace hardware_commons
+{
+enum QueuePolicy
+{
+  LATEST,
+  EVENTS
+};
+
+// messages an EVENTS queue holds before it drops the oldest
+const uint32_t eventDepth = 100;
+
+uint32_t queueSize(QueuePolicy policy);
+
+struct QueueCount
+{
+  uint64_t received;
+  uint64_t handled;
+  uint64_t dropped;
+
+  QueueCount() : received(0), handled(0), dropped(0)
+  {
+  }
+};
+
+// what went through one queue of the process, kept until the process exits
+class QueueCounters
+{
+public:
+  QueueCounters(const std::string &name, QueuePolicy policy);
+
+  void received();
+  void handled();
+  void dropped();
+
+  const std::string &name() const
+  {
+    return name_;
+  }
+  QueuePolicy policy() const
+  {
+    return policy_;
+  }
+  QueueCount count() const;
+
+private:
+  std::string name_;
+  QueuePolicy policy_;
+  mutable boost::mutex mutex_;
+  QueueCount count_;
+
+  QueueCounters(const QueueCounters &);
+  QueueCounters &operator=(const QueueCounters &);
+};
+
+// counters of the named queue, registered for the /diagnostics report; a name asked for twice shares them
+QueueCounters *queueCounters(const std::string &name, QueuePolicy policy);
+
+// callback queue that runs what is added right away on the adding thread, where roscpp delivers to the inboxes
+ros::CallbackQueueInterface *deliverNow();
+
+// the messages of one subscription that wait for the callback queue of their node handle
+template <class M>
+class Inbox : public ros::CallbackInterface, public boost::enable_shared_from_this<Inbox<M> >
+{
+public:
+  typedef boost::shared_ptr<M const> MessagePtr;
+  typedef boost::function<void(const MessagePtr &)> Callback;
+
+  Inbox(const std::string &topic, QueuePolicy policy, ros::CallbackQueueInterface *target, const Callback &callback)
+    : policy_(policy), target_(target), callback_(callback), counters_(queueCounters(topic, policy)), open_(true)
+  {
+  }
+
+  // called by roscpp as the message arrives
+  void push(const MessagePtr &msg)
+  {
+    bool queued = true;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      if (!open_)
+        return;
+      counters_->received();
+      if (!waiting_.empty() && (policy_ == LATEST || waiting_.size() >= eventDepth))
+      {
+        waiting_.pop_front();
+        counters_->dropped();
+        // the dropped message already has its entry in the target queue, the new one takes it over
+        queued = false;
+      }
+      waiting_.push_back(msg);
+    }
+    if (queued)
+      target_->addCallback(this->shared_from_this(), reinterpret_cast<uint64_t>(this));
+  }
+
+  // called from the target queue, once for every message that was queued
+  CallResult call()
+  {
+    MessagePtr msg;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      if (!open_ || waiting_.empty())
+        return Success;
+      msg = waiting_.front();
+      waiting_.pop_front();
+    }
+    callback_(msg);
+    counters_->handled();
+    return Success;
+  }
+
+  // the subscription is gone: nothing is taken any more and what waits is dropped, even if already in the target queue
+  void close()
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      if (!open_)
+        return;
+      open_ = false;
+      for (size_t i = 0; i < waiting_.size(); i++)
+        counters_->dropped();
+      waiting_.clear();
+    }
+    target_->removeByID(reinterpret_cast<uint64_t>(this));
+  }
+
+private:
+  QueuePolicy policy_;
+  ros::CallbackQueueInterface *target_;
+  Callback callback_;
+  QueueCounters *counters_;
+  boost::mutex mutex_;
+  bool open_;
+  std::deque<MessagePtr> waiting_;
+};
+
+namespace detail
+{
+// for callbacks that take the message itself rather than a pointer to it
+template <class M>
+struct ByValue
+{
+  explicit ByValue(const boost::function<void(const M &)> &callback) : callback(callback)
+  {
+  }
+  void operator()(const boost::shared_ptr<M const> &msg) const
+  {
+    callback(*msg);
+  }
+
+  boost::function<void(const M &)> callback;
+};
+
+// closes the inbox when the last copy of the callback roscpp holds goes away, which happens on shutdown()
+template <class M>
+struct Closer
+{
+  explicit Closer(const boost::shared_ptr<Inbox<M> > &inbox) : inbox(inbox)
+  {
+  }
+  ~Closer()
+  {
+    inbox->close();
+  }
+
+  boost::shared_ptr<Inbox<M> > inbox;
+};
+
+// what roscpp calls with each message
+template <class M>
+struct Delivery
+{
+  explicit Delivery(const boost::shared_ptr<Inbox<M> > &inbox) : inbox(inbox), closer(new Closer<M>(inbox))
+  {
+  }
+  void operator()(const boost::shared_ptr<M const> &msg) const
+  {
+    inbox->push(msg);
+  }
+
+  boost::shared_ptr<Inbox<M> > inbox;
+  boost::shared_ptr<Closer<M> > closer;
+};
+}  // namespace detail
+
+template <class M>
+ros::Publisher advertise(ros::NodeHandle nh, const std::string &topic, QueuePolicy policy)
+{
+  return nh.advertise<M>(topic, queueSize(policy));
+}
+
+// subscribes like nh.subscribe<M>() but through an Inbox of the policy
+template <class M>
+ros::Subscriber subscribe(ros::NodeHandle nh, const std::string &topic, QueuePolicy policy,
+                          const boost::function<void(const boost::shared_ptr<M const> &)> &callback,
+                          const ros::TransportHints &hints = ros::TransportHints())
+{
+  ros::CallbackQueueInterface *target = nh.getCallbackQueue();
+  if (!target)
+    target = ros::getGlobalCallbackQueue();
+  boost::shared_ptr<Inbox<M> > inbox = boost::make_shared<Inbox<M> >(nh.resolveName(topic), policy, target, callback);
+  ros::SubscribeOptions ops;
+  ops.template init<M>(topic, queueSize(policy),
+                       boost::function<void(const boost::shared_ptr<M const> &)>(detail::Delivery<M>(inbox)));
+  ops.transport_hints = hints;
+  ops.callback_queue = deliverNow();
+  return nh.subscribe(ops);
+}
+
+template <class M>
+ros::Subscriber subscribe(ros::NodeHandle nh, const std::string &topic, QueuePolicy policy,
+                          void (*callback)(const boost::shared_ptr<M const> &),
+                          const ros::TransportHints &hints = ros::TransportHints())
+{
+  return subscribe<M>(nh, topic, policy, boost::function<void(const boost::shared_ptr<M const> &)>(callback), hints);
+}
+
+template <class M>
+ros::Subscriber subscribe(ros::NodeHandle nh, const std::string &topic, QueuePolicy policy, void (*callback)(M),
+                          const ros::TransportHints &hints = ros::TransportHints())
+{
+  return subscribe<M>(nh, topic, policy, boost::function<void(const boost::shared_ptr<M const> &)>(
+                                             detail::ByValue<M>(boost::function<void(const M &)>(callback))),
+                      hints);
+}
+
+template <class M, class T>
+ros::Subscriber subscribe(ros::NodeHandle nh, const std::string &topic, QueuePolicy policy, void (T::*callback)(M),
+                          T *object, const ros::TransportHints &hints = ros::TransportHints())
+{
+  return subscribe<M>(nh, topic, policy,
+                      boost::function<void(const boost::shared_ptr<M const> &)>(detail::ByValue<M>(
+                          boost::function<void(const M &)>(boost::bind(callback, object, _1)))),
+                      hints);
+}
+}  // namespace hardware_commons
+
+#endif  // HARDWARE_COMMONS_QUEUE_POLICY_H
@@ -0,0 +1,97 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_COMMONS_SENSOR_BOARD_H
+#define HARDWARE_COMMONS_SENSOR_BOARD_H
+
+#include <stdint.h>
+#include <string>
+
+/*! \file
+* \brief Latest sensor values shared between the nodes on the vehicle
+*
+* One POSIX shared memory object holds a slot per channel. A producer overwrites its slot with the newest reading and
+* every consumer on the same machine reads it straight out of the mapping, nothing is queued, serialized or sent over
+* a socket. Each slot is a seqlock: the writer makes its version odd, stores the reading and makes it even again, a
+* reader copies the reading and retries if the version moved underneath it. Writers never wait for readers.
+*
+* Readings are stamped with CLOCK_MONOTONIC (std::chrono::steady_clock), the same clock as the imu samples, so ages
+* compare across processes. sensor_bridge copies topics onto the board for producers that only speak ROS (rosserial,
+* the gazebo mocks, bag playback) and the board back onto topics for tooling.
+*/
+namespace hardware_commons
+{
+enum Channel
+{
+  IMU,              // yaw, pitch, roll in degrees, then the body rates in degrees/s
+  DEPTH,            // /varun/sensors/pressure_sensor/depth, then its filtered rate per second from link_bridge
+  BUOY,             // /varun/ip/buoy as the detector publishes it
+  GATE,             // /varun/ip/gate
+  TORPEDO,          // /varun/ip/torpedo
+  LINE_CENTRALIZE,  // /varun/ip/line_centralize
+  LINE_ANGLE,       // /varun/ip/line_angle
+  CHANNEL_COUNT
+};
+
+const char *channelName(Channel channel);
+// case sensitive, the names are the enum names in lower case
+bool channelFromName(const std::string &name, Channel &channel);
+
+struct Reading
+{
+  static const int maxValues = 8;
+
+  int64_t stamp;   // CLOCK_MONOTONIC ns
+  uint32_t seq;    // number of writes to the channel, 0 while it was never written
+  uint32_t count;  // values in use
+  uint64_t trace;  // trace::current() of the writer, the frame a detection came from
+  double values[maxValues];
+
+  // seconds since the producer wrote it
+  double age() const;
+};
+
+struct BoardLayout;
+
+class SensorBoard
+{
+public:
+  SensorBoard();
+  ~SensorBoard();
+
+  // maps the board, creating it if this is the first process to use it; false with error() set otherwise
+  bool open(const std::string &name = "/varun_sensor_board");
+  void close();
+  bool isOpen() const
+  {
+    return board_ != 0;
+  }
+  const std::string &error() const
+  {
+    return error_;
+  }
+
+  // replaces the reading of the channel, values past Reading::maxValues are dropped
+  void write(Channel channel, const double *values, int count, int64_t stamp);
+  void write(Channel channel, const double *values, int count)
+  {
+    write(channel, values, count, now());
+  }
+  void write(Channel channel, double value)
+  {
+    write(channel, &value, 1, now());
+  }
+
+  // false if the channel was never written (or the board is not open)
+  bool read(Channel channel, Reading &reading) const;
+
+  static int64_t now();
+
+private:
+  BoardLayout *board_;
+  std::string error_;
+
+  SensorBoard(const SensorBoard &);
+  SensorBoard &operator=(const SensorBoard &);
+};
+}  // namespace hardware_commons
+
+#endif  // HARDWARE_COMMONS_SENSOR_BOARD_H
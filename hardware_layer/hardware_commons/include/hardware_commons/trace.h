@@ -0,0 +1,88 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_COMMONS_TRACE_H
+#define HARDWARE_COMMONS_TRACE_H
+
+#include <stdint.h>
+#include <string>
+
+/*! \file
+* \brief Latency spans from a camera frame to the thruster command it caused
+*
+* Every camera frame is a trace, its id is the capture stamp camera_pub puts in the image header (in ns, unique per
+* camera). A span is a named stretch of time of one thread spent on behalf of a trace; the detectors, the motion
+* servers, the thruster mixer and link_bridge each record theirs, so the gaps between the spans of one id are
+* what the topics and queues in between cost. A preempted motion goal starts a trace of its own, stamped when the
+* preempt came in, that ends at the applied stop (motion_commons/pwm_output.h).
+*
+* The id reaches the next process without touching the messages. Whoever publishes something derived from a trace
+* tags the topic with it (publish() below), the subscriber follows the tag of the topic it got the message from. Tags
+* live in a shared memory table next to the sensor board, readings written to the board carry the current id of the
+* writing thread in Reading::trace. A tag is the id of the newest message on the topic, with the LATEST queues of
+* the control topics (queue_policy.h) that is the message being handled.
+*
+* Tracing is off unless VARUN_TRACE_DIR is set in the environment of the process; then every span goes into a fixed
+* ring of this process (the oldest are overwritten, recording never blocks and never allocates) and the ring is
+* written to $VARUN_TRACE_DIR/<program>-<pid>.json in the Chrome trace event format when the process exits.
+* scripts/merge_traces.py joins the files of a run and links the spans of each frame. Times are CLOCK_MONOTONIC,
+* the clock of the sensor board, so spans of different processes line up.
+*/
+namespace hardware_commons
+{
+namespace trace
+{
+typedef uint64_t Id;  // 0 is no trace
+
+bool enabled();
+
+// id of the trace the calling thread works on
+Id current();
+void setCurrent(Id id);
+
+// span names are kept as pointers and only read when the process exits, a literal or an intern()ed string
+void record(const char *name, Id id, int64_t begin, int64_t end);
+
+// copy of name that stays valid for the rest of the process, for names built at run time
+const char *intern(const std::string &name);
+
+// tags topic with the current trace of this thread
+void tag(const std::string &topic);
+// id of the newest tag of topic, 0 if it has none
+Id follow(const std::string &topic);
+
+// writes the spans recorded so far, done automatically at exit when VARUN_TRACE_DIR is set
+bool dump(const std::string &file);
+
+// the span lasts as long as the object, the thread works on id meanwhile and goes back to its previous trace after
+class Span
+{
+public:
+  explicit Span(const char *name);
+  Span(const char *name, Id id);
+  ~Span();
+
+  // ends the span before the scope does, for loops that sleep at the bottom
+  void close();
+
+private:
+  const char *name_;
+  Id id_;
+  Id previous_;
+  int64_t begin_;
+  bool open_;
+
+  Span(const Span &);
+  Span &operator=(const Span &);
+};
+
+// publishes msg and tags its topic with the current trace
+template <class Publisher, class Message>
+void publish(const Publisher &publisher, const Message &msg)
+{
+  publisher.publish(msg);
+  if (enabled())
+    tag(publisher.getTopic());
+}
+}  // namespace trace
+}  // namespace hardware_commons
+
+#endif  // HARDWARE_COMMONS_TRACE_H
@@ -0,0 +1,68 @@
+#!/usr/bin/env python
+# Copyright 2016 AUV-IITK
+"""Joins the span files the nodes write to $VARUN_TRACE_DIR into one Chrome trace.
+
+The spans of every frame are chained with flow arrows across processes, and the
+time from capture to the first applied thruster command of each frame is summed
+up, as is the time from a preempted motion goal to the applied stop. Open the
+output in chrome://tracing or https://ui.perfetto.dev.
+
+usage: merge_traces.py <trace dir> [output file]
+"""
+
+import glob
+import json
+import os
+import sys
+
+# first and last hop of the chains that are timed, see hardware_commons/trace.h and motion_commons/pwm_output.h
+CHAINS = [('capture', 'applied', 'frames'), ('preempt', 'applied', 'stops')]
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return 1
+    directory = sys.argv[1]
+    output = sys.argv[2] if len(sys.argv) > 2 else os.path.join(directory, 'merged.trace')
+
+    events = []
+    for name in sorted(glob.glob(os.path.join(directory, '*.json'))):
+        with open(name) as f:
+            events.extend(json.load(f)['traceEvents'])
+
+    spans = len(events)
+    traces = {}
+    for event in events:
+        if event['ph'] == 'X' and event['args']['trace'] != '0':
+            traces.setdefault(event['args']['trace'], []).append(event)
+
+    latencies = dict((chain, []) for chain in CHAINS)
+    for trace, chain in traces.items():
+        chain.sort(key=lambda span: span['ts'])
+        for i, span in enumerate(chain):
+            phase = 's' if i == 0 else 'f' if i == len(chain) - 1 else 't'
+            events.append({'name': 'frame', 'cat': 'trace', 'ph': phase, 'bp': 'e', 'id': trace,
+                           'ts': span['ts'], 'pid': span['pid'], 'tid': span['tid']})
+        for first, last, what in CHAINS:
+            starts = [span for span in chain if span['name'] == first]
+            ends = [span for span in chain if span['name'] == last]
+            if starts and ends:
+                latencies[(first, last, what)].append((ends[0]['ts'] + ends[0]['dur'] - starts[0]['ts']) * 1e-3)
+
+    with open(output, 'w') as f:
+        json.dump({'traceEvents': events}, f)
+    print('%d spans of %d frames written to %s' % (spans, len(traces), output))
+
+    for first, last, what in CHAINS:
+        times = latencies[(first, last, what)]
+        if not times:
+            continue
+        times.sort()
+        print('%s to %s thruster command over %d %s: median %.1f ms, 90%% %.1f ms, max %.1f ms' % (
+            first, last, len(times), what, times[len(times) // 2], times[len(times) * 9 // 10], times[-1]))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
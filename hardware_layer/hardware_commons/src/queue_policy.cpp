@@ -0,0 +1,154 @@
+// Copyright 2016 AUV-IITK
+#include <hardware_commons/queue_policy.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hardware_commons
+{
+namespace
+{
+class DeliverNow : public ros::CallbackQueueInterface
+{
+public:
+  void addCallback(const ros::CallbackInterfacePtr &callback, uint64_t)
+  {
+    // only the subscription queues of the inboxes come here, with nobody else calling them TryAgain cannot happen
+    if (callback->ready())
+      callback->call();
+  }
+
+  void removeByID(uint64_t)
+  {
+  }
+};
+
+// never destroyed, like the tracer, the report thread may still run while static destructors do
+struct Registry
+{
+  std::mutex mutex;
+  std::vector<QueueCounters *> queues;
+  bool reporting;
+
+  Registry() : reporting(false)
+  {
+  }
+};
+
+Registry &registry()
+{
+  static Registry *instance = new Registry();
+  return *instance;
+}
+
+std::string text(uint64_t value)
+{
+  std::ostringstream out;
+  out << value;
+  return out.str();
+}
+
+diagnostic_msgs::KeyValue entry(const std::string &key, const std::string &value)
+{
+  diagnostic_msgs::KeyValue pair;
+  pair.key = key;
+  pair.value = value;
+  return pair;
+}
+
+void report()
+{
+  ros::NodeHandle nh;
+  ros::Publisher pub = nh.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+  std::string node = ros::this_node::getName();
+  while (ros::ok())
+  {
+    diagnostic_msgs::DiagnosticArray array;
+    array.header.stamp = ros::Time::now();
+    std::vector<QueueCounters *> queues;
+    {
+      std::lock_guard<std::mutex> lock(registry().mutex);
+      queues = registry().queues;
+    }
+    for (size_t i = 0; i < queues.size(); i++)
+    {
+      QueueCount count = queues[i]->count();
+      bool latest = queues[i]->policy() == LATEST;
+      diagnostic_msgs::DiagnosticStatus status;
+      status.name = node + ": " + queues[i]->name();
+      status.hardware_id = node;
+      status.level = !latest && count.dropped ? diagnostic_msgs::DiagnosticStatus::WARN :
+                                                 diagnostic_msgs::DiagnosticStatus::OK;
+      status.message = text(count.dropped) + (latest ? " replaced by newer" : " dropped");
+      status.values.push_back(entry("policy", latest ? "latest" : "events"));
+      status.values.push_back(entry("depth", text(queueSize(queues[i]->policy()))));
+      status.values.push_back(entry("waiting", text(count.received - count.handled - count.dropped)));
+      status.values.push_back(entry("received", text(count.received)));
+      status.values.push_back(entry("handled", text(count.handled)));
+      status.values.push_back(entry("dropped", text(count.dropped)));
+      array.status.push_back(status);
+    }
+    pub.publish(array);
+    ros::WallDuration(1).sleep();
+  }
+}
+}  // namespace
+
+uint32_t queueSize(QueuePolicy policy)
+{
+  return policy == LATEST ? 1 : eventDepth;
+}
+
+QueueCounters::QueueCounters(const std::string &name, QueuePolicy policy) : name_(name), policy_(policy)
+{
+}
+
+void QueueCounters::received()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  count_.received++;
+}
+
+void QueueCounters::handled()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  count_.handled++;
+}
+
+void QueueCounters::dropped()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  count_.dropped++;
+}
+
+QueueCount QueueCounters::count() const
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  return count_;
+}
+
+QueueCounters *queueCounters(const std::string &name, QueuePolicy policy)
+{
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  for (size_t i = 0; i < r.queues.size(); i++)
+    if (r.queues[i]->name() == name && r.queues[i]->policy() == policy)
+      return r.queues[i];
+  r.queues.push_back(new QueueCounters(name, policy));
+  if (!r.reporting)
+  {
+    r.reporting = true;
+    std::thread(&report).detach();
+  }
+  return r.queues.back();
+}
+
+ros::CallbackQueueInterface *deliverNow()
+{
+  static DeliverNow *instance = new DeliverNow();
+  return instance;
+}
+}  // namespace hardware_commons
@@ -0,0 +1,185 @@
+// Copyright 2016 AUV-IITK
+#include <hardware_commons/sensor_board.h>
+#include <hardware_commons/trace.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+
+namespace hardware_commons
+{
+namespace
+{
+const char *const channelNames[CHANNEL_COUNT] = { "imu",     "depth",           "buoy",      "gate",
+                                                  "torpedo", "line_centralize", "line_angle" };
+// changes whenever the layout does, a board left behind by an older build is refused instead of misread
+const uint32_t boardMagic = 0x56534203;
+const int words = sizeof(Reading) / sizeof(uint32_t);
+// a writer that died halfway leaves its slot odd, after this many spins the next writer takes it over
+const int writerSpins = 1 << 16;
+const int readerTries = 1 << 16;
+}  // namespace
+
+// each slot on its own cache line so producers of different channels never share one
+struct alignas(64) BoardSlot
+{
+  std::atomic<uint32_t> version;  // odd while a write is in progress
+  std::atomic<uint32_t> data[words];
+};
+
+struct BoardLayout
+{
+  std::atomic<uint32_t> magic;  // 0 in a board that was just created
+  BoardSlot slots[CHANNEL_COUNT];
+};
+
+static_assert(sizeof(Reading) % sizeof(uint32_t) == 0, "Reading must be a whole number of words");
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "the board needs lock free atomics to work across processes");
+
+const char *channelName(Channel channel)
+{
+  return channel >= 0 && channel < CHANNEL_COUNT ? channelNames[channel] : "unknown";
+}
+
+bool channelFromName(const std::string &name, Channel &channel)
+{
+  for (int i = 0; i < CHANNEL_COUNT; i++)
+    if (name == channelNames[i])
+    {
+      channel = static_cast<Channel>(i);
+      return true;
+    }
+  return false;
+}
+
+const int Reading::maxValues;
+
+double Reading::age() const
+{
+  return (SensorBoard::now() - stamp) * 1e-9;
+}
+
+SensorBoard::SensorBoard() : board_(0)
+{
+}
+
+SensorBoard::~SensorBoard()
+{
+  close();
+}
+
+bool SensorBoard::open(const std::string &name)
+{
+  close();
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0666);
+  if (fd < 0)
+  {
+    error_ = "cannot open shared memory " + name + ": " + strerror(errno);
+    return false;
+  }
+  // a new object is zero filled, which is an empty board; growing an existing one to the same size changes nothing
+  struct stat info;
+  if (fstat(fd, &info) < 0 || (info.st_size != sizeof(BoardLayout) && ftruncate(fd, sizeof(BoardLayout)) < 0))
+  {
+    error_ = "cannot size shared memory " + name + ": " + strerror(errno);
+    ::close(fd);
+    return false;
+  }
+  void *map = mmap(NULL, sizeof(BoardLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+  {
+    error_ = "cannot map shared memory " + name + ": " + strerror(errno);
+    return false;
+  }
+  BoardLayout *board = static_cast<BoardLayout *>(map);
+  uint32_t magic = 0;
+  if (!board->magic.compare_exchange_strong(magic, boardMagic) && magic != boardMagic)
+  {
+    munmap(map, sizeof(BoardLayout));
+    error_ = name + " was created by a different build, remove /dev/shm" + name;
+    return false;
+  }
+  board_ = board;
+  return true;
+}
+
+void SensorBoard::close()
+{
+  if (board_)
+    munmap(board_, sizeof(BoardLayout));
+  board_ = 0;
+}
+
+void SensorBoard::write(Channel channel, const double *values, int count, int64_t stamp)
+{
+  if (!board_ || channel < 0 || channel >= CHANNEL_COUNT)
+    return;
+  Reading reading;
+  memset(&reading, 0, sizeof(reading));
+  reading.stamp = stamp;
+  reading.trace = trace::current();
+  reading.count = count < 0 ? 0 : count < Reading::maxValues ? count : Reading::maxValues;
+  if (reading.count)
+    memcpy(reading.values, values, reading.count * sizeof(double));
+  uint32_t raw[words];
+  memcpy(raw, &reading, sizeof(reading));
+
+  // claim the slot by making the version odd, so two producers of one channel cannot interleave
+  BoardSlot &slot = board_->slots[channel];
+  uint32_t version = slot.version.load(std::memory_order_relaxed);
+  for (int spins = 0;; spins++)
+  {
+    if ((version & 1) && spins < writerSpins)
+    {
+      version = slot.version.load(std::memory_order_relaxed);
+      continue;
+    }
+    // taking over an abandoned odd version skips to the next odd one, readers still see a change
+    if (slot.version.compare_exchange_weak(version, version + ((version & 1) ? 2 : 1), std::memory_order_relaxed))
+      break;
+  }
+  version += (version & 1) ? 2 : 1;
+  std::atomic_thread_fence(std::memory_order_release);
+  for (int i = 0; i < words; i++)
+    slot.data[i].store(raw[i], std::memory_order_relaxed);
+  slot.version.store(version + 1, std::memory_order_release);
+}
+
+bool SensorBoard::read(Channel channel, Reading &reading) const
+{
+  if (!board_ || channel < 0 || channel >= CHANNEL_COUNT)
+    return false;
+  const BoardSlot &slot = board_->slots[channel];
+  uint32_t raw[words];
+  for (int tries = 0; tries < readerTries; tries++)
+  {
+    uint32_t before = slot.version.load(std::memory_order_acquire);
+    if (before & 1)
+      continue;
+    if (before == 0)
+      return false;
+    for (int i = 0; i < words; i++)
+      raw[i] = slot.data[i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.version.load(std::memory_order_relaxed) != before)
+      continue;
+    memcpy(&reading, raw, sizeof(reading));
+    reading.seq = before / 2;
+    return true;
+  }
+  return false;
+}
+
+int64_t SensorBoard::now()
+{
+  timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+}  // namespace hardware_commons
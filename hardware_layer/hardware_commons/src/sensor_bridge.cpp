@@ -0,0 +1,111 @@
+// Copyright 2016 AUV-IITK
+#include <ros/ros.h>
+#include <std_msgs/Float64.h>
+#include <std_msgs/Float64MultiArray.h>
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/sensor_board.h>
+#include <string>
+#include <vector>
+
+// ROS side of the sensor board. Channels listed in sensor_bridge/import are copied from their topics onto the board,
+// for producers that only publish (serial_node, the gazebo mocks, rosbag play). Every other channel is published
+// from the board to /varun/sensors/board/<channel> so rqt and rosbag can see what the vehicle is using.
+
+using hardware_commons::Channel;
+using hardware_commons::Reading;
+
+hardware_commons::SensorBoard board;
+
+struct ChannelTopic
+{
+  Channel channel;
+  const char *topic;
+  bool scalar;  // std_msgs/Float64, otherwise std_msgs/Float64MultiArray
+};
+
+const ChannelTopic channelTopics[] = {
+  { hardware_commons::IMU, "/varun/sensors/imu/yaw", true },
+  { hardware_commons::DEPTH, "/varun/sensors/pressure_sensor/depth", true },
+  { hardware_commons::BUOY, "/varun/ip/buoy", false },
+  { hardware_commons::GATE, "/varun/ip/gate", false },
+  { hardware_commons::TORPEDO, "/varun/ip/torpedo", false },
+  { hardware_commons::LINE_CENTRALIZE, "/varun/ip/line_centralize", false },
+  { hardware_commons::LINE_ANGLE, "/varun/ip/line_angle", true },
+};
+
+void scalarListener(Channel channel, const std_msgs::Float64ConstPtr &msg)
+{
+  board.write(channel, msg->data);
+}
+
+void arrayListener(Channel channel, const std_msgs::Float64MultiArrayConstPtr &msg)
+{
+  board.write(channel, msg->data.data(), msg->data.size());
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "sensor_bridge");
+  ros::NodeHandle nh;
+  std::vector<std::string> importNames;
+  double rate = 50;
+  nh.getParam("sensor_bridge/import", importNames);
+  nh.getParam("sensor_bridge/rate", rate);
+
+  if (!board.open())
+  {
+    ROS_ERROR("%s", board.error().c_str());
+    return 1;
+  }
+
+  bool imported[hardware_commons::CHANNEL_COUNT] = {};
+  for (size_t i = 0; i < importNames.size(); i++)
+  {
+    Channel channel;
+    if (!hardware_commons::channelFromName(importNames[i], channel))
+    {
+      ROS_ERROR("unknown sensor board channel %s", importNames[i].c_str());
+      return 1;
+    }
+    imported[channel] = true;
+  }
+
+  std::vector<ros::Subscriber> subscribers;
+  std::vector<ros::Publisher> publishers(hardware_commons::CHANNEL_COUNT);
+  for (size_t i = 0; i < sizeof(channelTopics) / sizeof(channelTopics[0]); i++)
+  {
+    const ChannelTopic &entry = channelTopics[i];
+    if (imported[entry.channel] && entry.scalar)
+      subscribers.push_back(hardware_commons::subscribe<std_msgs::Float64>(
+          nh, entry.topic, hardware_commons::LATEST, boost::bind(&scalarListener, entry.channel, _1)));
+    else if (imported[entry.channel])
+      subscribers.push_back(hardware_commons::subscribe<std_msgs::Float64MultiArray>(
+          nh, entry.topic, hardware_commons::LATEST, boost::bind(&arrayListener, entry.channel, _1)));
+    else
+      publishers[entry.channel] = hardware_commons::advertise<std_msgs::Float64MultiArray>(
+          nh, std::string("/varun/sensors/board/") + hardware_commons::channelName(entry.channel),
+          hardware_commons::LATEST);
+    ROS_INFO("%s: %s %s", hardware_commons::channelName(entry.channel), imported[entry.channel] ? "from" : "shown on",
+             imported[entry.channel] ? entry.topic : "/varun/sensors/board");
+  }
+
+  // only new readings are published, a producer that stopped shows up as a topic that went quiet
+  uint32_t lastSeq[hardware_commons::CHANNEL_COUNT] = {};
+  ros::Rate loopRate(rate);
+  while (ros::ok())
+  {
+    for (int i = 0; i < hardware_commons::CHANNEL_COUNT; i++)
+    {
+      Reading reading;
+      if (!publishers[i] || !board.read(static_cast<Channel>(i), reading) || reading.seq == lastSeq[i])
+        continue;
+      lastSeq[i] = reading.seq;
+      std_msgs::Float64MultiArray msg;
+      msg.data.assign(reading.values, reading.values + reading.count);
+      publishers[i].publish(msg);
+    }
+    ros::spinOnce();
+    loopRate.sleep();
+  }
+  return 0;
+}
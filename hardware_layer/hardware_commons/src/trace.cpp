@@ -0,0 +1,283 @@
+// Copyright 2016 AUV-IITK
+#include <hardware_commons/trace.h>
+#include <hardware_commons/sensor_board.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace hardware_commons
+{
+namespace trace
+{
+namespace
+{
+// spans kept per process, about a quarter of an hour of a busy node
+const uint64_t ringSize = 1 << 16;
+const int tagCount = 256;
+const char *const tagBoard = "/varun_trace_tags";
+const uint32_t tagMagic = 0x56545401;
+
+// a seqlock per entry like the slots of the sensor board, only the dump reads them while writers may still run
+struct Entry
+{
+  std::atomic<uint64_t> version;  // 0 while being written, otherwise the position in the ring plus one
+  std::atomic<const char *> name;
+  std::atomic<uint64_t> id;
+  std::atomic<int64_t> begin;
+  std::atomic<int64_t> end;
+  std::atomic<int32_t> thread;
+};
+
+// topic hash to the id of its newest message, open addressing, slots are never freed
+struct TagSlot
+{
+  std::atomic<uint64_t> key;  // 0 while unused
+  std::atomic<uint64_t> id;
+};
+
+struct TagTable
+{
+  std::atomic<uint32_t> magic;
+  TagSlot slots[tagCount];
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the tag table needs lock free atomics to work across processes");
+
+// never destroyed, the dump registered with atexit may run after static destructors
+struct Tracer
+{
+  bool on;
+  char file[512];
+  Entry *ring;
+  std::atomic<uint64_t> head;
+  TagTable *tags;
+
+  Tracer();
+};
+
+thread_local Id currentId = 0;
+thread_local int32_t threadId = 0;
+
+TagTable *openTags()
+{
+  int fd = shm_open(tagBoard, O_RDWR | O_CREAT, 0666);
+  if (fd < 0)
+    return 0;
+  struct stat info;
+  if (fstat(fd, &info) < 0 || (info.st_size != sizeof(TagTable) && ftruncate(fd, sizeof(TagTable)) < 0))
+  {
+    close(fd);
+    return 0;
+  }
+  void *map = mmap(NULL, sizeof(TagTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return 0;
+  TagTable *table = static_cast<TagTable *>(map);
+  uint32_t magic = 0;
+  if (!table->magic.compare_exchange_strong(magic, tagMagic) && magic != tagMagic)
+  {
+    munmap(map, sizeof(TagTable));
+    return 0;
+  }
+  return table;
+}
+
+void dumpAtExit();
+
+Tracer::Tracer() : on(false), ring(0), head(0), tags(0)
+{
+  const char *dir = getenv("VARUN_TRACE_DIR");
+  if (!dir || !*dir)
+    return;
+  snprintf(file, sizeof(file), "%s/%s-%d.json", dir, program_invocation_short_name, static_cast<int>(getpid()));
+  ring = new Entry[ringSize];
+  for (uint64_t i = 0; i < ringSize; i++)
+    ring[i].version.store(0, std::memory_order_relaxed);
+  tags = openTags();
+  if (!tags)
+    fprintf(stderr, "trace: cannot map %s (%s), ids do not cross processes\n", tagBoard, strerror(errno));
+  on = true;
+  atexit(&dumpAtExit);
+}
+
+Tracer &tracer()
+{
+  static Tracer *instance = new Tracer();
+  return *instance;
+}
+
+void dumpAtExit()
+{
+  dump(tracer().file);
+}
+
+int32_t thread()
+{
+  if (!threadId)
+    threadId = static_cast<int32_t>(syscall(SYS_gettid));
+  return threadId;
+}
+
+uint64_t hash(const std::string &topic)
+{
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < topic.size(); i++)
+    h = (h ^ static_cast<unsigned char>(topic[i])) * 1099511628211ULL;
+  return h ? h : 1;
+}
+}  // namespace
+
+bool enabled()
+{
+  return tracer().on;
+}
+
+Id current()
+{
+  return currentId;
+}
+
+void setCurrent(Id id)
+{
+  currentId = id;
+}
+
+void record(const char *name, Id id, int64_t begin, int64_t end)
+{
+  Tracer &t = tracer();
+  if (!t.on)
+    return;
+  uint64_t position = t.head.fetch_add(1, std::memory_order_relaxed);
+  Entry &entry = t.ring[position & (ringSize - 1)];
+  entry.version.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  entry.name.store(name, std::memory_order_relaxed);
+  entry.id.store(id, std::memory_order_relaxed);
+  entry.begin.store(begin, std::memory_order_relaxed);
+  entry.end.store(end, std::memory_order_relaxed);
+  entry.thread.store(thread(), std::memory_order_relaxed);
+  entry.version.store(position + 1, std::memory_order_release);
+}
+
+const char *intern(const std::string &name)
+{
+  static std::mutex mutex;
+  static std::set<std::string> *names = new std::set<std::string>();
+  std::lock_guard<std::mutex> lock(mutex);
+  return names->insert(name).first->c_str();
+}
+
+void tag(const std::string &topic)
+{
+  Tracer &t = tracer();
+  if (!t.tags)
+    return;
+  uint64_t key = hash(topic);
+  for (int i = 0; i < tagCount; i++)
+  {
+    TagSlot &slot = t.tags->slots[(key + i) % tagCount];
+    uint64_t found = slot.key.load(std::memory_order_acquire);
+    if (found == 0 && slot.key.compare_exchange_strong(found, key))
+      found = key;
+    if (found == key)
+    {
+      slot.id.store(currentId, std::memory_order_release);
+      return;
+    }
+  }
+}
+
+Id follow(const std::string &topic)
+{
+  Tracer &t = tracer();
+  if (!t.tags)
+    return 0;
+  uint64_t key = hash(topic);
+  for (int i = 0; i < tagCount; i++)
+  {
+    const TagSlot &slot = t.tags->slots[(key + i) % tagCount];
+    uint64_t found = slot.key.load(std::memory_order_acquire);
+    if (found == key)
+      return slot.id.load(std::memory_order_acquire);
+    if (found == 0)
+      return 0;
+  }
+  return 0;
+}
+
+bool dump(const std::string &file)
+{
+  Tracer &t = tracer();
+  if (!t.on)
+    return false;
+  FILE *out = fopen(file.c_str(), "w");
+  if (!out)
+    return false;
+
+  int pid = getpid();
+  fprintf(out, "{\"traceEvents\":[\n");
+  fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"%s\"}}", pid,
+          program_invocation_short_name);
+  for (uint64_t i = 0; i < ringSize; i++)
+  {
+    const Entry &entry = t.ring[i];
+    uint64_t before = entry.version.load(std::memory_order_acquire);
+    if (before == 0)
+      continue;
+    const char *name = entry.name.load(std::memory_order_relaxed);
+    Id id = entry.id.load(std::memory_order_relaxed);
+    int64_t begin = entry.begin.load(std::memory_order_relaxed);
+    int64_t end = entry.end.load(std::memory_order_relaxed);
+    int32_t tid = entry.thread.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (entry.version.load(std::memory_order_relaxed) != before)
+      continue;
+    // ids go out as strings, a double cannot hold a stamp in ns exactly
+    fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,"
+                 "\"args\":{\"trace\":\"%llu\"}}",
+            name, begin * 1e-3, (end - begin) * 1e-3, pid, tid, static_cast<unsigned long long>(id));
+  }
+  fprintf(out, "\n]}\n");
+  return fclose(out) == 0;
+}
+
+Span::Span(const char *name) : name_(name), id_(currentId), previous_(currentId), begin_(0), open_(true)
+{
+  if (enabled())
+    begin_ = SensorBoard::now();
+}
+
+Span::Span(const char *name, Id id) : name_(name), id_(id), previous_(currentId), begin_(0), open_(true)
+{
+  currentId = id;
+  if (enabled())
+    begin_ = SensorBoard::now();
+}
+
+Span::~Span()
+{
+  close();
+}
+
+void Span::close()
+{
+  if (!open_)
+    return;
+  open_ = false;
+  if (enabled())
+    record(name_, id_, begin_, SensorBoard::now());
+  currentId = previous_;
+}
+}  // namespace trace
+}  // namespace hardware_commons
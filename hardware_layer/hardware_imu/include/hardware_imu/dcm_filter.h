@@ -0,0 +1,80 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_IMU_DCM_FILTER_H
+#define HARDWARE_IMU_DCM_FILTER_H
+
+#include <hardware_imu/orientation_filter.h>
+
+/*! \file
+* \brief Direction cosine matrix complementary filter
+*
+* The filter that used to live in the DCM header as globals. Gyro rates are integrated into the rotation matrix, and
+* the drift is corrected with the accelerometer (roll, pitch) and the tilt compensated compass heading (yaw). All
+* state is in the object, so several filters can run side by side on the same samples.
+*/
+namespace hardware_imu
+{
+class DcmFilter : public OrientationFilter
+{
+public:
+  struct Gains
+  {
+    float kpRollPitch;
+    float kiRollPitch;
+    float kpYaw;
+    float kiYaw;
+  };
+
+  static Gains defaultGains()
+  {
+    Gains gains = { 0.02f, 0.00002f, 10.3f, 0.002f };
+    return gains;
+  }
+
+  explicit DcmFilter(const Gains &gains = defaultGains());
+
+  // also clears the integrators
+  void reset(const Vec3 &accel, const Vec3 &magnetom);
+  void update(const Vec3 &gyro, const Vec3 &accel, const Vec3 &magnetom, float dt);
+
+  float yaw() const
+  {
+    return yaw_;
+  }
+  float pitch() const
+  {
+    return pitch_;
+  }
+  float roll() const
+  {
+    return roll_;
+  }
+  Quat orientation() const
+  {
+    return fromMat3(dcm_);
+  }
+  const Mat3 &dcm() const
+  {
+    return dcm_;
+  }
+  // the DCM has no bias state of its own, this is the last gyro sample
+  Vec3 rate() const
+  {
+    return gyro_;
+  }
+
+private:
+  Gains gains_;
+  Mat3 dcm_;
+  Vec3 gyro_;
+  Vec3 omegaP_;  // proportional correction
+  Vec3 omegaI_;  // integrator
+  float yaw_, pitch_, roll_;
+
+  float compassHeading(const Vec3 &magnetom) const;
+  void matrixUpdate(float dt);
+  void driftCorrection(const Vec3 &accel, float heading);
+  void eulerAngles();
+};
+}  // namespace hardware_imu
+
+#endif  // HARDWARE_IMU_DCM_FILTER_H
@@ -0,0 +1,57 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_IMU_ELLIPSOID_FIT_H
+#define HARDWARE_IMU_ELLIPSOID_FIT_H
+
+#include <hardware_imu/matrix.h>
+#include <string>
+
+/*! \file
+* \brief Incremental ellipsoid fit for magnetometer hard and soft iron calibration
+*
+* Fits the general ellipsoid a x^2 + b y^2 + c z^2 + 2d xy + 2e xz + 2f yz + 2g x + 2h y + 2i z = 1 by least squares.
+* Only the normal equations are kept, so memory is constant however long the rotation takes. A sample is only added
+* once the field has moved far enough from the last one added, so holding still in one attitude does not outweigh
+* the rest of the sphere. The result maps a raw reading onto a sphere: corrected = transform * (raw - center).
+*/
+namespace hardware_imu
+{
+class EllipsoidFit
+{
+public:
+  EllipsoidFit();
+
+  void clear();
+  // raw magnetometer reading
+  void add(const Vec3 &raw);
+  int samples() const
+  {
+    return samples_;
+  }
+
+  // false with the reason in error() if the samples do not pin down an ellipsoid, usually too little rotation about
+  // some axis; the transform keeps the mean radius of the raw readings
+  bool solve(Vec3 &center, Mat3 &transform);
+  // rms of |corrected| / radius - 1 over the samples, valid after a successful solve
+  double residual() const
+  {
+    return residual_;
+  }
+  const std::string &error() const
+  {
+    return error_;
+  }
+
+private:
+  static const int params = 9;
+  // upper triangle of sum(phi phi^T) row by row, and sum(phi), with phi the design row of one sample
+  double normal_[params * (params + 1) / 2];
+  double rhs_[params];
+  int samples_;
+  Vec3 last_;
+  Vec3 min_, max_;
+  double residual_;
+  std::string error_;
+};
+}  // namespace hardware_imu
+
+#endif  // HARDWARE_IMU_ELLIPSOID_FIT_H
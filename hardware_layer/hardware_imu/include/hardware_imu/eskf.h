@@ -0,0 +1,78 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_IMU_ESKF_H
+#define HARDWARE_IMU_ESKF_H
+
+#include <hardware_imu/orientation_filter.h>
+
+/*! \file
+* \brief Quaternion error-state Kalman filter for orientation and gyro bias
+*
+* The nominal state is the body to world quaternion and the gyro bias, integrated with every gyro sample. The error
+* state is a body frame rotation vector and a bias error, six floats with a 6x6 covariance kept as three 3x3 blocks.
+* Every sample is followed by the gravity update from the accelerometer and a heading update from the tilt
+* compensated compass. The compass only corrects heading, so magnetic disturbances never tilt the attitude. Updates
+* are applied one scalar at a time and folded into the nominal state right away, so nothing bigger than a 3x3 is ever
+* inverted.
+*/
+namespace hardware_imu
+{
+class Eskf : public OrientationFilter
+{
+public:
+  // standard deviations
+  struct Noise
+  {
+    float gyro;          // rad/s/sqrt(Hz), white noise on the rate
+    float gyroBias;      // rad/s^2/sqrt(Hz), random walk of the bias
+    float accel;         // m/s^2 on a still vehicle, grows with |accel| - g so manoeuvres are trusted less
+    float heading;       // rad, compass heading
+    float initialBias;   // rad/s, bias uncertainty after reset
+  };
+
+  static Noise defaultNoise()
+  {
+    Noise noise = { 0.005f, 0.0001f, 0.3f, 0.05f, 0.02f };
+    return noise;
+  }
+
+  explicit Eskf(const Noise &noise = defaultNoise());
+
+  void reset(const Vec3 &accel, const Vec3 &magnetom);
+  void update(const Vec3 &gyro, const Vec3 &accel, const Vec3 &magnetom, float dt);
+
+  float yaw() const;
+  float pitch() const;
+  float roll() const;
+  Quat orientation() const
+  {
+    return q_;
+  }
+  Vec3 rate() const
+  {
+    return rate_;
+  }
+  const Vec3 &bias() const
+  {
+    return bias_;
+  }
+  bool orientationCovariance(Mat3 &cov) const;
+  bool rateCovariance(Mat3 &cov) const;
+
+private:
+  Noise noise_;
+  Quat q_;
+  Vec3 bias_;
+  Vec3 rate_;
+  float dt_;
+  // covariance [[theta theta, theta bias], [bias theta, bias bias]], the lower left block is the transpose
+  Mat3 ptt_, ptb_, pbb_;
+
+  void predict(const Vec3 &gyro, float dt);
+  void accelUpdate(const Vec3 &accel);
+  void headingUpdate(const Vec3 &magnetom);
+  // one scalar measurement whose jacobian has h for the rotation and zeros for the bias
+  void scalarUpdate(const Vec3 &h, float innovation, float variance);
+};
+}  // namespace hardware_imu
+
+#endif  // HARDWARE_IMU_ESKF_H
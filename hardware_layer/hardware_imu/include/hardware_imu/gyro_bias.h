@@ -0,0 +1,72 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_IMU_GYRO_BIAS_H
+#define HARDWARE_IMU_GYRO_BIAS_H
+
+#include <hardware_imu/matrix.h>
+
+/*! \file
+* \brief Gyro bias tracking whenever the vehicle holds still
+*
+* A window of the last samples decides whether the vehicle is still: the gyro and the accelerometer magnitude both
+* have to be quiet, and the mean rate has to be close to the current bias so a steady turn is not taken for a bias.
+* While still, every sample updates a per axis Kalman estimate of the bias; in between the uncertainty grows with
+* the bias drift, so the next still period is trusted more the longer the vehicle was moving.
+*/
+namespace hardware_imu
+{
+class GyroBiasEstimator
+{
+public:
+  struct Config
+  {
+    int window;            // samples, at most maxWindow
+    float gyroThreshold;   // rad/s, largest standard deviation of the rate over the window
+    float accelThreshold;  // m/s^2, same for the accelerometer magnitude
+    float meanThreshold;   // rad/s, largest distance of the mean rate from the bias, on top of 3 sigma
+    float noise;           // rad/s, gyro noise of one sample
+    float drift;           // rad/s/sqrt(s), random walk of the bias
+    float initialSigma;    // rad/s, bias uncertainty at start
+  };
+
+  static const int maxWindow = 256;
+
+  static Config defaultConfig()
+  {
+    Config config = { 50, 0.01f, 0.05f, 0.01f, 0.007f, 0.0002f, 0.02f };
+    return config;
+  }
+
+  explicit GyroBiasEstimator(const Config &config = defaultConfig());
+
+  // gyro in rad/s as it comes from the sensor, accel in m/s^2; allowed false vetoes updates (thrusters running)
+  void update(const Vec3 &gyro, const Vec3 &accel, float dt, bool allowed);
+
+  bool stationary() const
+  {
+    return stationary_;
+  }
+  const Vec3 &bias() const
+  {
+    return bias_;
+  }
+  Vec3 sigma() const
+  {
+    return Vec3(sqrtf(variance_[0]), sqrtf(variance_[1]), sqrtf(variance_[2]));
+  }
+
+private:
+  Config config_;
+  Vec3 bias_;
+  Vec3 variance_;
+  bool stationary_;
+
+  // the window as a ring with running sums, so each sample costs the same however long it is
+  Vec3 gyros_[maxWindow];
+  float accelNorms_[maxWindow];
+  int next_, count_;
+  double gyroSum_[3], gyroSquares_[3];
+  double accelSum_, accelSquares_;
+};
+}  // namespace hardware_imu
+
+#endif  // HARDWARE_IMU_GYRO_BIAS_H
@@ -0,0 +1,78 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_IMU_IMU_LOG_H
+#define HARDWARE_IMU_IMU_LOG_H
+
+#include <hardware_imu/imu_sample.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string>
+
+/*! \file
+* \brief Binary log of raw NavStik samples
+*
+* A 32 byte header followed by ImuSample records exactly as they came off the reader, in host byte order. The record
+* count is taken from the file size, so a log cut short by a crash is still readable up to its last whole record. The
+* reader maps the file and hands out a pointer to the records, replaying never copies or parses anything.
+*/
+namespace hardware_imu
+{
+struct ImuLogHeader
+{
+  char magic[8];  // "IMULOG\0\0"
+  uint32_t version;
+  uint32_t recordSize;  // sizeof(ImuSample) when it was written
+  char reserved[16];
+};
+
+class ImuLogWriter
+{
+public:
+  ImuLogWriter();
+  ~ImuLogWriter();
+
+  bool open(const std::string &path);
+  void close();
+  bool isOpen() const
+  {
+    return file_ != NULL;
+  }
+  // buffered, a crash loses at most the last few kB
+  bool write(const ImuSample &sample);
+
+private:
+  FILE *file_;
+};
+
+class ImuLogReader
+{
+public:
+  ImuLogReader();
+  ~ImuLogReader();
+
+  // false with error() set if the file is missing or not a log of this version
+  bool open(const std::string &path);
+  void close();
+  const std::string &error() const
+  {
+    return error_;
+  }
+
+  const ImuSample *records() const
+  {
+    return records_;
+  }
+  size_t size() const
+  {
+    return count_;
+  }
+
+private:
+  void *map_;
+  size_t mapLength_;
+  const ImuSample *records_;
+  size_t count_;
+  std::string error_;
+};
+}  // namespace hardware_imu
+
+#endif  // HARDWARE_IMU_IMU_LOG_H
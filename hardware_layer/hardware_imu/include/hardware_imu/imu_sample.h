@@ -0,0 +1,20 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_IMU_IMU_SAMPLE_H
+#define HARDWARE_IMU_IMU_SAMPLE_H
+
+#include <stdint.h>
+
+namespace hardware_imu
+{
+// one NavStik line, all nine axes from the same instant, uncalibrated
+struct ImuSample
+{
+  int64_t stamp;  // steady_clock nanoseconds when the line arrived
+  uint32_t seq;   // lines parsed since the device was opened, gaps mean dropped samples
+  float accel[3];
+  float gyro[3];
+  float mag[3];
+};
+}  // namespace hardware_imu
+
+#endif  // HARDWARE_IMU_IMU_SAMPLE_H
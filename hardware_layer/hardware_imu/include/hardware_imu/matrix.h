@@ -0,0 +1,294 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_IMU_MATRIX_H
+#define HARDWARE_IMU_MATRIX_H
+
+#include <math.h>
+
+/*! \file
+* \brief Fixed size 3 vectors, 3x3 matrices and quaternions for the orientation filters
+*
+* Everything lives on the stack and is inlined. A vector is one 4 lane SIMD register (the fourth lane is always 0), so
+* adds, scales and the row combinations of a matrix product compile to SSE on a PC and NEON on the odroid. The lanes
+* are only 4 byte aligned, objects can be allocated with plain new on 32 bit ARM.
+*/
+namespace hardware_imu
+{
+typedef float Lanes __attribute__((vector_size(16), aligned(4)));
+
+struct Vec3
+{
+  union
+  {
+    Lanes v;
+    float f[4];
+  };
+
+  Vec3()
+  {
+    v = Lanes{ 0, 0, 0, 0 };
+  }
+  Vec3(float x, float y, float z)
+  {
+    v = Lanes{ x, y, z, 0 };
+  }
+  static Vec3 fromLanes(Lanes lanes)
+  {
+    Vec3 r;
+    r.v = lanes;
+    return r;
+  }
+
+  float operator[](int i) const
+  {
+    return f[i];
+  }
+  float &operator[](int i)
+  {
+    return f[i];
+  }
+};
+
+inline Vec3 operator+(const Vec3 &a, const Vec3 &b)
+{
+  return Vec3::fromLanes(a.v + b.v);
+}
+
+inline Vec3 operator-(const Vec3 &a, const Vec3 &b)
+{
+  return Vec3::fromLanes(a.v - b.v);
+}
+
+inline Vec3 operator-(const Vec3 &a)
+{
+  return Vec3::fromLanes(-a.v);
+}
+
+inline Vec3 operator*(const Vec3 &a, float s)
+{
+  return Vec3::fromLanes(a.v * s);
+}
+
+inline Vec3 operator*(float s, const Vec3 &a)
+{
+  return Vec3::fromLanes(a.v * s);
+}
+
+inline Vec3 &operator+=(Vec3 &a, const Vec3 &b)
+{
+  a.v += b.v;
+  return a;
+}
+
+inline float dot(const Vec3 &a, const Vec3 &b)
+{
+  Lanes p = a.v * b.v;
+  return p[0] + p[1] + p[2];
+}
+
+inline Vec3 cross(const Vec3 &a, const Vec3 &b)
+{
+  return Vec3(a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]);
+}
+
+inline float norm(const Vec3 &a)
+{
+  return sqrtf(dot(a, a));
+}
+
+struct Mat3
+{
+  Vec3 row[3];
+
+  static Mat3 identity()
+  {
+    Mat3 m;
+    m.row[0] = Vec3(1, 0, 0);
+    m.row[1] = Vec3(0, 1, 0);
+    m.row[2] = Vec3(0, 0, 1);
+    return m;
+  }
+
+  static Mat3 diagonal(float a, float b, float c)
+  {
+    Mat3 m;
+    m.row[0] = Vec3(a, 0, 0);
+    m.row[1] = Vec3(0, b, 0);
+    m.row[2] = Vec3(0, 0, c);
+    return m;
+  }
+
+  float operator()(int r, int c) const
+  {
+    return row[r][c];
+  }
+  float &operator()(int r, int c)
+  {
+    return row[r][c];
+  }
+};
+
+// each output row is a combination of the rows of b, three lane wide multiply-adds
+inline Mat3 operator*(const Mat3 &a, const Mat3 &b)
+{
+  Mat3 r;
+  for (int i = 0; i < 3; i++)
+    r.row[i].v = a.row[i].v[0] * b.row[0].v + a.row[i].v[1] * b.row[1].v + a.row[i].v[2] * b.row[2].v;
+  return r;
+}
+
+inline Vec3 operator*(const Mat3 &a, const Vec3 &b)
+{
+  return Vec3(dot(a.row[0], b), dot(a.row[1], b), dot(a.row[2], b));
+}
+
+inline Mat3 operator+(const Mat3 &a, const Mat3 &b)
+{
+  Mat3 r;
+  for (int i = 0; i < 3; i++)
+    r.row[i] = a.row[i] + b.row[i];
+  return r;
+}
+
+inline Mat3 operator-(const Mat3 &a, const Mat3 &b)
+{
+  Mat3 r;
+  for (int i = 0; i < 3; i++)
+    r.row[i] = a.row[i] - b.row[i];
+  return r;
+}
+
+inline Mat3 operator*(const Mat3 &a, float s)
+{
+  Mat3 r;
+  for (int i = 0; i < 3; i++)
+    r.row[i] = a.row[i] * s;
+  return r;
+}
+
+inline Mat3 transpose(const Mat3 &a)
+{
+  Mat3 r;
+  for (int i = 0; i < 3; i++)
+    r.row[i] = Vec3(a(0, i), a(1, i), a(2, i));
+  return r;
+}
+
+// a * b^T
+inline Mat3 outer(const Vec3 &a, const Vec3 &b)
+{
+  Mat3 r;
+  for (int i = 0; i < 3; i++)
+    r.row[i] = b * a[i];
+  return r;
+}
+
+// cross product matrix, skew(a) * b == cross(a, b)
+inline Mat3 skew(const Vec3 &a)
+{
+  Mat3 m;
+  m.row[0] = Vec3(0, -a[2], a[1]);
+  m.row[1] = Vec3(a[2], 0, -a[0]);
+  m.row[2] = Vec3(-a[1], a[0], 0);
+  return m;
+}
+
+// Euler angles, right-handed, intrinsic, XYZ convention (rotate around body axes Z, Y', X'')
+inline Mat3 fromEuler(float yaw, float pitch, float roll)
+{
+  float c1 = cosf(roll), s1 = sinf(roll);
+  float c2 = cosf(pitch), s2 = sinf(pitch);
+  float c3 = cosf(yaw), s3 = sinf(yaw);
+  Mat3 m;
+  m.row[0] = Vec3(c2 * c3, c3 * s1 * s2 - c1 * s3, s1 * s3 + c1 * c3 * s2);
+  m.row[1] = Vec3(c2 * s3, c1 * c3 + s1 * s2 * s3, c1 * s2 * s3 - c3 * s1);
+  m.row[2] = Vec3(-s2, c2 * s1, c1 * c2);
+  return m;
+}
+
+// first order renormalization of a rotation matrix (Premerlani and Bizard, eq. 19-21)
+inline void orthonormalize(Mat3 &m)
+{
+  float error = -dot(m.row[0], m.row[1]) * 0.5f;
+  Vec3 x = m.row[0] + m.row[1] * error;
+  Vec3 y = m.row[1] + m.row[0] * error;
+  Vec3 z = cross(x, y);
+  m.row[0] = x * (0.5f * (3 - dot(x, x)));
+  m.row[1] = y * (0.5f * (3 - dot(y, y)));
+  m.row[2] = z * (0.5f * (3 - dot(z, z)));
+}
+
+// unit quaternion, w + xi + yj + zk, rotating body vectors into the world frame like the matrices above
+struct Quat
+{
+  float w, x, y, z;
+
+  Quat() : w(1), x(0), y(0), z(0)
+  {
+  }
+  Quat(float w, float x, float y, float z) : w(w), x(x), y(y), z(z)
+  {
+  }
+};
+
+// a then b in the body frame
+inline Quat operator*(const Quat &a, const Quat &b)
+{
+  return Quat(a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z, a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+              a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x, a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w);
+}
+
+inline Quat normalized(const Quat &q)
+{
+  float n = 1 / sqrtf(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+  return Quat(q.w * n, q.x * n, q.y * n, q.z * n);
+}
+
+// rotation of |v| radians about v
+inline Quat fromRotationVector(const Vec3 &v)
+{
+  float angle = norm(v);
+  if (angle < 1e-6f)
+    return normalized(Quat(1, 0.5f * v[0], 0.5f * v[1], 0.5f * v[2]));
+  float s = sinf(0.5f * angle) / angle;
+  return Quat(cosf(0.5f * angle), v[0] * s, v[1] * s, v[2] * s);
+}
+
+inline Mat3 toMat3(const Quat &q)
+{
+  Mat3 m;
+  m.row[0] = Vec3(1 - 2 * (q.y * q.y + q.z * q.z), 2 * (q.x * q.y - q.w * q.z), 2 * (q.x * q.z + q.w * q.y));
+  m.row[1] = Vec3(2 * (q.x * q.y + q.w * q.z), 1 - 2 * (q.x * q.x + q.z * q.z), 2 * (q.y * q.z - q.w * q.x));
+  m.row[2] = Vec3(2 * (q.x * q.z - q.w * q.y), 2 * (q.y * q.z + q.w * q.x), 1 - 2 * (q.x * q.x + q.y * q.y));
+  return m;
+}
+
+// Shepperd's method, picks the largest diagonal term so the square root never sees a small number
+inline Quat fromMat3(const Mat3 &m)
+{
+  float trace = m(0, 0) + m(1, 1) + m(2, 2);
+  Quat q;
+  if (trace > 0)
+  {
+    float s = 2 * sqrtf(1 + trace);
+    q = Quat(0.25f * s, (m(2, 1) - m(1, 2)) / s, (m(0, 2) - m(2, 0)) / s, (m(1, 0) - m(0, 1)) / s);
+  }
+  else if (m(0, 0) > m(1, 1) && m(0, 0) > m(2, 2))
+  {
+    float s = 2 * sqrtf(1 + m(0, 0) - m(1, 1) - m(2, 2));
+    q = Quat((m(2, 1) - m(1, 2)) / s, 0.25f * s, (m(0, 1) + m(1, 0)) / s, (m(0, 2) + m(2, 0)) / s);
+  }
+  else if (m(1, 1) > m(2, 2))
+  {
+    float s = 2 * sqrtf(1 + m(1, 1) - m(0, 0) - m(2, 2));
+    q = Quat((m(0, 2) - m(2, 0)) / s, (m(0, 1) + m(1, 0)) / s, 0.25f * s, (m(1, 2) + m(2, 1)) / s);
+  }
+  else
+  {
+    float s = 2 * sqrtf(1 + m(2, 2) - m(0, 0) - m(1, 1));
+    q = Quat((m(1, 0) - m(0, 1)) / s, (m(0, 2) + m(2, 0)) / s, (m(1, 2) + m(2, 1)) / s, 0.25f * s);
+  }
+  return normalized(q);
+}
+}  // namespace hardware_imu
+
+#endif  // HARDWARE_IMU_MATRIX_H
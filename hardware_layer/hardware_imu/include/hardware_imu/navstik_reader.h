@@ -0,0 +1,88 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_IMU_NAVSTIK_READER_H
+#define HARDWARE_IMU_NAVSTIK_READER_H
+
+#include <hardware_imu/imu_sample.h>
+#include <stddef.h>
+#include <string>
+
+/*! \file
+* \brief Streaming reader for the NavStik text output
+*
+* The device prints one line per sample with all nine axes:
+*
+*     NAVSTIK1: ax       ay       az       gx       gy       gz       mx       my       mz
+*
+* with every field 7 characters wide at a 9 character pitch. The reader keeps the device open non-blocking, collects
+* bytes in fixed buffers and parses each line once into an ImuSample, so the nine axes always come from one line and
+* nothing is allocated per sample.
+*
+* All lines of one read() arrive at once. Only the last one is stamped with the time of the read, the ones before it
+* are back-dated one sample period each, squeezed into the time since the previous sample if that is shorter, so a
+* burst neither piles up in one step nor stretches the time the filter integrates.
+*/
+namespace hardware_imu
+{
+class NavStikReader
+{
+public:
+  enum Status
+  {
+    fine,
+    not_connected
+  };
+
+  explicit NavStikReader(const std::string &path = "/dev/navstik");
+  ~NavStikReader();
+
+  // opens the device and asks it for usb output; false if it is not there
+  bool open();
+  void close();
+
+  // the rate the device prints samples at, 100 by default
+  void setSampleRate(double rate);
+
+  Status status() const
+  {
+    return stat_;
+  }
+  const std::string &path() const
+  {
+    return path_;
+  }
+  // lines that looked like a sample but could not be parsed
+  unsigned long badLines() const
+  {
+    return badLines_;
+  }
+
+  // waits up to timeoutMs for the next sample; false on timeout or when the device went away (status says which)
+  bool read(ImuSample &sample, int timeoutMs);
+
+private:
+  static const size_t chunkSize = 256;
+  static const size_t maxLine = 128;
+
+  std::string path_;
+  int fd_;
+  Status stat_;
+  char chunk_[chunkSize];  // last read(), chunkPos_ is the first byte not yet looked at
+  size_t chunkPos_, chunkEnd_;
+  int64_t chunkStamp_;
+  size_t chunkLines_;  // lines that end in the last read(), chunkLine_ of them were looked at
+  size_t chunkLine_;
+  int64_t lineStep_;   // between the stamps of the lines of the last read()
+  int64_t lastStamp_;  // of the last sample, 0 after open()
+  int64_t samplePeriod_;
+  char line_[maxLine + 1];
+  size_t lineLength_;
+  bool lineOverflow_;  // current line is longer than any sample, skip to the next newline
+  uint32_t seq_;
+  unsigned long badLines_;
+
+  // true when line_ holds a complete, valid sample
+  bool parseLine(ImuSample &sample);
+};
+}  // namespace hardware_imu
+
+#endif  // HARDWARE_IMU_NAVSTIK_READER_H
@@ -0,0 +1,48 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_IMU_ORIENTATION_FILTER_H
+#define HARDWARE_IMU_ORIENTATION_FILTER_H
+
+#include <hardware_imu/matrix.h>
+
+/*! \file
+* \brief Common interface of the orientation estimators
+*
+* The imu node only talks to this, so the estimator can be switched with a parameter and several of them can be fed
+* the same samples.
+*/
+namespace hardware_imu
+{
+class OrientationFilter
+{
+public:
+  virtual ~OrientationFilter()
+  {
+  }
+
+  // orientation straight from one accelerometer and magnetometer sample
+  virtual void reset(const Vec3 &accel, const Vec3 &magnetom) = 0;
+  // gyro in rad/s, accel in m/s^2, magnetom in any unit, dt in s
+  virtual void update(const Vec3 &gyro, const Vec3 &accel, const Vec3 &magnetom, float dt) = 0;
+
+  // radians, yaw about world z, pitch about y', roll about x''
+  virtual float yaw() const = 0;
+  virtual float pitch() const = 0;
+  virtual float roll() const = 0;
+  // body to world
+  virtual Quat orientation() const = 0;
+  // body frame angular velocity with the filter's bias estimate removed, rad/s
+  virtual Vec3 rate() const = 0;
+
+  // covariances in the world frame (orientation) and body frame (rate); false if the filter does not estimate them
+  virtual bool orientationCovariance(Mat3 & /* cov */) const
+  {
+    return false;
+  }
+  virtual bool rateCovariance(Mat3 & /* cov */) const
+  {
+    return false;
+  }
+};
+}  // namespace hardware_imu
+
+#endif  // HARDWARE_IMU_ORIENTATION_FILTER_H
@@ -0,0 +1,59 @@
+// Copyright 2016 AUV-IITK
+#ifndef HARDWARE_IMU_SPSC_RING_H
+#define HARDWARE_IMU_SPSC_RING_H
+
+#include <atomic>
+
+namespace hardware_imu
+{
+/*! \brief Fixed size single producer single consumer queue
+*
+* One thread pushes, one other thread pops, neither ever blocks or allocates. The indices only grow and wrap with the
+* unsigned overflow, N has to be a power of two for that to stay consistent. The two indices sit on their own cache
+* lines so the producer and consumer do not keep stealing each other's line.
+*/
+template <typename T, unsigned N>
+class SpscRing
+{
+  static_assert(N && (N & (N - 1)) == 0, "ring size must be a power of two");
+
+public:
+  SpscRing() : head_(0), tail_(0)
+  {
+  }
+
+  // producer; false when full, the item is dropped
+  bool push(const T &item)
+  {
+    unsigned head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == N)
+      return false;
+    items_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer; false when empty
+  bool pop(T &item)
+  {
+    unsigned tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire))
+      return false;
+    item = items_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  unsigned size() const
+  {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+private:
+  T items_[N];
+  alignas(64) std::atomic<unsigned> head_;
+  alignas(64) std::atomic<unsigned> tail_;
+};
+}  // namespace hardware_imu
+
+#endif  // HARDWARE_IMU_SPSC_RING_H
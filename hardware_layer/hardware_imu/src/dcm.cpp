@@ -1,103 +1,396 @@
 // Copyright 2016 AUV-IITK
 #include "ros/ros.h"
 #include "std_msgs/Float64.h"
+#include "std_msgs/Bool.h"
 #include "sensor_msgs/Imu.h"
+#include "hardware_arduino/ThrusterCommand.h"
+#include "hardware_imu/GyroBias.h"
 #include <math.h>
-#include "math"
-#include "DCM"
-#include <time.h>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/sensor_board.h>
+#include <hardware_imu/dcm_filter.h>
+#include <hardware_imu/ellipsoid_fit.h>
+#include <hardware_imu/eskf.h>
+#include <hardware_imu/gyro_bias.h>
+#include <hardware_imu/spsc_ring.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "caliberation"
 
-void output_angles()
+#define TO_RAD(x) (x * 0.01745329252)  // *pi/180
+#define TO_DEG(x) (x * 57.2957795131)  // *180/pi
+
+typedef std::chrono::steady_clock Clock;
+using hardware_imu::Mat3;
+using hardware_imu::Quat;
+using hardware_imu::Vec3;
+
+// latest output of the fusion thread, picked up by the publisher at its own rate
+struct FusionOutput
+{
+  float yaw, pitch, roll;
+  Quat orientation;
+  Vec3 rate;   // rad/s, bias removed
+  Vec3 accel;  // m/s^2
+  Mat3 orientationCov, rateCov;
+  bool hasOrientationCov, hasRateCov;
+  Vec3 bias, biasSigma;  // rad/s, removed from the gyro before the filter
+  bool stationary;
+  ros::Time stamp;
+};
+
+boost::mutex outputMutex;
+FusionOutput output;
+hardware_imu::OrientationFilter *filter;
+// filled by the reader thread, emptied by the fusion thread
+hardware_imu::SpscRing<hardware_imu::ImuSample, 64> samples;
+
+// guards magCenter and magTransform from caliberation, and the fit while it is collecting
+boost::mutex calibrationMutex;
+hardware_imu::EllipsoidFit magFit;
+bool calibratingMag = false;
+std::string magCalibrationFile;
+
+// every fusion step goes on the board, the topics only go out at publish_rate
+hardware_commons::SensorBoard sensorBoard;
+
+hardware_imu::GyroBiasEstimator *biasEstimator;
+// steady_clock ns of the last thruster command with any pwm in it, the bias is only learnt a while after that
+std::atomic<int64_t> lastThrust(0);
+int64_t settleTime = 1000000000;
+
+int64_t steadyNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+void thrustersListener(hardware_arduino::ThrusterCommand msg)
+{
+  for (size_t i = 0; i < msg.pwm.size(); i++)
+    if (msg.pwm[i] != 0)
+    {
+      lastThrust = steadyNs();
+      return;
+    }
+}
+
+void fillCovariance(boost::array<double, 9> &out, const Mat3 &cov, bool valid)
+{
+  for (int r = 0; r < 3; r++)
+    for (int c = 0; c < 3; c++)
+      out[3 * r + c] = cov(r, c);
+  if (!valid)
+    out[0] = -1;
+}
+
+void read_sensors(const hardware_imu::ImuSample &sample)
+{
+  Read_Gyro(sample);
+  Read_Accel(sample);
+  Read_Magn(sample);
+}
+
+// only reads and parses the device, so a slow fusion step never lets the serial buffer overflow
+void readLoop()
+{
+  while (ros::ok())
+  {
+    // blocks until the navstik has a new line
+    hardware_imu::ImuSample sample = nextSample();
+    if (!samples.push(sample))
+      ROS_WARN_THROTTLE(1, "fusion is falling behind, dropping imu samples");
+  }
+}
+
+// runs the filter once per sensor sample; dt comes from the sample stamps, not from when the thread got to them
+void fusionLoop(double sampleRate)
+{
+  const float nominalDt = 1 / sampleRate;
+  bool first = true;
+  int64_t last = 0;
+
+  while (ros::ok())
+  {
+    hardware_imu::ImuSample sample;
+    if (!samples.pop(sample))
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    // the first sample and the one after a reconnect get the nominal step
+    float dt = first ? nominalDt : (sample.stamp - last) * 1e-9f;
+    if (dt <= 0 || dt > 10 * nominalDt)
+      dt = nominalDt;
+    first = false;
+    last = sample.stamp;
+
+    {
+      boost::mutex::scoped_lock lock(calibrationMutex);
+      read_sensors(sample);
+      if (calibratingMag)
+        magFit.add(Vec3(sample.mag[0], sample.mag[1], sample.mag[2]));
+    }
+    Vec3 gyroRad(TO_RAD(GYRO_GAIN) * gyro[0], TO_RAD(GYRO_GAIN) * gyro[1], TO_RAD(GYRO_GAIN) * gyro[2]);
+    Vec3 accelVector(accel[0], accel[1], accel[2]);
+    biasEstimator->update(gyroRad, accelVector, dt, sample.stamp - lastThrust > settleTime);
+    filter->update(gyroRad - biasEstimator->bias(), accelVector, Vec3(magnetom[0], magnetom[1], magnetom[2]), dt);
+
+    // back-date the ros stamp by how long the sample waited since it came off the wire
+    int64_t age = steadyNs() - sample.stamp;
+    {
+      boost::mutex::scoped_lock lock(outputMutex);
+      output.yaw = filter->yaw();
+      output.pitch = filter->pitch();
+      output.roll = filter->roll();
+      output.orientation = filter->orientation();
+      output.rate = filter->rate();
+      output.accel = accelVector;
+      output.hasOrientationCov = filter->orientationCovariance(output.orientationCov);
+      output.hasRateCov = filter->rateCovariance(output.rateCov);
+      output.bias = biasEstimator->bias();
+      output.biasSigma = biasEstimator->sigma();
+      output.stationary = biasEstimator->stationary();
+      output.stamp = ros::Time::now() - ros::Duration(age * 1e-9);
+    }
+    Vec3 rate = filter->rate();
+    double state[6] = { TO_DEG(filter->yaw()), TO_DEG(filter->pitch()), TO_DEG(filter->roll()),
+                        TO_DEG(rate[0]),       TO_DEG(rate[1]),         TO_DEG(rate[2]) };
+    sensorBoard.write(hardware_commons::IMU, state, 6, sample.stamp);
+  }
+}
+
+// loaded by imu.launch at the next start
+bool saveMagCalibration(const std::string &path, const std::vector<double> &center,
+                        const std::vector<double> &transform)
 {
-  if (output_format == OUTPUT__FORMAT_BINARY)
+  FILE *file = fopen(path.c_str(), "w");
+  if (!file)
+    return false;
+  fprintf(file, "# magnetometer calibration written by the dcm node, magnetom = mag_transform * (raw - mag_center)\n");
+  fprintf(file, "mag_center: [%.6f, %.6f, %.6f]\n", center[0], center[1], center[2]);
+  fprintf(file, "mag_transform: [");
+  for (int i = 0; i < 9; i++)
+    fprintf(file, "%.6f%s", transform[i], i < 8 ? ", " : "]\n");
+  return fclose(file) == 0;
+}
+
+// true starts collecting samples for the fit, rotate the vehicle about every axis; false fits, applies and saves it
+void magCalibrationListener(std_msgs::Bool msg)
+{
+  boost::mutex::scoped_lock lock(calibrationMutex);
+  if (msg.data)
+  {
+    magFit.clear();
+    calibratingMag = true;
+    ROS_INFO("magnetometer calibration started, rotate the vehicle about every axis");
+    return;
+  }
+  if (!calibratingMag)
+    return;
+  calibratingMag = false;
+
+  Vec3 center;
+  Mat3 transform;
+  if (!magFit.solve(center, transform))
   {
-    float ypr[3];
-    ypr[0] = TO_DEG(yaw);
-    ypr[1] = TO_DEG(pitch);
-    ypr[2] = TO_DEG(roll);
+    ROS_WARN("magnetometer calibration failed after %d samples: %s", magFit.samples(), magFit.error().c_str());
+    return;
   }
-  else if (output_format == OUTPUT__FORMAT_TEXT)
+  magCenter = center;
+  magTransform = transform;
+
+  std::vector<double> centerParam(3), transformParam(9);
+  for (int i = 0; i < 3; i++)
   {
-    // printf(" YPR=");
-    // printf("%f\t",TO_DEG(yaw));
-    // printf("%f\t",TO_DEG(pitch));
-    // printf("%f\n",TO_DEG(roll));
+    centerParam[i] = center[i];
+    for (int j = 0; j < 3; j++)
+      transformParam[3 * i + j] = transform(i, j);
   }
+  ros::param::set("dcm/mag_center", centerParam);
+  ros::param::set("dcm/mag_transform", transformParam);
+  ROS_INFO("magnetometer calibrated from %d samples, residual %.1f%%, center %f %f %f", magFit.samples(),
+           100 * magFit.residual(), center[0], center[1], center[2]);
+  if (!magCalibrationFile.empty() && !saveMagCalibration(magCalibrationFile, centerParam, transformParam))
+    ROS_ERROR("cannot save the magnetometer calibration to %s", magCalibrationFile.c_str());
 }
 
 int main(int argc, char **argv)
 {
   ros::init(argc, argv, "dcm");
   ros::NodeHandle n;
-  ros::Publisher out_pub = n.advertise<sensor_msgs::Imu>("imuyrp", 1000);
+  ros::Publisher out_pub = hardware_commons::advertise<sensor_msgs::Imu>(n, "imuyrp", hardware_commons::LATEST);
   ros::NodeHandle nh;
-  ros::Publisher chatter_pub = nh.advertise<std_msgs::Float64>("/varun/sensors/imu/yaw", 1000);
+  ros::Publisher chatter_pub =
+      hardware_commons::advertise<std_msgs::Float64>(nh, "/varun/sensors/imu/yaw", hardware_commons::LATEST);
+  ros::Publisher data_pub =
+      hardware_commons::advertise<sensor_msgs::Imu>(nh, "/varun/sensors/imu/data", hardware_commons::LATEST);
   sensor_msgs::Imu imu_msg;
+  sensor_msgs::Imu data_msg;
   std_msgs::Float64 msg;
 
-  // Read sensors, init DCM algorithm
-  removegyrooff();
+  double sample_rate = 100, publish_rate = 20;
+  nh.getParam("dcm/sample_rate", sample_rate);
+  nh.getParam("dcm/publish_rate", publish_rate);
+  // the lines of one read of the navstik are stamped this far apart
+  nav.setSampleRate(sample_rate);
+  hardware_imu::DcmFilter::Gains gains = hardware_imu::DcmFilter::defaultGains();
+  nh.getParam("dcm/kp_rollpitch", gains.kpRollPitch);
+  nh.getParam("dcm/ki_rollpitch", gains.kiRollPitch);
+  nh.getParam("dcm/kp_yaw", gains.kpYaw);
+  nh.getParam("dcm/ki_yaw", gains.kiYaw);
+  hardware_imu::Eskf::Noise noise = hardware_imu::Eskf::defaultNoise();
+  nh.getParam("dcm/eskf/gyro_noise", noise.gyro);
+  nh.getParam("dcm/eskf/gyro_bias_noise", noise.gyroBias);
+  nh.getParam("dcm/eskf/accel_noise", noise.accel);
+  nh.getParam("dcm/eskf/heading_noise", noise.heading);
+  nh.getParam("dcm/eskf/initial_bias", noise.initialBias);
+  std::string estimator = "dcm";
+  nh.getParam("dcm/estimator", estimator);
+  std::string recordFile;
+  nh.getParam("dcm/record_file", recordFile);
+  nh.getParam("dcm/mag_calibration_file", magCalibrationFile);
+
+  std::vector<double> centerParam, transformParam;
+  if (nh.getParam("dcm/mag_center", centerParam) && nh.getParam("dcm/mag_transform", transformParam) &&
+      centerParam.size() == 3 && transformParam.size() == 9)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      magCenter[i] = centerParam[i];
+      for (int j = 0; j < 3; j++)
+        magTransform(i, j) = transformParam[3 * i + j];
+    }
+    ROS_INFO("loaded the magnetometer calibration");
+  }
+  hardware_imu::GyroBiasEstimator::Config biasConfig = hardware_imu::GyroBiasEstimator::defaultConfig();
+  double settle = 1;
+  nh.getParam("dcm/bias/window", biasConfig.window);
+  nh.getParam("dcm/bias/gyro_threshold", biasConfig.gyroThreshold);
+  nh.getParam("dcm/bias/accel_threshold", biasConfig.accelThreshold);
+  nh.getParam("dcm/bias/mean_threshold", biasConfig.meanThreshold);
+  nh.getParam("dcm/bias/noise", biasConfig.noise);
+  nh.getParam("dcm/bias/drift", biasConfig.drift);
+  nh.getParam("dcm/bias/initial_sigma", biasConfig.initialSigma);
+  nh.getParam("dcm/bias/settle_time", settle);
+  settleTime = settle * 1e9;
+  biasEstimator = new hardware_imu::GyroBiasEstimator(biasConfig);
+  ros::Subscriber thrusters_sub = hardware_commons::subscribe<hardware_arduino::ThrusterCommand>(
+      nh, "/pwm/thrusters", hardware_commons::LATEST, &thrustersListener);
+  ros::Publisher bias_pub = hardware_commons::advertise<hardware_imu::GyroBias>(nh, "/varun/sensors/imu/gyro_bias",
+                                                                                hardware_commons::LATEST);
+  hardware_imu::GyroBias bias_msg;
+  ros::Time lastBiasPublish;
 
-  reset_sensor_fusion();
-  float Y = 0.0;
-  int i = 0;
-  ros::Rate loopRate(10);
+  ros::Subscriber mag_calibration_sub = hardware_commons::subscribe<std_msgs::Bool>(
+      nh, "/varun/sensors/imu/mag_calibration_switch", hardware_commons::EVENTS, &magCalibrationListener);
 
-  // float temp=0;
-  timestamp = clock();
+  // raw samples for imu_replay, from the very first one on
+  if (!recordFile.empty())
+  {
+    if (sampleLog.open(recordFile))
+      ROS_INFO("recording imu samples to %s", recordFile.c_str());
+    else
+      ROS_ERROR("cannot record imu samples to %s", recordFile.c_str());
+  }
+
+  if (!sensorBoard.open())
+    ROS_WARN("%s, the orientation only goes out on the topics", sensorBoard.error().c_str());
 
+  // no startup offset window, the bias estimator refines the fixed offsets whenever the vehicle is still
+  if (estimator == "eskf")
+    filter = new hardware_imu::Eskf(noise);
+  else if (estimator == "dcm")
+    filter = new hardware_imu::DcmFilter(gains);
+  else
+  {
+    ROS_ERROR("unknown estimator %s, use dcm or eskf", estimator.c_str());
+    return 1;
+  }
+  ROS_INFO("orientation estimator: %s", estimator.c_str());
+  read_sensors(nextSample());
+  filter->reset(Vec3(accel[0], accel[1], accel[2]), Vec3(magnetom[0], magnetom[1], magnetom[2]));
+  output.yaw = filter->yaw();
+  output.pitch = filter->pitch();
+  output.roll = filter->roll();
+  output.orientation = filter->orientation();
+  output.hasOrientationCov = output.hasRateCov = false;
+  output.stationary = false;
+  boost::thread fusionThread(&fusionLoop, sample_rate);
+  boost::thread readerThread(&readLoop);
+
+  ros::Rate loopRate(publish_rate);
   while (ros::ok())
   {
-    // Time to read the sensors again?
-    if ((clock() - timestamp) >= OUTPUT__DATA_INTERVAL)
+    FusionOutput latest;
+    {
+      boost::mutex::scoped_lock lock(outputMutex);
+      latest = output;
+    }
+
+    imu_msg = sensor_msgs::Imu();
+    imu_msg.header.stamp = latest.stamp;
+    imu_msg.header.frame_id = "imu";
+    imu_msg.orientation.x = TO_DEG(latest.pitch);
+    imu_msg.orientation.y = TO_DEG(latest.roll);
+    imu_msg.orientation.z = TO_DEG(latest.yaw);
+    imu_msg.orientation.w = 0.0;
+    imu_msg.orientation_covariance[0] = -1;
+    imu_msg.angular_velocity.x = latest.rate[0];
+    imu_msg.angular_velocity.y = latest.rate[1];
+    imu_msg.angular_velocity.z = latest.rate[2];
+    imu_msg.angular_velocity_covariance[0] = -1;
+    imu_msg.linear_acceleration.x = 0.0;
+    imu_msg.linear_acceleration.y = 0.0;
+    imu_msg.linear_acceleration.z = 0.0;
+    imu_msg.linear_acceleration_covariance[0] = -1;
+
+    // the same estimate as a proper quaternion for anything that wants to use it as a sensor_msgs/Imu
+    data_msg = sensor_msgs::Imu();
+    data_msg.header = imu_msg.header;
+    data_msg.orientation.w = latest.orientation.w;
+    data_msg.orientation.x = latest.orientation.x;
+    data_msg.orientation.y = latest.orientation.y;
+    data_msg.orientation.z = latest.orientation.z;
+    fillCovariance(data_msg.orientation_covariance, latest.orientationCov, latest.hasOrientationCov);
+    data_msg.angular_velocity = imu_msg.angular_velocity;
+    fillCovariance(data_msg.angular_velocity_covariance, latest.rateCov, latest.hasRateCov);
+    data_msg.linear_acceleration.x = latest.accel[0];
+    data_msg.linear_acceleration.y = latest.accel[1];
+    data_msg.linear_acceleration.z = latest.accel[2];
+    data_msg.linear_acceleration_covariance[0] = -1;
+
+    msg.data = TO_DEG(latest.yaw);
+    chatter_pub.publish(msg);
+    out_pub.publish(imu_msg);
+    data_pub.publish(data_msg);
+
+    if ((latest.stamp - lastBiasPublish).toSec() >= 1)
     {
-      timestamp_old = timestamp;
-      timestamp = clock();
-      if (timestamp > timestamp_old)
+      bias_msg.stamp = latest.stamp;
+      for (int i = 0; i < 3; i++)
       {
-        G_Dt = static_cast<float>((timestamp - timestamp_old) / 10000.0f);  // Real time of loop run. We use this on the
-                                                                            // DCM algorithm (gyro integration time)
-        // temp+= G_Dt;
+        bias_msg.bias[i] = latest.bias[i];
+        bias_msg.sigma[i] = latest.biasSigma[i];
       }
-      else
-        G_Dt = 0;
-
-      // cout << G_Dt << endl;
-      // Update sensor readings
-      read_sensors();
-
-      // Run DCM algorithm
-      Compass_Heading();  // Calculate magnetic heading
-      Matrix_update();
-      Normalize();
-      Drift_correction();
-      Euler_angles();
-      output_angles();
-
-      imu_msg = sensor_msgs::Imu();
-      imu_msg.header.stamp = ros::Time::now();
-      imu_msg.header.frame_id = "imu";
-      imu_msg.orientation.x = TO_DEG(pitch);
-      imu_msg.orientation.y = TO_DEG(roll);
-      imu_msg.orientation.z = TO_DEG(yaw);
-      imu_msg.orientation.w = 0.0;
-      imu_msg.orientation_covariance[0] = -1;
-      imu_msg.angular_velocity.x = 0.0;
-      imu_msg.angular_velocity.y = 0.0;
-      imu_msg.angular_velocity.z = 0.0;
-      imu_msg.angular_velocity_covariance[0] = -1;
-      imu_msg.linear_acceleration.x = 0.0;
-      imu_msg.linear_acceleration.y = 0.0;
-      imu_msg.linear_acceleration.z = 0.0;
-      imu_msg.linear_acceleration_covariance[0] = -1;
-
-      msg.data = TO_DEG(yaw);
-      chatter_pub.publish(msg);
-      out_pub.publish(imu_msg);
-
-      // cout << temp << endl;
-      ROS_INFO("%s %f", "send an imu message", TO_DEG(yaw));
+      bias_msg.stationary = latest.stationary;
+      bias_pub.publish(bias_msg);
+      lastBiasPublish = latest.stamp;
     }
+
+    ROS_DEBUG("%s %f", "send an imu message", TO_DEG(latest.yaw));
+    ros::spinOnce();
     loopRate.sleep();
   }
+  fusionThread.join();
+  // the reader may be stuck waiting for the device to come back, do not wait for it for long
+  if (readerThread.timed_join(boost::posix_time::seconds(2)))
+    sampleLog.close();
+  else
+    readerThread.detach();
+  return 0;
 }
@@ -0,0 +1,78 @@
+// Copyright 2016 AUV-IITK
+#include <hardware_imu/dcm_filter.h>
+#include <math.h>
+
+namespace hardware_imu
+{
+DcmFilter::DcmFilter(const Gains &gains)
+  : gains_(gains), dcm_(Mat3::identity()), yaw_(0), pitch_(0), roll_(0)
+{
+}
+
+void DcmFilter::reset(const Vec3 &accel, const Vec3 &magnetom)
+{
+  const Vec3 xAxis(1, 0, 0);
+  // pitch from the y-z-plane-component/x-component of gravity
+  pitch_ = -atan2f(accel[0], sqrtf(accel[1] * accel[1] + accel[2] * accel[2]));
+  // roll with the pitch compensated, the x-z-plane-component then equals the z-component
+  Vec3 compensated = cross(xAxis, cross(accel, xAxis));
+  roll_ = atan2f(compensated[1], compensated[2]);
+  yaw_ = compassHeading(magnetom);
+
+  dcm_ = fromEuler(yaw_, pitch_, roll_);
+  omegaP_ = Vec3();
+  omegaI_ = Vec3();
+}
+
+void DcmFilter::update(const Vec3 &gyro, const Vec3 &accel, const Vec3 &magnetom, float dt)
+{
+  gyro_ = gyro;
+  // heading uses the attitude of the previous step, as the original loop did
+  float heading = compassHeading(magnetom);
+  matrixUpdate(dt);
+  orthonormalize(dcm_);
+  driftCorrection(accel, heading);
+  eulerAngles();
+}
+
+float DcmFilter::compassHeading(const Vec3 &magnetom) const
+{
+  float cosRoll = cosf(roll_), sinRoll = sinf(roll_);
+  float cosPitch = cosf(pitch_), sinPitch = sinf(pitch_);
+  // tilt compensated magnetic field
+  float magX = magnetom[0] * cosPitch + magnetom[1] * sinRoll * sinPitch + magnetom[2] * cosRoll * sinPitch;
+  float magY = magnetom[1] * cosRoll - magnetom[2] * sinRoll;
+  return atan2f(-magY, magX);
+}
+
+void DcmFilter::matrixUpdate(float dt)
+{
+  Vec3 omega = gyro_ + omegaI_ + omegaP_;
+  dcm_ = dcm_ + dcm_ * skew(omega * dt);
+}
+
+void DcmFilter::driftCorrection(const Vec3 &accel, float heading)
+{
+  // roll and pitch; weight the accelerometer by how close it is to 1 g (<0.5G = 0.0, 1G = 1.0 , >1.5G = 0.0)
+  float accelMagnitude = norm(accel) / 9.81f;
+  float accelWeight = 1 - 2 * fabsf(1 - accelMagnitude);
+  accelWeight = accelWeight < 0 ? 0 : (accelWeight > 1 ? 1 : accelWeight);
+
+  Vec3 errorRollPitch = cross(accel, dcm_.row[2]);
+  omegaP_ = errorRollPitch * (gains_.kpRollPitch * accelWeight);
+  omegaI_ += errorRollPitch * (gains_.kiRollPitch * accelWeight);
+
+  // yaw from the compass heading
+  float errorCourse = dcm_(0, 0) * sinf(heading) - dcm_(1, 0) * cosf(heading);
+  Vec3 errorYaw = dcm_.row[2] * errorCourse;
+  omegaP_ += errorYaw * gains_.kpYaw;
+  omegaI_ += errorYaw * gains_.kiYaw;
+}
+
+void DcmFilter::eulerAngles()
+{
+  pitch_ = -asinf(dcm_(2, 0));
+  roll_ = atan2f(dcm_(2, 1), dcm_(2, 2));
+  yaw_ = atan2f(dcm_(1, 0), dcm_(0, 0));
+}
+}  // namespace hardware_imu
@@ -0,0 +1,203 @@
+// Copyright 2016 AUV-IITK
+#include <hardware_imu/ellipsoid_fit.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+namespace hardware_imu
+{
+namespace
+{
+// samples closer than this fraction of the field range to the last added one are skipped
+const float minStep = 0.02f;
+const int minSamples = 100;
+
+// eigen decomposition of a symmetric 3x3 by Jacobi rotations: a = v diag(w) v^T, v column-wise
+void symmetricEigen(double a[3][3], double v[3][3], double w[3])
+{
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 3; j++)
+      v[i][j] = i == j;
+  for (int sweep = 0; sweep < 50; sweep++)
+  {
+    double off = fabs(a[0][1]) + fabs(a[0][2]) + fabs(a[1][2]);
+    if (off < 1e-15)
+      break;
+    for (int p = 0; p < 2; p++)
+      for (int q = p + 1; q < 3; q++)
+      {
+        if (fabs(a[p][q]) < 1e-300)
+          continue;
+        double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+        double t = (theta >= 0 ? 1 : -1) / (fabs(theta) + sqrt(theta * theta + 1));
+        double c = 1 / sqrt(t * t + 1), s = t * c;
+        for (int k = 0; k < 3; k++)
+        {
+          double akp = a[k][p], akq = a[k][q];
+          a[k][p] = c * akp - s * akq;
+          a[k][q] = s * akp + c * akq;
+        }
+        for (int k = 0; k < 3; k++)
+        {
+          double apk = a[p][k], aqk = a[q][k];
+          a[p][k] = c * apk - s * aqk;
+          a[q][k] = s * apk + c * aqk;
+        }
+        for (int k = 0; k < 3; k++)
+        {
+          double vkp = v[k][p], vkq = v[k][q];
+          v[k][p] = c * vkp - s * vkq;
+          v[k][q] = s * vkp + c * vkq;
+        }
+      }
+  }
+  for (int i = 0; i < 3; i++)
+    w[i] = a[i][i];
+}
+}  // namespace
+
+EllipsoidFit::EllipsoidFit()
+{
+  clear();
+}
+
+void EllipsoidFit::clear()
+{
+  memset(normal_, 0, sizeof(normal_));
+  memset(rhs_, 0, sizeof(rhs_));
+  samples_ = 0;
+  residual_ = 0;
+  error_.clear();
+}
+
+void EllipsoidFit::add(const Vec3 &raw)
+{
+  if (samples_ == 0)
+  {
+    min_ = max_ = raw;
+  }
+  else
+  {
+    float range = std::max(max_[0] - min_[0], std::max(max_[1] - min_[1], max_[2] - min_[2]));
+    // until the readings spread out at all, take everything
+    if (range > 0 && norm(raw - last_) < minStep * range)
+      return;
+    for (int i = 0; i < 3; i++)
+    {
+      min_[i] = std::min(min_[i], raw[i]);
+      max_[i] = std::max(max_[i], raw[i]);
+    }
+  }
+  last_ = raw;
+
+  double x = raw[0], y = raw[1], z = raw[2];
+  double phi[params] = { x * x, y * y, z * z, 2 * x * y, 2 * x * z, 2 * y * z, 2 * x, 2 * y, 2 * z };
+  double *n = normal_;
+  for (int i = 0; i < params; i++)
+  {
+    for (int j = i; j < params; j++)
+      *n++ += phi[i] * phi[j];
+    rhs_[i] += phi[i];
+  }
+  samples_++;
+}
+
+bool EllipsoidFit::solve(Vec3 &center, Mat3 &transform)
+{
+  if (samples_ < minSamples)
+  {
+    error_ = "not enough distinct samples, keep rotating";
+    return false;
+  }
+
+  // cholesky of the normal matrix, a pivot this small relative to the diagonal means a direction was never seen
+  double n[params][params], l[params][params];
+  const double *packed = normal_;
+  for (int i = 0; i < params; i++)
+    for (int j = i; j < params; j++)
+      n[i][j] = n[j][i] = *packed++;
+  memset(l, 0, sizeof(l));
+  for (int j = 0; j < params; j++)
+  {
+    double d = n[j][j];
+    for (int k = 0; k < j; k++)
+      d -= l[j][k] * l[j][k];
+    if (d <= 1e-10 * n[j][j])
+    {
+      error_ = "samples do not cover the sphere, rotate about every axis";
+      return false;
+    }
+    l[j][j] = sqrt(d);
+    for (int i = j + 1; i < params; i++)
+    {
+      double s = n[i][j];
+      for (int k = 0; k < j; k++)
+        s -= l[i][k] * l[j][k];
+      l[i][j] = s / l[j][j];
+    }
+  }
+  double p[params];
+  for (int i = 0; i < params; i++)
+  {
+    double s = rhs_[i];
+    for (int k = 0; k < i; k++)
+      s -= l[i][k] * p[k];
+    p[i] = s / l[i][i];
+  }
+  for (int i = params - 1; i >= 0; i--)
+  {
+    double s = p[i];
+    for (int k = i + 1; k < params; k++)
+      s -= l[k][i] * p[k];
+    p[i] = s / l[i][i];
+  }
+
+  // x^T M x + 2 v^T x = 1  ->  (x - c)^T M (x - c) = 1 + c^T M c with c = -M^-1 v
+  double m[3][3] = { { p[0], p[3], p[4] }, { p[3], p[1], p[5] }, { p[4], p[5], p[2] } };
+  double v[3] = { p[6], p[7], p[8] };
+  double vec[3][3], w[3], a[3][3];
+  memcpy(a, m, sizeof(a));
+  symmetricEigen(a, vec, w);
+  if (w[0] <= 0 || w[1] <= 0 || w[2] <= 0)
+  {
+    error_ = "fit is not an ellipsoid, rotate about every axis";
+    return false;
+  }
+  double c[3] = { 0, 0, 0 };
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 3; j++)
+      for (int k = 0; k < 3; k++)
+        c[i] -= vec[i][k] / w[k] * vec[j][k] * v[j];
+  double scale = 1;
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 3; j++)
+      scale += c[i] * m[i][j] * c[j];
+
+  // transform = radius * (M / scale)^(1/2), radius the geometric mean of the semi axes
+  double radius = pow(scale * scale * scale / (w[0] * w[1] * w[2]), 1.0 / 6);
+  for (int i = 0; i < 3; i++)
+  {
+    center[i] = c[i];
+    for (int j = 0; j < 3; j++)
+    {
+      double t = 0;
+      for (int k = 0; k < 3; k++)
+        t += vec[i][k] * sqrt(w[k] / scale) * vec[j][k];
+      transform(i, j) = radius * t;
+    }
+  }
+
+  // sum((phi p - 1)^2) from the normal equations, then relative to the ellipsoid's own scale
+  double sum = samples_;
+  for (int i = 0; i < params; i++)
+  {
+    sum -= 2 * p[i] * rhs_[i];
+    for (int j = 0; j < params; j++)
+      sum += p[i] * n[i][j] * p[j];
+  }
+  // phi p - 1 = |u|^2 scale - scale with u on the unit sphere, and |u|^2 - 1 is about twice |u| - 1
+  residual_ = sqrt(std::max(sum, 0.0) / samples_) / (2 * scale);
+  error_.clear();
+  return true;
+}
+}  // namespace hardware_imu
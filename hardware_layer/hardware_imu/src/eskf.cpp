@@ -0,0 +1,150 @@
+// Copyright 2016 AUV-IITK
+#include <hardware_imu/eskf.h>
+#include <math.h>
+
+namespace hardware_imu
+{
+namespace
+{
+const float gravity = 9.81f;
+
+float wrapAngle(float angle)
+{
+  while (angle > M_PI)
+    angle -= 2 * M_PI;
+  while (angle < -M_PI)
+    angle += 2 * M_PI;
+  return angle;
+}
+}  // namespace
+
+Eskf::Eskf(const Noise &noise) : noise_(noise), dt_(0.01f)
+{
+  reset(Vec3(0, 0, gravity), Vec3(1, 0, 0));
+}
+
+void Eskf::reset(const Vec3 &accel, const Vec3 &magnetom)
+{
+  // same initial attitude as the DCM
+  const Vec3 xAxis(1, 0, 0);
+  float pitch = -atan2f(accel[0], sqrtf(accel[1] * accel[1] + accel[2] * accel[2]));
+  Vec3 compensated = cross(xAxis, cross(accel, xAxis));
+  float roll = atan2f(compensated[1], compensated[2]);
+  float cosRoll = cosf(roll), sinRoll = sinf(roll);
+  float cosPitch = cosf(pitch), sinPitch = sinf(pitch);
+  float magX = magnetom[0] * cosPitch + magnetom[1] * sinRoll * sinPitch + magnetom[2] * cosRoll * sinPitch;
+  float magY = magnetom[1] * cosRoll - magnetom[2] * sinRoll;
+  q_ = fromMat3(fromEuler(atan2f(-magY, magX), pitch, roll));
+
+  bias_ = Vec3();
+  rate_ = Vec3();
+  float tilt = noise_.accel / gravity;
+  ptt_ = Mat3::diagonal(tilt * tilt, tilt * tilt, noise_.heading * noise_.heading);
+  ptb_ = Mat3();
+  pbb_ = Mat3::identity() * (noise_.initialBias * noise_.initialBias);
+}
+
+void Eskf::update(const Vec3 &gyro, const Vec3 &accel, const Vec3 &magnetom, float dt)
+{
+  predict(gyro, dt);
+  accelUpdate(accel);
+  headingUpdate(magnetom);
+}
+
+void Eskf::predict(const Vec3 &gyro, float dt)
+{
+  dt_ = dt;
+  rate_ = gyro - bias_;
+  q_ = normalized(q_ * fromRotationVector(rate_ * dt));
+
+  // F = [[A, -I dt], [0, I]] with A = I - skew(rate dt), the transposed rotation over the step
+  Mat3 a = Mat3::identity() - skew(rate_ * dt);
+  Mat3 aT = transpose(a);
+  Mat3 aPtb = a * ptb_;
+  ptt_ = a * ptt_ * aT - (aPtb + transpose(aPtb)) * dt + pbb_ * (dt * dt) +
+         Mat3::identity() * (noise_.gyro * noise_.gyro * dt);
+  ptb_ = aPtb - pbb_ * dt;
+  pbb_ = pbb_ + Mat3::identity() * (noise_.gyroBias * noise_.gyroBias * dt);
+}
+
+void Eskf::accelUpdate(const Vec3 &accel)
+{
+  float magnitude = norm(accel);
+  if (magnitude < 0.5f * gravity || magnitude > 1.5f * gravity)
+    return;
+  float sigma = noise_.accel + 2 * fabsf(magnitude - gravity);
+  float variance = sigma * sigma;
+
+  for (int i = 0; i < 3; i++)
+  {
+    // predicted specific force on a still body, R^T g; a small body rotation d changes it by skew(h) d
+    Mat3 r = toMat3(q_);
+    Vec3 h = r.row[2] * gravity;
+    scalarUpdate(skew(h).row[i], accel[i] - h[i], variance);
+  }
+}
+
+void Eskf::headingUpdate(const Vec3 &magnetom)
+{
+  if (norm(magnetom) < 1e-6f)
+    return;
+  Mat3 r = toMat3(q_);
+  float pitch = -asinf(r(2, 0));
+  float roll = atan2f(r(2, 1), r(2, 2));
+  float cosRoll = cosf(roll), sinRoll = sinf(roll);
+  float cosPitch = cosf(pitch), sinPitch = sinf(pitch);
+  float magX = magnetom[0] * cosPitch + magnetom[1] * sinRoll * sinPitch + magnetom[2] * cosRoll * sinPitch;
+  float magY = magnetom[1] * cosRoll - magnetom[2] * sinRoll;
+  float heading = atan2f(-magY, magX);
+
+  // a body rotation d turns the heading by the world z component of R d
+  scalarUpdate(r.row[2], wrapAngle(heading - atan2f(r(1, 0), r(0, 0))), noise_.heading * noise_.heading);
+}
+
+void Eskf::scalarUpdate(const Vec3 &h, float innovation, float variance)
+{
+  Vec3 pht = ptt_ * h;             // theta rows of P H^T
+  Vec3 phb = transpose(ptb_) * h;  // bias rows
+  float s = dot(h, pht) + variance;
+  Vec3 kt = pht * (1 / s), kb = phb * (1 / s);
+
+  ptt_ = ptt_ - outer(kt, pht);
+  ptb_ = ptb_ - outer(kt, phb);
+  pbb_ = pbb_ - outer(kb, phb);
+
+  // fold the error into the nominal state, the reset jacobian is close enough to identity to leave out
+  q_ = normalized(q_ * fromRotationVector(kt * innovation));
+  bias_ += kb * innovation;
+}
+
+float Eskf::yaw() const
+{
+  Mat3 r = toMat3(q_);
+  return atan2f(r(1, 0), r(0, 0));
+}
+
+float Eskf::pitch() const
+{
+  return -asinf(toMat3(q_)(2, 0));
+}
+
+float Eskf::roll() const
+{
+  Mat3 r = toMat3(q_);
+  return atan2f(r(2, 1), r(2, 2));
+}
+
+bool Eskf::orientationCovariance(Mat3 &cov) const
+{
+  Mat3 r = toMat3(q_);
+  cov = r * ptt_ * transpose(r);
+  return true;
+}
+
+bool Eskf::rateCovariance(Mat3 &cov) const
+{
+  // white gyro noise over one sample on top of what is left of the bias uncertainty
+  cov = pbb_ + Mat3::identity() * (noise_.gyro * noise_.gyro / dt_);
+  return true;
+}
+}  // namespace hardware_imu
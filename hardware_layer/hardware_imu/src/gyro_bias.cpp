@@ -0,0 +1,82 @@
+// Copyright 2016 AUV-IITK
+#include <hardware_imu/gyro_bias.h>
+#include <math.h>
+#include <string.h>
+
+namespace hardware_imu
+{
+GyroBiasEstimator::GyroBiasEstimator(const Config &config)
+  : config_(config)
+  , stationary_(false)
+  , next_(0)
+  , count_(0)
+  , accelSum_(0)
+  , accelSquares_(0)
+{
+  if (config_.window < 2)
+    config_.window = 2;
+  if (config_.window > maxWindow)
+    config_.window = maxWindow;
+  float v = config_.initialSigma * config_.initialSigma;
+  variance_ = Vec3(v, v, v);
+  memset(gyroSum_, 0, sizeof(gyroSum_));
+  memset(gyroSquares_, 0, sizeof(gyroSquares_));
+}
+
+void GyroBiasEstimator::update(const Vec3 &gyro, const Vec3 &accel, float dt, bool allowed)
+{
+  float accelNorm = norm(accel);
+  if (count_ == config_.window)
+  {
+    const Vec3 &old = gyros_[next_];
+    for (int i = 0; i < 3; i++)
+    {
+      gyroSum_[i] -= old[i];
+      gyroSquares_[i] -= old[i] * old[i];
+    }
+    accelSum_ -= accelNorms_[next_];
+    accelSquares_ -= accelNorms_[next_] * accelNorms_[next_];
+  }
+  else
+  {
+    count_++;
+  }
+  gyros_[next_] = gyro;
+  accelNorms_[next_] = accelNorm;
+  next_ = (next_ + 1) % config_.window;
+  for (int i = 0; i < 3; i++)
+  {
+    gyroSum_[i] += gyro[i];
+    gyroSquares_[i] += gyro[i] * gyro[i];
+  }
+  accelSum_ += accelNorm;
+  accelSquares_ += accelNorm * accelNorm;
+
+  float drift = config_.drift * config_.drift * dt;
+  variance_ += Vec3(drift, drift, drift);
+
+  stationary_ = allowed && count_ == config_.window;
+  double n = count_;
+  double accelMean = accelSum_ / n;
+  if (accelSquares_ / n - accelMean * accelMean > config_.accelThreshold * config_.accelThreshold)
+    stationary_ = false;
+  for (int i = 0; i < 3 && stationary_; i++)
+  {
+    double mean = gyroSum_[i] / n;
+    double spread = sqrt(variance_[i]) * 3 + config_.meanThreshold;
+    if (gyroSquares_[i] / n - mean * mean > config_.gyroThreshold * config_.gyroThreshold ||
+        fabs(mean - bias_[i]) > spread)
+      stationary_ = false;
+  }
+  if (!stationary_)
+    return;
+
+  float noise = config_.noise * config_.noise;
+  for (int i = 0; i < 3; i++)
+  {
+    float gain = variance_[i] / (variance_[i] + noise);
+    bias_[i] += gain * (gyro[i] - bias_[i]);
+    variance_[i] *= 1 - gain;
+  }
+}
+}  // namespace hardware_imu
@@ -0,0 +1,116 @@
+// Copyright 2016 AUV-IITK
+#include <hardware_imu/imu_log.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string>
+
+namespace hardware_imu
+{
+namespace
+{
+const char logMagic[8] = { 'I', 'M', 'U', 'L', 'O', 'G', 0, 0 };
+const uint32_t logVersion = 1;
+}  // namespace
+
+ImuLogWriter::ImuLogWriter() : file_(NULL)
+{
+}
+
+ImuLogWriter::~ImuLogWriter()
+{
+  close();
+}
+
+bool ImuLogWriter::open(const std::string &path)
+{
+  close();
+  file_ = fopen(path.c_str(), "wb");
+  if (!file_)
+    return false;
+  ImuLogHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, logMagic, sizeof(logMagic));
+  header.version = logVersion;
+  header.recordSize = sizeof(ImuSample);
+  if (fwrite(&header, sizeof(header), 1, file_) != 1)
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void ImuLogWriter::close()
+{
+  if (file_)
+    fclose(file_);
+  file_ = NULL;
+}
+
+bool ImuLogWriter::write(const ImuSample &sample)
+{
+  return file_ && fwrite(&sample, sizeof(sample), 1, file_) == 1;
+}
+
+ImuLogReader::ImuLogReader() : map_(MAP_FAILED), mapLength_(0), records_(NULL), count_(0)
+{
+}
+
+ImuLogReader::~ImuLogReader()
+{
+  close();
+}
+
+bool ImuLogReader::open(const std::string &path)
+{
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    error_ = "cannot open " + path;
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(ImuLogHeader))
+  {
+    ::close(fd);
+    error_ = path + " is too short for an imu log";
+    return false;
+  }
+  mapLength_ = info.st_size;
+  map_ = mmap(NULL, mapLength_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map_ == MAP_FAILED)
+  {
+    error_ = "cannot map " + path;
+    return false;
+  }
+
+  const ImuLogHeader *header = static_cast<const ImuLogHeader *>(map_);
+  if (memcmp(header->magic, logMagic, sizeof(logMagic)) != 0 || header->version != logVersion ||
+      header->recordSize != sizeof(ImuSample))
+  {
+    close();
+    error_ = path + " is not an imu log of this version";
+    return false;
+  }
+  // the header is 32 bytes, so the records keep the 8 byte alignment of the mapping
+  records_ = reinterpret_cast<const ImuSample *>(static_cast<const char *>(map_) + sizeof(ImuLogHeader));
+  count_ = (mapLength_ - sizeof(ImuLogHeader)) / sizeof(ImuSample);
+  madvise(map_, mapLength_, MADV_SEQUENTIAL);
+  return true;
+}
+
+void ImuLogReader::close()
+{
+  if (map_ != MAP_FAILED)
+    munmap(map_, mapLength_);
+  map_ = MAP_FAILED;
+  mapLength_ = 0;
+  records_ = NULL;
+  count_ = 0;
+}
+}  // namespace hardware_imu
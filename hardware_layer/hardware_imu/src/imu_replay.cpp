@@ -0,0 +1,315 @@
+// Copyright 2016 AUV-IITK
+// Feeds a log recorded by the dcm node (dcm/record_file) through the orientation filters as fast as they go, and
+// reports their throughput and yaw error against a reference heading, or against the first filter if there is none.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <hardware_imu/dcm_filter.h>
+#include <hardware_imu/eskf.h>
+#include <hardware_imu/gyro_bias.h>
+#include <hardware_imu/imu_log.h>
+#include "caliberation"
+
+#define TO_RAD(x) (x * 0.01745329252)  // *pi/180
+#define TO_DEG(x) (x * 57.2957795131)  // *180/pi
+
+using hardware_imu::ImuSample;
+using hardware_imu::Vec3;
+
+typedef std::chrono::steady_clock Clock;
+
+hardware_imu::ImuLogReader logReader;
+
+struct Run
+{
+  std::string name;
+  hardware_imu::OrientationFilter *filter;
+  std::vector<float> yaw;  // radians, one per fused sample
+  double seconds;
+};
+
+struct ReferencePoint
+{
+  double time;  // s since the first sample of the log
+  float yaw;    // radians
+};
+
+float wrapAngle(float angle)
+{
+  while (angle > M_PI)
+    angle -= 2 * M_PI;
+  while (angle < -M_PI)
+    angle += 2 * M_PI;
+  return angle;
+}
+
+// "time,yaw" lines, seconds and degrees; anything that does not parse (a header) is skipped
+bool loadReference(const char *path, std::vector<ReferencePoint> &reference)
+{
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return false;
+  char line[256];
+  while (fgets(line, sizeof(line), file))
+  {
+    ReferencePoint point;
+    float yawDeg;
+    if (sscanf(line, "%lf,%f", &point.time, &yawDeg) == 2)
+    {
+      point.yaw = TO_RAD(yawDeg);
+      reference.push_back(point);
+    }
+  }
+  fclose(file);
+  return !reference.empty();
+}
+
+// linear between the two surrounding points, going the short way round
+float referenceAt(const std::vector<ReferencePoint> &reference, double time, size_t &hint)
+{
+  while (hint + 1 < reference.size() && reference[hint + 1].time <= time)
+    hint++;
+  if (hint + 1 >= reference.size() || time <= reference[hint].time)
+    return reference[hint].yaw;
+  const ReferencePoint &a = reference[hint], &b = reference[hint + 1];
+  float fraction = (time - a.time) / (b.time - a.time);
+  return wrapAngle(a.yaw + fraction * wrapAngle(b.yaw - a.yaw));
+}
+
+// the mag_calibration.yaml the dcm node writes
+bool loadMagCalibration(const char *path)
+{
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return false;
+  char line[512];
+  float t[9];
+  bool center = false, transform = false;
+  while (fgets(line, sizeof(line), file))
+  {
+    if (sscanf(line, " mag_center: [%f, %f, %f]", &t[0], &t[1], &t[2]) == 3)
+    {
+      magCenter = Vec3(t[0], t[1], t[2]);
+      center = true;
+    }
+    else if (sscanf(line, " mag_transform: [%f, %f, %f, %f, %f, %f, %f, %f, %f]", &t[0], &t[1], &t[2], &t[3], &t[4],
+                    &t[5], &t[6], &t[7], &t[8]) == 9)
+    {
+      for (int i = 0; i < 9; i++)
+        magTransform(i / 3, i % 3) = t[i];
+      transform = true;
+    }
+  }
+  fclose(file);
+  return center && transform;
+}
+
+void usage(const char *name)
+{
+  fprintf(stderr, "usage: %s LOG [--estimator dcm|eskf]... [--param NAME=VALUE]... [--sample-rate HZ] [--repeat N]\n"
+                  "       [--mag-calibration YAML] [--reference CSV] [--output CSV]\n"
+                  "NAME is a dcm node parameter without the dcm/ prefix, e.g. kp_yaw, eskf/heading_noise or bias/drift\n",
+          name);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    usage(argv[0]);
+    return 1;
+  }
+  std::vector<std::string> estimators;
+  hardware_imu::DcmFilter::Gains gains = hardware_imu::DcmFilter::defaultGains();
+  hardware_imu::Eskf::Noise noise = hardware_imu::Eskf::defaultNoise();
+  hardware_imu::GyroBiasEstimator::Config biasConfig = hardware_imu::GyroBiasEstimator::defaultConfig();
+  double sampleRate = 100;
+  int repeat = 1;
+  const char *referencePath = NULL, *outputPath = NULL;
+  for (int i = 2; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--estimator" && hasValue)
+      estimators.push_back(argv[++i]);
+    else if (arg == "--sample-rate" && hasValue)
+      sampleRate = atof(argv[++i]);
+    else if (arg == "--repeat" && hasValue)
+      repeat = atoi(argv[++i]);
+    else if (arg == "--reference" && hasValue)
+      referencePath = argv[++i];
+    else if (arg == "--output" && hasValue)
+      outputPath = argv[++i];
+    else if (arg == "--mag-calibration" && hasValue)
+    {
+      if (!loadMagCalibration(argv[++i]))
+      {
+        fprintf(stderr, "cannot read a magnetometer calibration from %s\n", argv[i]);
+        return 1;
+      }
+    }
+    else if (arg == "--param" && hasValue)
+    {
+      std::string param = argv[++i];
+      size_t equals = param.find('=');
+      std::string name = param.substr(0, equals);
+      float value = equals == std::string::npos ? 0 : atof(param.c_str() + equals + 1);
+      float *target = name == "kp_rollpitch" ? &gains.kpRollPitch :
+                      name == "ki_rollpitch" ? &gains.kiRollPitch :
+                      name == "kp_yaw" ? &gains.kpYaw :
+                      name == "ki_yaw" ? &gains.kiYaw :
+                      name == "eskf/gyro_noise" ? &noise.gyro :
+                      name == "eskf/gyro_bias_noise" ? &noise.gyroBias :
+                      name == "eskf/accel_noise" ? &noise.accel :
+                      name == "eskf/heading_noise" ? &noise.heading :
+                      name == "eskf/initial_bias" ? &noise.initialBias :
+                      name == "bias/gyro_threshold" ? &biasConfig.gyroThreshold :
+                      name == "bias/accel_threshold" ? &biasConfig.accelThreshold :
+                      name == "bias/mean_threshold" ? &biasConfig.meanThreshold :
+                      name == "bias/noise" ? &biasConfig.noise :
+                      name == "bias/drift" ? &biasConfig.drift :
+                      name == "bias/initial_sigma" ? &biasConfig.initialSigma : NULL;
+      if (equals == std::string::npos || !target)
+      {
+        fprintf(stderr, "unknown parameter %s\n", param.c_str());
+        return 1;
+      }
+      *target = value;
+    }
+    else
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (estimators.empty())
+  {
+    estimators.push_back("dcm");
+    estimators.push_back("eskf");
+  }
+
+  if (!logReader.open(argv[1]))
+  {
+    fprintf(stderr, "%s\n", logReader.error().c_str());
+    return 1;
+  }
+  // the first sample initialises the attitude, the rest are fused
+  const size_t fusedFrom = 1;
+  if (logReader.size() <= fusedFrom)
+  {
+    fprintf(stderr, "%s has only %zu samples\n", argv[1], logReader.size());
+    return 1;
+  }
+  const ImuSample *records = logReader.records();
+  const size_t count = logReader.size() - fusedFrom;
+
+  std::vector<Run> runs;
+  for (size_t i = 0; i < estimators.size(); i++)
+  {
+    Run run;
+    run.name = estimators[i];
+    if (run.name == "dcm")
+      run.filter = new hardware_imu::DcmFilter(gains);
+    else if (run.name == "eskf")
+      run.filter = new hardware_imu::Eskf(noise);
+    else
+    {
+      fprintf(stderr, "unknown estimator %s, use dcm or eskf\n", run.name.c_str());
+      return 1;
+    }
+    run.yaw.resize(count);
+    runs.push_back(run);
+  }
+
+  const float nominalDt = 1 / sampleRate;
+  for (size_t r = 0; r < runs.size(); r++)
+  {
+    Run &run = runs[r];
+    Clock::time_point start = Clock::now();
+    for (int k = 0; k < repeat; k++)
+    {
+      // same steps as the fusion thread of the dcm node
+      Read_Gyro(records[fusedFrom - 1]);
+      Read_Accel(records[fusedFrom - 1]);
+      Read_Magn(records[fusedFrom - 1]);
+      run.filter->reset(Vec3(accel[0], accel[1], accel[2]), Vec3(magnetom[0], magnetom[1], magnetom[2]));
+      // the log has no thruster commands, stillness is judged from the samples alone
+      hardware_imu::GyroBiasEstimator biasEstimator(biasConfig);
+      int64_t last = records[fusedFrom - 1].stamp;
+      for (size_t i = 0; i < count; i++)
+      {
+        const ImuSample &sample = records[fusedFrom + i];
+        float dt = (sample.stamp - last) * 1e-9f;
+        if (dt <= 0 || dt > 10 * nominalDt)
+          dt = nominalDt;
+        last = sample.stamp;
+        Read_Gyro(sample);
+        Read_Accel(sample);
+        Read_Magn(sample);
+        Vec3 gyroRad(TO_RAD(GYRO_GAIN) * gyro[0], TO_RAD(GYRO_GAIN) * gyro[1], TO_RAD(GYRO_GAIN) * gyro[2]);
+        Vec3 accelVector(accel[0], accel[1], accel[2]);
+        biasEstimator.update(gyroRad, accelVector, dt, true);
+        run.filter->update(gyroRad - biasEstimator.bias(), accelVector, Vec3(magnetom[0], magnetom[1], magnetom[2]), dt);
+        run.yaw[i] = run.filter->yaw();
+      }
+    }
+    run.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  std::vector<ReferencePoint> reference;
+  if (referencePath && !loadReference(referencePath, reference))
+  {
+    fprintf(stderr, "cannot read a reference from %s\n", referencePath);
+    return 1;
+  }
+
+  double logSeconds = (records[logReader.size() - 1].stamp - records[0].stamp) * 1e-9;
+  printf("%s: %zu samples over %.1f s, %zu fused\n", argv[1], logReader.size(), logSeconds, count);
+  printf("yaw error against %s\n", reference.empty() ? runs[0].name.c_str() : referencePath);
+  for (size_t r = 0; r < runs.size(); r++)
+  {
+    const Run &run = runs[r];
+    double sumSquares = 0, worst = 0;
+    size_t hint = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+      double time = (records[fusedFrom + i].stamp - records[0].stamp) * 1e-9;
+      float truth = reference.empty() ? runs[0].yaw[i] : referenceAt(reference, time, hint);
+      double error = fabs(wrapAngle(run.yaw[i] - truth));
+      sumSquares += error * error;
+      worst = std::max(worst, error);
+    }
+    double perSample = run.seconds / (static_cast<double>(count) * repeat);
+    printf("  %-5s %10.0f samples/s  %7.0f ns/sample  yaw rms %6.2f deg  max %6.2f deg  final %7.2f deg\n",
+           run.name.c_str(), 1 / perSample, perSample * 1e9, TO_DEG(sqrt(sumSquares / count)), TO_DEG(worst),
+           TO_DEG(run.yaw[count - 1]));
+  }
+
+  if (outputPath)
+  {
+    FILE *file = fopen(outputPath, "w");
+    if (!file)
+    {
+      fprintf(stderr, "cannot write %s\n", outputPath);
+      return 1;
+    }
+    fprintf(file, "time");
+    for (size_t r = 0; r < runs.size(); r++)
+      fprintf(file, ",%s", runs[r].name.c_str());
+    fprintf(file, "\n");
+    for (size_t i = 0; i < count; i++)
+    {
+      fprintf(file, "%.4f", (records[fusedFrom + i].stamp - records[0].stamp) * 1e-9);
+      for (size_t r = 0; r < runs.size(); r++)
+        fprintf(file, ",%.3f", TO_DEG(runs[r].yaw[i]));
+      fprintf(file, "\n");
+    }
+    fclose(file);
+  }
+  return 0;
+}
@@ -0,0 +1,209 @@
+// Copyright 2016 AUV-IITK
+#include <hardware_imu/navstik_reader.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+
+namespace hardware_imu
+{
+namespace
+{
+typedef std::chrono::steady_clock Clock;
+
+// offsets from the start of "NAVSTIK1" as the device prints them
+const int firstField = 10;
+const int fieldPitch = 9;
+const int fieldWidth = 7;
+
+int64_t nowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+}  // namespace
+
+NavStikReader::NavStikReader(const std::string &path)
+  : path_(path)
+  , fd_(-1)
+  , stat_(not_connected)
+  , chunkPos_(0)
+  , chunkEnd_(0)
+  , chunkStamp_(0)
+  , chunkLines_(0)
+  , chunkLine_(0)
+  , lineStep_(0)
+  , lastStamp_(0)
+  , samplePeriod_(10000000)
+  , lineLength_(0)
+  , lineOverflow_(false)
+  , seq_(0)
+  , badLines_(0)
+{
+}
+
+NavStikReader::~NavStikReader()
+{
+  close();
+}
+
+bool NavStikReader::open()
+{
+  close();
+  fd_ = ::open(path_.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd_ < 0)
+    return false;
+
+  if (isatty(fd_))
+  {
+    termios tty;
+    if (tcgetattr(fd_, &tty) == 0)
+    {
+      cfmakeraw(&tty);
+      tcsetattr(fd_, TCSANOW, &tty);
+    }
+    // whatever queued up while nobody was reading is too old to fuse
+    tcflush(fd_, TCIFLUSH);
+  }
+  // same as echo 'usb' > /dev/navstik, switches the output to the usb port
+  const char usb[] = "usb\n";
+  if (write(fd_, usb, sizeof(usb) - 1) < 0)
+  {
+    // some device nodes are read only, the output is then already on usb
+  }
+
+  chunkPos_ = chunkEnd_ = 0;
+  lineLength_ = 0;
+  // the first line is most likely cut, skip it
+  lineOverflow_ = true;
+  seq_ = 0;
+  lastStamp_ = 0;
+  stat_ = fine;
+  return true;
+}
+
+void NavStikReader::close()
+{
+  if (fd_ >= 0)
+    ::close(fd_);
+  fd_ = -1;
+  stat_ = not_connected;
+}
+
+void NavStikReader::setSampleRate(double rate)
+{
+  if (rate > 0)
+    samplePeriod_ = static_cast<int64_t>(1e9 / rate);
+}
+
+bool NavStikReader::read(ImuSample &sample, int timeoutMs)
+{
+  if (fd_ < 0)
+    return false;
+  const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+
+  while (true)
+  {
+    while (chunkPos_ < chunkEnd_)
+    {
+      char c = chunk_[chunkPos_++];
+      if (c == '\n' || c == '\r')
+      {
+        if (lineOverflow_ || lineLength_ > 0)
+          chunkLine_++;
+        bool complete = !lineOverflow_ && lineLength_ > 0;
+        lineOverflow_ = false;
+        if (complete && parseLine(sample))
+        {
+          lineLength_ = 0;
+          return true;
+        }
+        lineLength_ = 0;
+      }
+      else if (lineLength_ < maxLine)
+        line_[lineLength_++] = c;
+      else
+        lineOverflow_ = true;
+    }
+
+    int remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+    if (remaining < 0)
+      return false;
+    pollfd pfd = { fd_, POLLIN, 0 };
+    int ready = poll(&pfd, 1, remaining);
+    if (ready < 0 && errno != EINTR)
+    {
+      close();
+      return false;
+    }
+    if (ready <= 0)
+      continue;
+
+    ssize_t n = ::read(fd_, chunk_, chunkSize);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+      continue;
+    if (n <= 0)
+    {
+      // unplugged
+      close();
+      return false;
+    }
+    chunkPos_ = 0;
+    chunkEnd_ = n;
+    // the newest line in a chunk is at most one transmission old, the older ones are stamped back from it
+    chunkStamp_ = nowNs();
+    chunkLines_ = 0;
+    chunkLine_ = 0;
+    bool inLine = lineOverflow_ || lineLength_ > 0;
+    for (ssize_t i = 0; i < n; i++)
+    {
+      bool end = chunk_[i] == '\n' || chunk_[i] == '\r';
+      if (end && inLine)
+        chunkLines_++;
+      inLine = !end;
+    }
+    lineStep_ = samplePeriod_;
+    if (chunkLines_ > 1 && lastStamp_ > 0 && (chunkStamp_ - lastStamp_) / static_cast<int64_t>(chunkLines_) < lineStep_)
+      lineStep_ = (chunkStamp_ - lastStamp_) / static_cast<int64_t>(chunkLines_);
+  }
+}
+
+bool NavStikReader::parseLine(ImuSample &sample)
+{
+  line_[lineLength_] = '\0';
+  const char *start = strstr(line_, "NAVSTIK1");
+  if (!start)
+    return false;
+
+  size_t offset = start - line_;
+  float *axes[9] = { &sample.accel[0], &sample.accel[1], &sample.accel[2], &sample.gyro[0], &sample.gyro[1],
+                     &sample.gyro[2],  &sample.mag[0],   &sample.mag[1],   &sample.mag[2] };
+  for (int i = 0; i < 9; i++)
+  {
+    size_t begin = offset + firstField + fieldPitch * i;
+    if (begin + fieldWidth > lineLength_)
+    {
+      badLines_++;
+      return false;
+    }
+    char field[fieldWidth + 1];
+    memcpy(field, line_ + begin, fieldWidth);
+    field[fieldWidth] = '\0';
+    char *end;
+    *axes[i] = strtof(field, &end);
+    if (end == field)
+    {
+      badLines_++;
+      return false;
+    }
+  }
+  sample.stamp = chunkStamp_ - static_cast<int64_t>(chunkLines_ - chunkLine_) * lineStep_;
+  lastStamp_ = sample.stamp;
+  sample.seq = seq_++;
+  return true;
+}
+}  // namespace hardware_imu
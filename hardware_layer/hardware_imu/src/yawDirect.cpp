@@ -2,6 +2,8 @@
 #include "ros/ros.h"
 #include "std_msgs/Float64.h"
 #include "sensor_msgs/Imu.h"
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/sensor_board.h>
 #include <math.h>
 #include <time.h>
 #include "caliberation"
@@ -11,9 +13,14 @@
 
 void read_sensors()
 {
-  Read_Gyro();   // Read gyroscope
-  Read_Accel();  // Read accelerometer
-  Read_Magn();   // Read magnetometer
+  hardware_imu::ImuSample sample = nextSample();
+  // the navstik prints about ten samples per tick of this loop, the ones behind the newest would only pile up
+  hardware_imu::ImuSample newer;
+  while (nav.read(newer, 0))
+    sample = newer;
+  Read_Gyro(sample);   // Read gyroscope
+  Read_Accel(sample);  // Read accelerometer
+  Read_Magn(sample);   // Read magnetometer
 }
 
 int main(int argc, char **argv)
@@ -21,20 +28,23 @@ int main(int argc, char **argv)
   ros::init(argc, argv, "imu");
 
   ros::NodeHandle nh;
-  ros::Publisher chatter_pub = nh.advertise<std_msgs::Float64>("/varun/sensors/imu/yaw", 1000);
+  ros::Publisher chatter_pub =
+      hardware_commons::advertise<std_msgs::Float64>(nh, "/varun/sensors/imu/yaw", hardware_commons::LATEST);
   std_msgs::Float64 msg;
+  hardware_commons::SensorBoard sensorBoard;
+  if (!sensorBoard.open())
+    ROS_WARN("%s, the yaw only goes out on the topic", sensorBoard.error().c_str());
 
   ros::Rate loopRate(10);
 
   int temp = 0;
 
-  removegyrooff();
-
   while (ros::ok())
   {
     read_sensors();
     msg.data = TO_DEG(-atan2(magnetom[1], magnetom[0]));
     chatter_pub.publish(msg);
+    sensorBoard.write(hardware_commons::IMU, msg.data);
     ROS_INFO("%s %f", "send an imu message", TO_DEG(-atan2(magnetom[1], magnetom[0])));
     // ROS_INFO("%d \n",temp);
     ros::spinOnce();
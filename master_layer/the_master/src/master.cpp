@@ -0,0 +1,405 @@
+// Copyright 2016 AUV-IITK
+#include <ros/ros.h>
+#include <std_msgs/Bool.h>
+#include <actionlib/action_definition.h>
+#include <actionlib/client/simple_action_client.h>
+#include <actionlib/client/terminal_state.h>
+
+#include <task_commons/buoyAction.h>
+#include <task_commons/gateAction.h>
+#include <task_commons/lineAction.h>
+#include <task_commons/torpedoAction.h>
+#include <motion_commons/ForwardAction.h>
+#include <motion_commons/SidewardAction.h>
+#include <motion_commons/TurnAction.h>
+#include <motion_commons/UpwardAction.h>
+#include <hardware_commons/queue_policy.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Runs the mission plan of the ~mission parameter (see config/mission.yaml) one task after the other. While a task
+// runs, the next one is prepared on a thread of its own: its action server is connected and the detectors it starts
+// with are switched on, so the camera is subscribed and the pipeline has frames by the time its goal is sent. Every
+// task is timed and the timings are printed, and written to ~timing_file if set, once the run is over.
+
+// one entry of the plan
+struct Task
+{
+  std::string type;
+  std::string server;
+  double goal;
+  int loop;
+  std::string source;
+  double timeout;
+  std::vector<std::string> detectors;
+};
+
+// an action client of any of the task and motion servers
+class Step
+{
+public:
+  virtual ~Step()
+  {
+  }
+  virtual bool connect(double timeout) = 0;
+  virtual void send() = 0;
+  // true once the goal finished, false if it is still running after timeout seconds (0 waits for ever)
+  virtual bool wait(double timeout) = 0;
+  virtual void cancel() = 0;
+  virtual bool succeeded() = 0;
+};
+
+template <class Action>
+class ActionStep : public Step
+{
+public:
+  ACTION_DEFINITION(Action);
+  typedef bool (*Check)(const Result &);
+
+  ActionStep(const std::string &server, const Goal &goal, Check check)
+    : client_(server, false), goal_(goal), check_(check)
+  {
+  }
+
+  bool connect(double timeout)
+  {
+    return client_.waitForServer(ros::Duration(timeout));
+  }
+
+  void send()
+  {
+    client_.sendGoal(goal_);
+  }
+
+  bool wait(double timeout)
+  {
+    return client_.waitForResult(ros::Duration(timeout));
+  }
+
+  void cancel()
+  {
+    client_.cancelGoal();
+  }
+
+  bool succeeded()
+  {
+    ResultConstPtr result = client_.getResult();
+    return client_.getState() == actionlib::SimpleClientGoalState::SUCCEEDED && result && check_(*result);
+  }
+
+private:
+  actionlib::SimpleActionClient<Action> client_;
+  Goal goal_;
+  Check check_;
+};
+
+template <class Result>
+bool motionCompleted(const Result &result)
+{
+  return result.MotionCompleted;
+}
+
+template <class Result>
+bool reached(const Result &result)
+{
+  return result.Result;
+}
+
+template <class Action>
+Step *taskStep(const Task &task)
+{
+  typename ActionStep<Action>::Goal goal;
+  goal.order = true;
+  return new ActionStep<Action>(task.server, goal, &motionCompleted<typename ActionStep<Action>::Result>);
+}
+
+template <class Action>
+Step *motionStep(const Task &task)
+{
+  typename ActionStep<Action>::Goal goal;
+  goal.Goal = task.goal;
+  goal.loop = task.loop;
+  goal.Source = task.source;
+  return new ActionStep<Action>(task.server, goal, &reached<typename ActionStep<Action>::Result>);
+}
+
+Step *upwardStep(const Task &task)
+{
+  motion_commons::UpwardGoal goal;
+  goal.Goal = task.goal;
+  goal.loop = task.loop;
+  goal.Source = task.source;
+  return new ActionStep<motion_commons::UpwardAction>(task.server, goal, &reached<motion_commons::UpwardResult>);
+}
+
+Step *turnStep(const Task &task)
+{
+  motion_commons::TurnGoal goal;
+  goal.AngleToTurn = task.goal;
+  goal.loop = task.loop;
+  goal.Source = task.source;
+  return new ActionStep<motion_commons::TurnAction>(task.server, goal, &reached<motion_commons::TurnResult>);
+}
+
+// NULL for a type nobody serves
+Step *makeStep(const Task &task)
+{
+  if (task.type == "line")
+    return taskStep<task_commons::lineAction>(task);
+  if (task.type == "buoy")
+    return taskStep<task_commons::buoyAction>(task);
+  if (task.type == "gate")
+    return taskStep<task_commons::gateAction>(task);
+  if (task.type == "torpedo")
+    return taskStep<task_commons::torpedoAction>(task);
+  if (task.type == "forward")
+    return motionStep<motion_commons::ForwardAction>(task);
+  if (task.type == "sideward")
+    return motionStep<motion_commons::SidewardAction>(task);
+  if (task.type == "upward")
+    return upwardStep(task);
+  if (task.type == "turn")
+    return turnStep(task);
+  return NULL;
+}
+
+// server started by the launch files and the detector its goal switches on first
+void defaults(const std::string &type, std::string *server, std::string *detector)
+{
+  if (type == "turn")
+    *server = "turningXY";
+  else if (type == "line" || type == "buoy" || type == "gate" || type == "torpedo")
+    *server = type + "_server";
+  else
+    *server = type;
+
+  if (type == "line" || type == "buoy" || type == "gate" || type == "torpedo")
+    *detector = type + "_detection_switch";
+  else
+    detector->clear();
+}
+
+double number(XmlRpc::XmlRpcValue &value)
+{
+  if (value.getType() == XmlRpc::XmlRpcValue::TypeInt)
+    return static_cast<int>(value);
+  return static_cast<double>(value);
+}
+
+bool readPlan(const ros::NodeHandle &nh, std::vector<Task> *plan)
+{
+  XmlRpc::XmlRpcValue mission;
+  if (!nh.getParam("mission", mission) || mission.getType() != XmlRpc::XmlRpcValue::TypeArray)
+  {
+    ROS_ERROR("no mission plan, ~mission must be a list of tasks");
+    return false;
+  }
+
+  for (int i = 0; i < mission.size(); i++)
+  {
+    XmlRpc::XmlRpcValue &entry = mission[i];
+    if (entry.getType() != XmlRpc::XmlRpcValue::TypeStruct || !entry.hasMember("task"))
+    {
+      ROS_ERROR("entry %d of the mission has no task", i);
+      return false;
+    }
+
+    Task task;
+    task.type = static_cast<std::string>(entry["task"]);
+    std::string detector;
+    defaults(task.type, &task.server, &detector);
+    if (!detector.empty())
+      task.detectors.push_back(detector);
+
+    task.goal = entry.hasMember("goal") ? number(entry["goal"]) : 0;
+    task.loop = entry.hasMember("loop") ? static_cast<int>(entry["loop"]) : 10;
+    if (entry.hasMember("source"))
+      task.source = static_cast<std::string>(entry["source"]);
+    task.timeout = entry.hasMember("timeout") ? number(entry["timeout"]) : 0;
+    if (entry.hasMember("server"))
+      task.server = static_cast<std::string>(entry["server"]);
+    if (entry.hasMember("detectors"))
+    {
+      task.detectors.clear();
+      for (int j = 0; j < entry["detectors"].size(); j++)
+        task.detectors.push_back(static_cast<std::string>(entry["detectors"][j]));
+    }
+    plan->push_back(task);
+  }
+  return true;
+}
+
+// what happened to one task, times in seconds from the start of the run
+struct Timing
+{
+  std::string type;
+  double ready;  // server connected and detectors on, ahead of start unless preparing took longer than the task before
+  double start;
+  double end;
+  std::string outcome;
+
+  Timing() : ready(0), start(0), end(0)
+  {
+  }
+};
+
+class Master
+{
+public:
+  explicit Master(const ros::NodeHandle &nh) : nh_(nh), connectTimeout_(10)
+  {
+    ros::NodeHandle("~").getParam("connect_timeout", connectTimeout_);
+  }
+
+  bool load()
+  {
+    if (!readPlan(ros::NodeHandle("~"), &plan_))
+      return false;
+
+    for (int i = 0; i < plan_.size(); i++)
+    {
+      boost::shared_ptr<Step> step(makeStep(plan_[i]));
+      if (!step)
+      {
+        ROS_ERROR("task %d of the mission: no server for %s", i, plan_[i].type.c_str());
+        return false;
+      }
+      steps_.push_back(step);
+
+      // advertised up front so that the switch is connected by the time it is published
+      for (int j = 0; j < plan_[i].detectors.size(); j++)
+      {
+        const std::string &topic = plan_[i].detectors[j];
+        if (!switches_.count(topic))
+          switches_[topic] = hardware_commons::advertise<std_msgs::Bool>(nh_, topic, hardware_commons::EVENTS);
+      }
+    }
+    timings_.resize(plan_.size());
+    return true;
+  }
+
+  void run()
+  {
+    begin_ = ros::Time::now();
+    prepare(0);
+    for (int i = 0; i < steps_.size() && ros::ok(); i++)
+    {
+      preparing_.join();
+      if (i + 1 < steps_.size())
+        preparing_ = boost::thread(&Master::prepare, this, i + 1);
+      execute(i);
+    }
+    preparing_.join();
+
+    // the run was cut short after the next task was prepared
+    for (int i = 0; i < steps_.size(); i++)
+      if (timings_[i].outcome == "not started")
+        switchDetectors(i, false);
+
+    report();
+  }
+
+private:
+  void prepare(int i)
+  {
+    Timing &timing = timings_[i];
+    timing.type = plan_[i].type;
+    switchDetectors(i, true);
+    if (!steps_[i]->connect(connectTimeout_))
+      ROS_WARN("%s server %s not up after %.0f s", plan_[i].type.c_str(), plan_[i].server.c_str(), connectTimeout_);
+    timing.ready = elapsed();
+    timing.outcome = "not started";
+  }
+
+  void execute(int i)
+  {
+    const Task &task = plan_[i];
+    Timing &timing = timings_[i];
+    ROS_INFO("task %d: %s", i, task.type.c_str());
+
+    timing.start = elapsed();
+    steps_[i]->send();
+    if (!steps_[i]->wait(task.timeout))
+    {
+      steps_[i]->cancel();
+      timing.outcome = ros::ok() ? "timed out" : "interrupted";
+    }
+    else
+      timing.outcome = steps_[i]->succeeded() ? "succeeded" : "failed";
+    timing.end = elapsed();
+    ROS_INFO("%s %s after %.2f s", task.type.c_str(), timing.outcome.c_str(), timing.end - timing.start);
+  }
+
+  // the detectors of a task are switched off by its server, only warmed up ones that never ran are left to the master
+  void switchDetectors(int i, bool on)
+  {
+    std_msgs::Bool msg;
+    msg.data = !on;
+    for (int j = 0; j < plan_[i].detectors.size(); j++)
+      switches_[plan_[i].detectors[j]].publish(msg);
+  }
+
+  double elapsed() const
+  {
+    return (ros::Time::now() - begin_).toSec();
+  }
+
+  void report()
+  {
+    ROS_INFO("%-3s %-10s %9s %9s %9s %9s  %s", "#", "task", "ready", "start", "duration", "idle", "outcome");
+    double previous = 0;
+    for (int i = 0; i < timings_.size(); i++)
+    {
+      const Timing &t = timings_[i];
+      if (t.outcome.empty() || t.outcome == "not started")
+        break;
+      // idle is the time between the end of the task before and this one starting, what the handover costs
+      ROS_INFO("%-3d %-10s %9.2f %9.2f %9.2f %9.2f  %s", i, t.type.c_str(), t.ready, t.start, t.end - t.start,
+               t.start - previous, t.outcome.c_str());
+      previous = t.end;
+    }
+
+    std::string file;
+    if (!ros::NodeHandle("~").getParam("timing_file", file) || file.empty())
+      return;
+    std::ofstream out(file.c_str());
+    out << "task,type,ready,start,end,outcome\n";
+    for (int i = 0; i < timings_.size(); i++)
+      if (!timings_[i].outcome.empty() && timings_[i].outcome != "not started")
+        out << i << ',' << timings_[i].type << ',' << timings_[i].ready << ',' << timings_[i].start << ','
+            << timings_[i].end << ',' << timings_[i].outcome << '\n';
+    if (!out)
+      ROS_ERROR("could not write the timings to %s", file.c_str());
+  }
+
+  ros::NodeHandle nh_;
+  double connectTimeout_;
+  std::vector<Task> plan_;
+  std::vector<boost::shared_ptr<Step> > steps_;
+  std::map<std::string, ros::Publisher> switches_;
+  std::vector<Timing> timings_;
+  ros::Time begin_;
+  boost::thread preparing_;
+};
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "master");
+  ros::NodeHandle nh;
+
+  // delivers the results and status of all action clients, which have no spin threads of their own; the run itself
+  // is on this thread
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
+  Master master(nh);
+  if (!master.load())
+    return 1;
+  master.run();
+  return 0;
+}
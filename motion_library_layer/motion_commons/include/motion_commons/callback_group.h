@@ -0,0 +1,61 @@
+// Copyright 2016 AUV-IITK
+#ifndef MOTION_COMMONS_CALLBACK_GROUP_H
+#define MOTION_COMMONS_CALLBACK_GROUP_H
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <string>
+
+/*! \file
+* \brief A callback queue of its own with the threads that serve it
+*
+* The motion and task nodes split their callbacks by subsystem (sensor input, motion results, goals and preempts of
+* the action server, dynamic reconfigure) instead of running all of them one after another off the global queue.
+* Subscribers, servers and clients created through nodeHandle() are called on the threads of their group only, so a
+* slow callback holds up its own subsystem and nothing else.
+*
+* The number of threads comes from the private parameter <name>_threads. One thread keeps the callbacks of a group
+* in order and never concurrent with each other, which is what the callbacks in this repo expect; raise it only for
+* groups whose callbacks are safe to run side by side.
+*/
+namespace motion_commons
+{
+class CallbackGroup
+{
+public:
+  // ns is the namespace of nodeHandle(), dynamic_reconfigure wants the private one
+  explicit CallbackGroup(const std::string &name, const std::string &ns = "")
+    : nh_(ns), spinner_(threads(name), &queue_)
+  {
+    nh_.setCallbackQueue(&queue_);
+  }
+
+  ros::NodeHandle &nodeHandle()
+  {
+    return nh_;
+  }
+
+  // after everything that uses the group was created, callbacks run from here on
+  void start()
+  {
+    spinner_.start();
+  }
+
+private:
+  static int threads(const std::string &name)
+  {
+    int threads = 1;
+    ros::NodeHandle("~").getParam(name + "_threads", threads);
+    return threads > 0 ? threads : 1;
+  }
+
+  ros::CallbackQueue queue_;
+  ros::NodeHandle nh_;
+  ros::AsyncSpinner spinner_;
+
+  CallbackGroup(const CallbackGroup &);
+  CallbackGroup &operator=(const CallbackGroup &);
+};
+}  // namespace motion_commons
+
+#endif  // MOTION_COMMONS_CALLBACK_GROUP_H
@@ -0,0 +1,148 @@
+// Copyright 2016 AUV-IITK
+#ifndef MOTION_COMMONS_INPUT_SOURCE_H
+#define MOTION_COMMONS_INPUT_SOURCE_H
+
+#include <ros/ros.h>
+#include <hardware_commons/sensor_board.h>
+#include <hardware_commons/trace.h>
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+
+/*! \file
+* \brief The measurement a motion server tracks, chosen by the goal
+*
+* Goals name their input in their Source field as "<channel>[<index>]", a value of a sensor board channel
+* (hardware_commons/sensor_board.h): "line_centralize[0]" is the sideways offset of the line, "buoy[3]" the distance
+* to the buoy, "depth[0]" the pressure sensor, "imu[0]" the yaw. The server reads it off the board once per control
+* step, where the detector or sensor node wrote it, so a task server only says what to track and no longer relays
+* every sample to a /varun/motion topic.
+*
+* "<channel>[<index>]?<guard>" only takes readings whose value at index guard is positive, for detectors that report
+* a lost target in the same array ("buoy[1]?3" is the x offset while the buoy is in sight). Readings that are not
+* taken leave the server on the last value it had, as it did when the task server stopped relaying.
+*
+* An empty Source keeps the server on its /varun/motion topic, for inputs that are not on the board (the *Test nodes,
+* dead reckoning by a task server). A goal that switches back to it starts from the newest value published there, or
+* from the last reading of the board if nothing was, instead of waiting for a message nobody may send; dead reckoning
+* goals of forward put their start in the goal.
+*/
+namespace motion_commons
+{
+// not synchronized, a server whose topic callback runs on another thread calls it under the lock of its position
+class InputSource
+{
+public:
+  explicit InputSource(const hardware_commons::SensorBoard *board)
+    : board_(board), onBoard_(false), channel_(hardware_commons::CHANNEL_COUNT), index_(0), guard_(-1), seq_(0)
+    , trace_(0), count_(0)
+  {
+  }
+
+  // false, leaving the previous source in place, if source is neither empty nor a channel value
+  bool select(const std::string &source)
+  {
+    seq_ = 0;
+    trace_ = 0;
+    count_ = 0;
+    if (source.empty())
+    {
+      onBoard_ = false;
+      source_.clear();
+      return true;
+    }
+
+    char name[32];
+    int index = 0, guard = -1, used = 0;
+    if (sscanf(source.c_str(), "%31[a-z_][%d]%n", name, &index, &used) != 2 || used == 0)
+      return false;
+    const char *rest = source.c_str() + used;
+    if (*rest == '?')
+    {
+      int more = 0;
+      if (sscanf(rest, "?%d%n", &guard, &more) != 1 || rest[more] != '\0')
+        return false;
+    }
+    else if (*rest != '\0')
+      return false;
+
+    hardware_commons::Channel channel;
+    if (!hardware_commons::channelFromName(name, channel) || index < 0 ||
+        index >= hardware_commons::Reading::maxValues || guard >= hardware_commons::Reading::maxValues)
+      return false;
+    onBoard_ = true;
+    channel_ = channel;
+    index_ = index;
+    guard_ = guard;
+    source_ = source;
+    return true;
+  }
+
+  // the goal reads the board, the topic callback has to leave the measurement alone
+  bool onBoard() const
+  {
+    return onBoard_;
+  }
+
+  const std::string &name() const
+  {
+    return source_;
+  }
+
+  // true with the value if the channel was written since the last call and the reading passes the guard
+  bool read(double *value)
+  {
+    hardware_commons::Reading reading;
+    if (!onBoard_ || !board_->read(channel_, reading))
+      return false;
+    if (reading.age() > 1)
+      ROS_WARN_THROTTLE(1, "%s on the sensor board is %.1f s old", source_.c_str(), reading.age());
+    if (reading.seq == seq_)
+      return false;
+    seq_ = reading.seq;
+    if (index_ >= static_cast<int>(reading.count))
+      return false;
+    if (guard_ >= 0 && (guard_ >= static_cast<int>(reading.count) || reading.values[guard_] <= 0))
+      return false;
+    trace_ = reading.trace;
+    *value = reading.values[index_];
+    count_ = reading.count;
+    std::copy(reading.values, reading.values + reading.count, values_);
+    return true;
+  }
+
+  hardware_commons::Channel channel() const
+  {
+    return channel_;
+  }
+
+  // another value of the reading read() took last, false if it did not have one
+  bool value(int index, double *value) const
+  {
+    if (!onBoard_ || index < 0 || index >= count_)
+      return false;
+    *value = values_[index];
+    return true;
+  }
+
+  // frame of the last value read, 0 for topic input
+  hardware_commons::trace::Id trace() const
+  {
+    return trace_;
+  }
+
+private:
+  const hardware_commons::SensorBoard *board_;
+  bool onBoard_;
+  hardware_commons::Channel channel_;
+  int index_;
+  int guard_;
+  std::string source_;
+  uint32_t seq_;
+  hardware_commons::trace::Id trace_;
+  int count_;
+  double values_[hardware_commons::Reading::maxValues];
+};
+}  // namespace motion_commons
+
+#endif  // MOTION_COMMONS_INPUT_SOURCE_H
@@ -0,0 +1,77 @@
+// Copyright 2016 AUV-IITK
+#ifndef MOTION_COMMONS_PWM_OUTPUT_H
+#define MOTION_COMMONS_PWM_OUTPUT_H
+
+#include <ros/ros.h>
+#include <std_msgs/Int32.h>
+#include <std_msgs/String.h>
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/trace.h>
+#include <boost/thread/mutex.hpp>
+#include <string>
+
+/*! \file
+* \brief The pwm a motion server sends for its axis, with a stop that does not wait for the control loop
+*
+* stop() is called from the preempt callback the moment the goal is cancelled. It puts the axis name on /pwm/stop,
+* which thruster_mixer serves on a thread of its own and passes on to the thrusters at once instead of at its next
+* tick, and a 0 on the axis topic for everyone else listening there. From then on publish() drops what the control
+* loop sends until start() is called for the next goal, so a control step that was already under way when the
+* preempt came in cannot turn the thruster back on. The loop still leaves at its next isPreemptRequested().
+*
+* Every stop is a trace of its own named "preempt" (hardware_commons/trace.h); merge_traces.py reports the time from
+* it to the command the arduino applied.
+*/
+namespace motion_commons
+{
+class PwmOutput
+{
+public:
+  // axis is the suffix of the /pwm topic and what the mixer is told to stop: forward, sideward, upward or turn
+  PwmOutput(ros::NodeHandle *nh, const std::string &axis) : axis_(axis), stopped_(false)
+  {
+    pwm_ = hardware_commons::advertise<std_msgs::Int32>(*nh, "/pwm/" + axis, hardware_commons::LATEST);
+    stop_ = hardware_commons::advertise<std_msgs::String>(*nh, "/pwm/stop", hardware_commons::EVENTS);
+  }
+
+  // a new goal drives the axis again
+  void start()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stopped_ = false;
+  }
+
+  void publish(const std_msgs::Int32 &pwm)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (!stopped_)
+      hardware_commons::trace::publish(pwm_, pwm);
+  }
+
+  void stop()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stopped_ = true;
+    // the stamp of the cancel is the id, like a camera frame's stamp is for what it causes
+    hardware_commons::trace::Span span("preempt", ros::Time::now().toNSec());
+    std_msgs::String axis;
+    axis.data = axis_;
+    hardware_commons::trace::publish(stop_, axis);
+    std_msgs::Int32 zero;
+    zero.data = 0;
+    hardware_commons::trace::publish(pwm_, zero);
+  }
+
+private:
+  std::string axis_;
+  ros::Publisher pwm_;
+  ros::Publisher stop_;
+  boost::mutex mutex_;
+  bool stopped_;
+
+  PwmOutput(const PwmOutput &);
+  PwmOutput &operator=(const PwmOutput &);
+};
+}  // namespace motion_commons
+
+#endif  // MOTION_COMMONS_PWM_OUTPUT_H
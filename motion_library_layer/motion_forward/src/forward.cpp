@@ -4,18 +4,61 @@
 #include <std_msgs/Float64.h>
 #include <std_msgs/Int32.h>
 #include <actionlib/server/simple_action_server.h>
+#include <motion_commons/callback_group.h>
+#include <motion_commons/input_source.h>
+#include <motion_commons/pwm_output.h>
 #include <motion_commons/ForwardAction.h>
 #include <dynamic_reconfigure/server.h>
 #include <motion_forward/pidConfig.h>
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/sensor_board.h>
+#include <hardware_commons/trace.h>
+#include <boost/thread/mutex.hpp>
 #include <string>
 using std::string;
 
 typedef actionlib::SimpleActionServer<motion_commons::ForwardAction> Server;  // defining the Client type
+// written by distanceCb on the sensor thread and by the control loop on the action thread, under positionMutex
+boost::mutex positionMutex;
 float presentForwardPosition = 0;
 float previousForwardPosition = 0;
 float finalForwardPosition, error, output;
 bool initData = false;
+// last value on /varun/motion/x_distance, kept while goals read the board for the next goal without Source
+float topicPosition = 0;
+bool topicData = false;
 std_msgs::Int32 pwm;  // pwm to be send to arduino
+// set per goal, goals with a Source read it off the sensor board and ignore /varun/motion/x_distance
+hardware_commons::SensorBoard sensorBoard;
+motion_commons::InputSource input(&sensorBoard);
+
+void updatePosition(float position)
+{
+  // this is used to set the final position after getting the value of first intial position
+  if (initData == false)
+  {
+    presentForwardPosition = position;
+    previousForwardPosition = presentForwardPosition;
+    initData = true;
+  }
+  else
+  {
+    previousForwardPosition = presentForwardPosition;
+    presentForwardPosition = position;
+  }
+}
+
+// the newest position, with the board read first for goals with a Source; false while there is none yet
+bool readInput(float *present, float *previous)
+{
+  boost::mutex::scoped_lock lock(positionMutex);
+  double value;
+  if (input.read(&value))
+    updatePosition(value);
+  *present = presentForwardPosition;
+  *previous = previousForwardPosition;
+  return initData;
+}
 
 // new inner class, to encapsulate the interaction with actionclient
 class innerActionClass
@@ -26,20 +69,22 @@ private:
   std::string action_name_;
   motion_commons::ForwardFeedback feedback_;
   motion_commons::ForwardResult result_;
-  ros::Publisher PWM;
+  motion_commons::PwmOutput PWM;
+  std::string previousSource_;
   float p, i, d;
+  boost::mutex gainMutex_;  // setPID is called on the reconfigure thread
 
 public:
   // Constructor, called when new instance of class declared
-  explicit innerActionClass(string name)
+  innerActionClass(std::string name, const ros::NodeHandle &nh)
     :  // Defining the server, third argument is optional
-    forwardServer_(nh_, name, boost::bind(&innerActionClass::analysisCB, this, _1), false)
+    nh_(nh)
+    , forwardServer_(nh_, name, boost::bind(&innerActionClass::analysisCB, this, _1), false)
     , action_name_(name)
+    , PWM(&nh_, "forward")
   {
     // Add preempt callback
     forwardServer_.registerPreemptCallback(boost::bind(&innerActionClass::preemptCB, this));
-    // Declaring publisher for PWM
-    PWM = nh_.advertise<std_msgs::Int32>("/pwm/forward", 1000);
     // Starting new Action Server
     forwardServer_.start();
   }
@@ -52,9 +97,8 @@ public:
   // callback for goal cancelled
   void preemptCB(void)
   {
-    pwm.data = 0;
-    PWM.publish(pwm);
-    ROS_INFO("pwm send to arduino %d", pwm.data);
+    PWM.stop();
+    ROS_INFO("pwm send to arduino 0");
     // this command cancels the previous goal
     forwardServer_.setPreempted();
   }
@@ -67,11 +111,44 @@ public:
     int count = 0;
     int loopRate = 10;
     ros::Rate loop_rate(loopRate);
+    PWM.start();
+
+    {
+      boost::mutex::scoped_lock lock(positionMutex);
+      if (!input.select(goal->Source))
+      {
+        ROS_ERROR("%s: %s is no sensor board value", action_name_.c_str(), goal->Source.c_str());
+        forwardServer_.setAborted();
+        return;
+      }
+      if (goal->Source.empty() && goal->SetStart)
+      {
+        // dead reckoning, the task server says where the vehicle starts
+        initData = false;
+        updatePosition(goal->Start);
+      }
+      else if (goal->Source.empty() && goal->Source != previousSource_)
+      {
+        // back on the topic from its newest value, or from the last board reading if nothing was ever published
+        if (topicData)
+        {
+          initData = false;
+          updatePosition(topicPosition);
+        }
+      }
+      else if (goal->Source != previousSource_)
+      {
+        // switching to another board value waits for a fresh reading of it
+        initData = false;
+      }
+      previousSource_ = goal->Source;
+    }
 
     // waiting till we recieve the first value from Camera else it's useless to any calculations
-    while (!initData)
+    float present = 0, previous = 0;
+    while (!readInput(&present, &previous) && !forwardServer_.isPreemptRequested() && ros::ok())
     {
-      ROS_INFO("Waiting to get first input from Camera");
+      ROS_INFO("Waiting to get first input %s", input.onBoard() ? input.name().c_str() : "at topic xDistance");
       loop_rate.sleep();
     }
 
@@ -87,10 +164,21 @@ public:
 
     while (!forwardServer_.isPreemptRequested() && ros::ok() && count < goal->loop)
     {
-      error = presentForwardPosition - finalForwardPosition;
+      readInput(&present, &previous);
+      float kp, ki, kd;
+      {
+        boost::mutex::scoped_lock lock(gainMutex_);
+        kp = p;
+        ki = i;
+        kd = d;
+      }
+      // one control step, on behalf of the frame the newest input was measured in
+      hardware_commons::trace::Span span(
+          "forward", input.onBoard() ? input.trace() : hardware_commons::trace::follow("/varun/motion/x_distance"));
+      error = present - finalForwardPosition;
       integral += (error * dt);
-      derivative = (presentForwardPosition - previousForwardPosition) / dt;
-      output = (p * error) + (i * integral) + (d * derivative);
+      derivative = (present - previous) / dt;
+      output = (kp * error) + (ki * integral) + (kd * derivative);
       forwardOutputPWMMapping(output);
 
       if (pwm.data <= 8 && pwm.data >= -8)
@@ -121,7 +209,7 @@ public:
       PWM.publish(pwm);
       ROS_INFO("pwm send to arduino forward %d", pwm.data);
 
-      ros::spinOnce();
+      span.close();
       loop_rate.sleep();
     }
     if (reached)
@@ -146,6 +234,7 @@ public:
 
   void setPID(float new_p, float new_i, float new_d)
   {
+    boost::mutex::scoped_lock lock(gainMutex_);
     p = new_p;
     i = new_i;
     d = new_d;
@@ -162,18 +251,11 @@ void callback(motion_forward::pidConfig &config, double level)
 
 void distanceCb(std_msgs::Float64 msg)
 {
-  // this is used to set the final angle after getting the value of first intial position
-  if (initData == false)
-  {
-    presentForwardPosition = msg.data;
-    previousForwardPosition = presentForwardPosition;
-    initData = true;
-  }
-  else
-  {
-    previousForwardPosition = presentForwardPosition;
-    presentForwardPosition = msg.data;
-  }
+  boost::mutex::scoped_lock lock(positionMutex);
+  topicPosition = msg.data;
+  topicData = true;
+  if (!input.onBoard())
+    updatePosition(msg.data);
 }
 
 int main(int argc, char **argv)
@@ -185,13 +267,22 @@ int main(int argc, char **argv)
   n.getParam("forward/i_param", i_param);
   n.getParam("forward/d_param", d_param);
 
-  ros::Subscriber xDistance = n.subscribe<std_msgs::Float64>("/varun/motion/x_distance", 1000, &distanceCb);
+  // sensor input, goals and preempts, and dynamic reconfigure are served by their own threads, the control loop in
+  // analysisCB runs on the action server's thread and never waits for a queue
+  motion_commons::CallbackGroup sensors("sensor");
+  motion_commons::CallbackGroup action("action");
+  motion_commons::CallbackGroup reconfigure("reconfigure", "~");
+
+  ros::Subscriber xDistance = hardware_commons::subscribe<std_msgs::Float64>(
+      sensors.nodeHandle(), "/varun/motion/x_distance", hardware_commons::LATEST, &distanceCb);
+  if (!sensorBoard.open())
+    ROS_WARN("%s, goals with a Source will not get any input", sensorBoard.error().c_str());
 
   ROS_INFO("Waiting for Goal");
-  object = new innerActionClass(ros::this_node::getName());
+  object = new innerActionClass(ros::this_node::getName(), action.nodeHandle());
 
   // register dynamic reconfig server.
-  dynamic_reconfigure::Server<motion_forward::pidConfig> server;
+  dynamic_reconfigure::Server<motion_forward::pidConfig> server(reconfigure.nodeHandle());
   dynamic_reconfigure::Server<motion_forward::pidConfig>::CallbackType f;
   f = boost::bind(&callback, _1, _2);
   server.setCallback(f);
@@ -202,6 +293,9 @@ int main(int argc, char **argv)
   config.d = d_param;
   callback(config, 0);
 
-  ros::spin();
+  sensors.start();
+  action.start();
+  reconfigure.start();
+  ros::waitForShutdown();
   return 0;
 }
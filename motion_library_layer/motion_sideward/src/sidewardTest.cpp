@@ -11,6 +11,7 @@
 #include <actionlib/client/terminal_state.h>
 #include <dynamic_reconfigure/server.h>
 #include <motion_sideward/sidewardConfig.h>
+#include <hardware_commons/queue_policy.h>
 
 typedef actionlib::SimpleActionClient<motion_commons::SidewardAction> Client;  // defining the Client type
 
@@ -22,14 +23,12 @@ ros::Publisher ip_switch;
 bool moving = false;
 bool success = false;
 
-// New thread for recieving result, called from dynamic reconfig callback
+// Done callback of the goal sent from the dynamic reconfig callback, actionlib calls it when the result arrives
 // Result recieved, start next motion or if motion unsuccessful then do error
 // handling
-void spinThread()
+void doneCb(const actionlib::SimpleClientGoalState &state, const motion_commons::SidewardResultConstPtr &result)
 {
-  Client &temp = *clientPointer;
-  temp.waitForResult();
-  success = (*(temp.getResult())).Result;
+  success = result && result->Result;
   if (success)
   {
     ROS_INFO("motion successful");
@@ -71,8 +70,7 @@ void callback(motion_sideward::sidewardConfig &config, double level)
     ip_switch.publish(msg);
     goal.Goal = config.double_param;
     goal.loop = config.loop;
-    can.sendGoal(goal);
-    boost::thread spin_thread(&spinThread);
+    can.sendGoal(goal, &doneCb);
     ROS_INFO("Goal Send %f loop: %d", goal.Goal, goal.loop);
     moving = true;
   }
@@ -98,10 +96,13 @@ int main(int argc, char **argv)
 
   ros::NodeHandle nh;
   // Subscribing to feedback from ActionServer
-  ros::Subscriber sub_ = nh.subscribe<motion_commons::SidewardActionFeedback>("/sideward/feedback", 1000, &sidewardCb);
-  ros::Subscriber ip_data_sub = nh.subscribe<std_msgs::Float64MultiArray>("/varun/ip/buoy", 1000, &ip_data_callback);
-  ip_data_pub = nh.advertise<std_msgs::Float64>("/varun/motion/y_distance", 1000);
-  ip_switch = nh.advertise<std_msgs::Bool>("buoy_detection_switch", 1000);
+  ros::Subscriber sub_ = hardware_commons::subscribe<motion_commons::SidewardActionFeedback>(
+      nh, "/sideward/feedback", hardware_commons::EVENTS, &sidewardCb);
+  ros::Subscriber ip_data_sub = hardware_commons::subscribe<std_msgs::Float64MultiArray>(
+      nh, "/varun/ip/buoy", hardware_commons::LATEST, &ip_data_callback);
+  ip_data_pub =
+      hardware_commons::advertise<std_msgs::Float64>(nh, "/varun/motion/y_distance", hardware_commons::LATEST);
+  ip_switch = hardware_commons::advertise<std_msgs::Bool>(nh, "buoy_detection_switch", hardware_commons::EVENTS);
 
   // Declaring a new ActionClient
   Client sidewardTestClient("sideward");
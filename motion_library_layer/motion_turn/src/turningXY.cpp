@@ -4,9 +4,15 @@
 #include <std_msgs/Float64.h>
 #include <std_msgs/Int32.h>
 #include <actionlib/server/simple_action_server.h>
+#include <motion_commons/callback_group.h>
+#include <motion_commons/input_source.h>
+#include <motion_commons/pwm_output.h>
 #include <motion_commons/TurnAction.h>
 #include <dynamic_reconfigure/server.h>
 #include <motion_turn/pidConfig.h>
+#include <hardware_commons/sensor_board.h>
+#include <hardware_commons/trace.h>
+#include <boost/thread/mutex.hpp>
 #include <string>
 using std::string;
 
@@ -16,6 +22,30 @@ float previousAngularPosition = 0;
 float finalAngularPosition, error, output;
 bool initData = false;
 std_msgs::Int32 pwm;  // pwm to be send to arduino
+// the imu node writes every yaw here, read once per control step instead of relayed through a task server; a goal
+// may measure its angle on another value of the board
+hardware_commons::SensorBoard sensorBoard;
+motion_commons::InputSource input(&sensorBoard);
+const char *const yaw = "imu[0]";
+
+void readYaw()
+{
+  double angle;
+  if (!input.read(&angle))
+    return;
+  // this is used to set the final angle after getting the value of first intial position
+  if (initData == false)
+  {
+    presentAngularPosition = angle;
+    previousAngularPosition = presentAngularPosition;
+    initData = true;
+  }
+  else
+  {
+    previousAngularPosition = presentAngularPosition;
+    presentAngularPosition = angle;
+  }
+}
 
 // new inner class, to encapsulate the interaction with actionclient
 class innerActionClass
@@ -26,20 +56,22 @@ private:
   std::string action_name_;
   motion_commons::TurnFeedback feedback_;
   motion_commons::TurnResult result_;
-  ros::Publisher PWM;
+  motion_commons::PwmOutput PWM;
+  std::string previousSource_;
   float p, i, d;
+  boost::mutex gainMutex_;  // setPID is called on the reconfigure thread
 
 public:
   // Constructor, called when new instance of class declared
-  explicit innerActionClass(std::string name)
+  innerActionClass(std::string name, const ros::NodeHandle &nh)
     :  // Defining the server, third argument is optional
-    turnServer_(nh_, name, boost::bind(&innerActionClass::analysisCB, this, _1), false)
+    nh_(nh)
+    , turnServer_(nh_, name, boost::bind(&innerActionClass::analysisCB, this, _1), false)
     , action_name_(name)
+    , PWM(&nh_, "turn")
   {
     // Add preempt callback
     turnServer_.registerPreemptCallback(boost::bind(&innerActionClass::preemptCB, this));
-    // Declaring publisher for PWM
-    PWM = nh_.advertise<std_msgs::Int32>("/pwm/turn", 1000);
     // Starting new Action Server
     turnServer_.start();
   }
@@ -52,9 +84,8 @@ public:
   // callback for goal cancelled, stop the bot
   void preemptCB(void)
   {
-    pwm.data = 0;
-    PWM.publish(pwm);
-    ROS_INFO("pwm send to arduino %d", pwm.data);
+    PWM.stop();
+    ROS_INFO("pwm send to arduino 0");
     // this command cancels the previous goal
     turnServer_.setPreempted();
   }
@@ -67,13 +98,26 @@ public:
     int count = 0;
     int loopRate = 10;
     ros::Rate loop_rate(loopRate);
+    PWM.start();
+
+    std::string source = goal->Source.empty() ? yaw : goal->Source;
+    if (!input.select(source))
+    {
+      ROS_ERROR("%s: %s is no sensor board value", action_name_.c_str(), source.c_str());
+      turnServer_.setAborted();
+      return;
+    }
+    // an angle measured on something else than the imu starts from a fresh reading of it
+    if (source != previousSource_)
+      initData = false;
+    previousSource_ = source;
 
     // waiting till we recieve the first value from IMU else it's useless to any calculations
-    while (!initData)
+    while (!initData && !turnServer_.isPreemptRequested() && ros::ok())
     {
-      ROS_INFO("Waiting to get first input from IMU");
+      ROS_INFO("Waiting to get first input from %s", source.c_str());
       loop_rate.sleep();
-      ros::spinOnce();
+      readYaw();
     }
 
     finalAngularPosition = presentAngularPosition + goal->AngleToTurn;
@@ -91,10 +135,19 @@ public:
 
     while (!turnServer_.isPreemptRequested() && ros::ok() && count < goal->loop)
     {
+      readYaw();
+      float kp, ki, kd;
+      {
+        boost::mutex::scoped_lock lock(gainMutex_);
+        kp = p;
+        ki = i;
+        kd = d;
+      }
+      hardware_commons::trace::Span span("turningXY", input.trace());
       error = finalAngularPosition - presentAngularPosition;
       integral += (error * dt);
       derivative = (presentAngularPosition - previousAngularPosition) / dt;
-      output = (p * error) + (i * integral) + (d * derivative);
+      output = (kp * error) + (ki * integral) + (kd * derivative);
       turningOutputPWMMapping(output);
 
       if (error < 2 && error > -2)
@@ -125,7 +178,7 @@ public:
       PWM.publish(pwm);
       ROS_INFO("pwm send to arduino turn %d", pwm.data);
 
-      ros::spinOnce();
+      span.close();
       loop_rate.sleep();
     }
     if (reached)
@@ -150,6 +203,7 @@ public:
 
   void setPID(float new_p, float new_i, float new_d)
   {
+    boost::mutex::scoped_lock lock(gainMutex_);
     p = new_p;
     i = new_i;
     d = new_d;
@@ -164,22 +218,6 @@ void callback(motion_turn::pidConfig &config, double level)
   object->setPID(config.p, config.i, config.d);
 }
 
-void yawCb(std_msgs::Float64 msg)
-{
-  // this is used to set the final angle after getting the value of first intial position
-  if (initData == false)
-  {
-    presentAngularPosition = msg.data;
-    previousAngularPosition = presentAngularPosition;
-    initData = true;
-  }
-  else
-  {
-    previousAngularPosition = presentAngularPosition;
-    presentAngularPosition = msg.data;
-  }
-}
-
 int main(int argc, char **argv)
 {
   ros::init(argc, argv, "turningXY");
@@ -189,13 +227,22 @@ int main(int argc, char **argv)
   n.getParam("turningXY/i_param", i_param);
   n.getParam("turningXY/d_param", d_param);
 
-  ros::Subscriber yaw = n.subscribe<std_msgs::Float64>("/varun/motion/yaw", 1000, &yawCb);
+  if (!sensorBoard.open())
+  {
+    ROS_ERROR("%s", sensorBoard.error().c_str());
+    return 1;
+  }
+
+  // goals and preempts, and dynamic reconfigure are served by their own threads, the control loop in analysisCB
+  // runs on the action server's thread and never waits for a queue
+  motion_commons::CallbackGroup action("action");
+  motion_commons::CallbackGroup reconfigure("reconfigure", "~");
 
   ROS_INFO("Waiting for Goal");
-  object = new innerActionClass(ros::this_node::getName());
+  object = new innerActionClass(ros::this_node::getName(), action.nodeHandle());
 
   // register dynamic reconfig server.
-  dynamic_reconfigure::Server<motion_turn::pidConfig> server;
+  dynamic_reconfigure::Server<motion_turn::pidConfig> server(reconfigure.nodeHandle());
   dynamic_reconfigure::Server<motion_turn::pidConfig>::CallbackType f;
   f = boost::bind(&callback, _1, _2);
   server.setCallback(f);
@@ -206,6 +253,8 @@ int main(int argc, char **argv)
   config.d = d_param;
   callback(config, 0);
 
-  ros::spin();
+  action.start();
+  reconfigure.start();
+  ros::waitForShutdown();
   return 0;
 }
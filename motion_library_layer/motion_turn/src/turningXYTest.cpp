@@ -8,12 +8,12 @@
 #include <actionlib/client/terminal_state.h>
 #include <dynamic_reconfigure/server.h>
 #include <motion_turn/turningConfig.h>
+#include <hardware_commons/queue_policy.h>
 
 typedef actionlib::SimpleActionClient<motion_commons::TurnAction> Client;
 Client *clientPointer;
 motion_commons::TurnGoal goal;
 
-ros::Publisher imu_data_pub;
 bool goalSet = false;
 
 // dynamic reconfig
@@ -46,11 +46,6 @@ void callback(motion_turn::turningConfig &config, double level)
   }
 }
 
-void imu_data_callback(std_msgs::Float64 msg)
-{
-  imu_data_pub.publish(msg);
-}
-
 // never ever put the argument of the callback function anything other then the specified
 void turnCb(motion_commons::TurnActionFeedback msg)
 {
@@ -62,9 +57,8 @@ int main(int argc, char **argv)
   ros::init(argc, argv, "testTurningXY");
 
   ros::NodeHandle nh;
-  ros::Subscriber sub_ = nh.subscribe<motion_commons::TurnActionFeedback>("/turningXY/feedback", 1000, &turnCb);
-  ros::Subscriber imu_data_sub = nh.subscribe<std_msgs::Float64>("/varun/sensors/imu/yaw", 1000, &imu_data_callback);
-  imu_data_pub = nh.advertise<std_msgs::Float64>("/varun/motion/yaw", 1000);
+  ros::Subscriber sub_ = hardware_commons::subscribe<motion_commons::TurnActionFeedback>(
+      nh, "/turningXY/feedback", hardware_commons::EVENTS, &turnCb);
 
   Client TurnTestClient("turningXY");
   clientPointer = &TurnTestClient;
@@ -4,18 +4,72 @@
 #include <std_msgs/Float64.h>
 #include <std_msgs/Int32.h>
 #include <actionlib/server/simple_action_server.h>
+#include <motion_commons/callback_group.h>
+#include <motion_commons/input_source.h>
+#include <motion_commons/pwm_output.h>
 #include <motion_commons/UpwardAction.h>
 #include <dynamic_reconfigure/server.h>
 #include <motion_upward/pidConfig.h>
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/sensor_board.h>
+#include <hardware_commons/trace.h>
+#include <boost/thread/mutex.hpp>
 #include <string>
 using std::string;
 
 typedef actionlib::SimpleActionServer<motion_commons::UpwardAction> Server;  // defining the Client type
+// written by distanceCb on the sensor thread and by the control loop on the action thread, under positionMutex
+boost::mutex positionMutex;
 float presentDepth = 0;
 float previousDepth = 0;
 float finalDepth, error, output;
 bool initData = false;
+// last value on /varun/motion/z_distance, kept while goals read the board for the next goal without Source
+float topicDepth = 0;
+bool topicData = false;
+// depth[1], the rate the arduino filters along with the depth, while the goal tracks depth and link_bridge sends it
+float depthRate = 0;
+bool measuredRate = false;
 std_msgs::Int32 pwm;  // pwm to be send to arduino
+// set per goal, depth[0] tracks the pressure sensor, goals with a Source ignore /varun/motion/z_distance
+hardware_commons::SensorBoard sensorBoard;
+motion_commons::InputSource input(&sensorBoard);
+
+void updateDepth(float depth)
+{
+  // this is used to set the final depth after getting the value of first intial position
+  if (initData == false)
+  {
+    presentDepth = depth;
+    previousDepth = presentDepth;
+    initData = true;
+  }
+  else
+  {
+    previousDepth = presentDepth;
+    presentDepth = depth;
+  }
+}
+
+// the newest position, with the board read first for goals with a Source, and the filtered rate if measured is set;
+// false while there is no position yet
+bool readInput(float *present, float *previous, bool *measured, float *rate)
+{
+  boost::mutex::scoped_lock lock(positionMutex);
+  double value;
+  if (input.read(&value))
+  {
+    updateDepth(value);
+    double filtered;
+    measuredRate = input.channel() == hardware_commons::DEPTH && input.value(1, &filtered);
+    depthRate = measuredRate ? filtered : 0;
+  }
+  *present = presentDepth;
+  *previous = previousDepth;
+  *measured = measuredRate;
+  *rate = depthRate;
+  return initData;
+}
 
 // new inner class, to encapsulate the interaction with actionclient
 class innerActionClass
@@ -26,20 +80,22 @@ private:
   std::string action_name_;
   motion_commons::UpwardFeedback feedback_;
   motion_commons::UpwardResult result_;
-  ros::Publisher PWM;
+  motion_commons::PwmOutput PWM;
+  std::string previousSource_;
   float p, i, d;
+  boost::mutex gainMutex_;  // setPID is called on the reconfigure thread
 
 public:
   // Constructor, called when new instance of class declared
-  explicit innerActionClass(std::string name)
+  innerActionClass(std::string name, const ros::NodeHandle &nh)
     :  // Defining the server, third argument is optional
-    upwardServer_(nh_, name, boost::bind(&innerActionClass::analysisCB, this, _1), false)
+    nh_(nh)
+    , upwardServer_(nh_, name, boost::bind(&innerActionClass::analysisCB, this, _1), false)
     , action_name_(name)
+    , PWM(&nh_, "upward")
   {
     // Add preempt callback
     upwardServer_.registerPreemptCallback(boost::bind(&innerActionClass::preemptCB, this));
-    // Declaring publisher for PWM
-    PWM = nh_.advertise<std_msgs::Int32>("/pwm/upward", 1000);
     // Starting new Action Server
     upwardServer_.start();
   }
@@ -52,9 +108,8 @@ public:
   // callback for goal cancelled; Stop the bot
   void preemptCB(void)
   {
-    pwm.data = 0;
-    PWM.publish(pwm);
-    ROS_INFO("pwm send to arduino %d", pwm.data);
+    PWM.stop();
+    ROS_INFO("pwm send to arduino 0");
     // this command cancels the previous goal
     upwardServer_.setPreempted();
   }
@@ -67,11 +122,40 @@ public:
     int count = 0;
     int loopRate = 10;
     ros::Rate loop_rate(loopRate);
+    PWM.start();
+
+    {
+      boost::mutex::scoped_lock lock(positionMutex);
+      if (!input.select(goal->Source))
+      {
+        ROS_ERROR("%s: %s is no sensor board value", action_name_.c_str(), goal->Source.c_str());
+        upwardServer_.setAborted();
+        return;
+      }
+      measuredRate = false;
+      if (goal->Source.empty() && goal->Source != previousSource_)
+      {
+        // back on the topic from its newest value, or from the last board reading if nothing was ever published
+        if (topicData)
+        {
+          initData = false;
+          updateDepth(topicDepth);
+        }
+      }
+      else if (goal->Source != previousSource_)
+      {
+        // switching to another board value waits for a fresh reading of it
+        initData = false;
+      }
+      previousSource_ = goal->Source;
+    }
 
     // waiting till we recieve the first value from Camera/pressure sensor else it's useless do any calculations
-    while (!initData)
+    float present = 0, previous = 0, rate = 0;
+    bool measured = false;
+    while (!readInput(&present, &previous, &measured, &rate) && !upwardServer_.isPreemptRequested() && ros::ok())
     {
-      ROS_INFO("Waiting to get first input at topic zDistance");
+      ROS_INFO("Waiting to get first input %s", input.onBoard() ? input.name().c_str() : "at topic zDistance");
       loop_rate.sleep();
     }
 
@@ -86,10 +170,21 @@ public:
 
     while (!upwardServer_.isPreemptRequested() && ros::ok() && count < goal->loop)
     {
-      error = finalDepth - presentDepth;
+      readInput(&present, &previous, &measured, &rate);
+      float kp, ki, kd;
+      {
+        boost::mutex::scoped_lock lock(gainMutex_);
+        kp = p;
+        ki = i;
+        kd = d;
+      }
+      hardware_commons::trace::Span span(
+          "upward", input.onBoard() ? input.trace() : hardware_commons::trace::follow("/varun/motion/z_distance"));
+      error = finalDepth - present;
       integral += (error * dt);
-      derivative = (presentDepth - previousDepth) / dt;
-      output = (p * error) + (i * integral) + (d * derivative);
+      // the arduino's filtered rate of the pressure sensor is smoother than a difference of 10 Hz samples
+      derivative = measured ? rate : (present - previous) / dt;
+      output = (kp * error) + (ki * integral) + (kd * derivative);
       upwardOutputPWMMapping(output);
 
       if (pwm.data <= 2 && pwm.data >= -2)
@@ -120,7 +215,7 @@ public:
       PWM.publish(pwm);
       ROS_INFO("pwm send to arduino upward %d", pwm.data);
 
-      ros::spinOnce();
+      span.close();
       loop_rate.sleep();
     }
     if (reached)
@@ -146,6 +241,7 @@ public:
 
   void setPID(float new_p, float new_i, float new_d)
   {
+    boost::mutex::scoped_lock lock(gainMutex_);
     p = new_p;
     i = new_i;
     d = new_d;
@@ -162,17 +258,13 @@ void callback(motion_upward::pidConfig &config, double level)
 
 void distanceCb(std_msgs::Float64 msg)
 {
-  // this is used to set the final depth after getting the value of first intial position
-  if (initData == false)
+  boost::mutex::scoped_lock lock(positionMutex);
+  topicDepth = msg.data;
+  topicData = true;
+  if (!input.onBoard())
   {
-    presentDepth = msg.data;
-    previousDepth = presentDepth;
-    initData = true;
-  }
-  else
-  {
-    previousDepth = presentDepth;
-    presentDepth = msg.data;
+    updateDepth(msg.data);
+    measuredRate = false;
   }
 }
 
@@ -185,13 +277,22 @@ int main(int argc, char **argv)
   n.getParam("upward/i_param", i_param);
   n.getParam("upward/d_param", d_param);
 
-  ros::Subscriber zDistance = n.subscribe<std_msgs::Float64>("/varun/motion/z_distance", 1000, &distanceCb);
+  // sensor input, goals and preempts, and dynamic reconfigure are served by their own threads, the control loop in
+  // analysisCB runs on the action server's thread and never waits for a queue
+  motion_commons::CallbackGroup sensors("sensor");
+  motion_commons::CallbackGroup action("action");
+  motion_commons::CallbackGroup reconfigure("reconfigure", "~");
+
+  ros::Subscriber zDistance = hardware_commons::subscribe<std_msgs::Float64>(
+      sensors.nodeHandle(), "/varun/motion/z_distance", hardware_commons::LATEST, &distanceCb);
+  if (!sensorBoard.open())
+    ROS_WARN("%s, goals with a Source will not get any input", sensorBoard.error().c_str());
 
   ROS_INFO("Waiting for Goal");
-  object = new innerActionClass(ros::this_node::getName());
+  object = new innerActionClass(ros::this_node::getName(), action.nodeHandle());
 
   // register dynamic reconfig server.
-  dynamic_reconfigure::Server<motion_upward::pidConfig> server;
+  dynamic_reconfigure::Server<motion_upward::pidConfig> server(reconfigure.nodeHandle());
   dynamic_reconfigure::Server<motion_upward::pidConfig>::CallbackType f;
   f = boost::bind(&callback, _1, _2);
   server.setCallback(f);
@@ -202,6 +303,9 @@ int main(int argc, char **argv)
   config.d = d_param;
   callback(config, 0);
 
-  ros::spin();
+  sensors.start();
+  action.start();
+  reconfigure.start();
+  ros::waitForShutdown();
   return 0;
 }
@@ -9,6 +9,7 @@
 #include <actionlib/client/terminal_state.h>
 #include <dynamic_reconfigure/server.h>
 #include <motion_upward/upwardConfig.h>
+#include <hardware_commons/queue_policy.h>
 
 typedef actionlib::SimpleActionClient<motion_commons::UpwardAction> Client;  // defining the Client type
 
@@ -17,16 +18,13 @@ motion_commons::UpwardGoal goal;  // new goal object to send to action server
 
 bool moving = false;
 bool success = false;
-ros::Publisher pressure_data_pub;
 
-// New thread for recieving result, called from dynamic reconfig callback
+// Done callback of the goal sent from the dynamic reconfig callback, actionlib calls it when the result arrives
 // Result recieved, start next motion or if motion unsuccessful then do error
 // handling
-void spinThread()
+void doneCb(const actionlib::SimpleClientGoalState &state, const motion_commons::UpwardResultConstPtr &result)
 {
-  Client &temp = *clientPointer;
-  temp.waitForResult();
-  success = (*(temp.getResult())).Result;
+  success = result && result->Result;
   if (success)
   {
     ROS_INFO("motion successful");
@@ -60,18 +58,14 @@ void callback(motion_upward::upwardConfig &config, double level)
     }
     goal.Goal = config.double_param;
     goal.loop = config.loop;
-    can.sendGoal(goal);
-    boost::thread spin_thread(&spinThread);
+    // the server reads the pressure sensor itself
+    goal.Source = "depth[0]";
+    can.sendGoal(goal, &doneCb);
     ROS_INFO("Goal Send %f loop: %d", goal.Goal, goal.loop);
     moving = true;
   }
 }
 
-void pressure_data_callback(std_msgs::Float64 msg)
-{
-  pressure_data_pub.publish(msg);
-}
-
 // Callback for Feedback from Action Server
 void upwardCb(motion_commons::UpwardActionFeedback msg)
 {
@@ -85,10 +79,8 @@ int main(int argc, char **argv)
 
   ros::NodeHandle nh;
   // Subscribing to feedback from ActionServer
-  ros::Subscriber sub_ = nh.subscribe<motion_commons::UpwardActionFeedback>("/upward/feedback", 1000, &upwardCb);
-  ros::Subscriber pressure_data_sub =
-      nh.subscribe<std_msgs::Float64>("/varun/sensors/pressure_sensor/depth", 1000, &pressure_data_callback);
-  pressure_data_pub = nh.advertise<std_msgs::Float64>("/varun/motion/z_distance", 1000);
+  ros::Subscriber sub_ = hardware_commons::subscribe<motion_commons::UpwardActionFeedback>(
+      nh, "/upward/feedback", hardware_commons::EVENTS, &upwardCb);
 
   // Declaring a new ActionClient
   Client upwardTestClient("upward");
@@ -0,0 +1,46 @@
+// Copyright 2016 AUV-IITK
+#ifndef TASK_BUOY_BUOY_PIPELINE_H
+#define TASK_BUOY_BUOY_PIPELINE_H
+
+#include <task_commons/vision_scheduler.h>
+#include <dynamic_reconfigure/server.h>
+#include <task_buoy/buoyConfig.h>
+#include <hardware_commons/sensor_board.h>
+#include <opencv2/core/core.hpp>
+#include <ros/ros.h>
+#include <vector>
+
+/*! \file
+* \brief Finds the buoy in the front camera
+*
+* Publishes radius, x and y offset from the centre of the screen and the estimated distance on /varun/ip/buoy. While
+* the buoy is lost all four carry a negative code for the edge it was last seen near, -5 once it fills the screen.
+*/
+namespace task_buoy
+{
+class BuoyPipeline : public task_commons::Pipeline
+{
+public:
+  explicit BuoyPipeline(const ros::NodeHandle &nh);
+
+protected:
+  void process(const cv::Mat &frame);
+
+private:
+  void callback(task_buoy::buoyConfig &config, uint32_t level);
+
+  ros::NodeHandle nh_;
+  ros::Publisher pub_;
+  // every detection also goes on the sensor board for the nodes on the vehicle
+  hardware_commons::SensorBoard sensorBoard_;
+  dynamic_reconfigure::Server<task_buoy::buoyConfig> server_;
+
+  int t1min_, t1max_, t2min_, t2max_, t3min_, t3max_;
+  // last five radii and centres, a detection far off their average is ignored
+  float r_[5];
+  std::vector<cv::Point2f> centerIdeal_;
+  int countAvg_;
+};
+}  // namespace task_buoy
+
+#endif  // TASK_BUOY_BUOY_PIPELINE_H
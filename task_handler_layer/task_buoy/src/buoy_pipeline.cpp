@@ -0,0 +1,165 @@
+// Copyright 2016 AUV-IITK
+#include <task_buoy/buoy_pipeline.h>
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/trace.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "std_msgs/Float64MultiArray.h"
+#include <boost/bind.hpp>
+#include <cmath>
+#include <vector>
+
+namespace task_buoy
+{
+BuoyPipeline::BuoyPipeline(const ros::NodeHandle &nh)
+  : task_commons::Pipeline("buoy_detection", "/varun/sensors/front_camera/image_raw", "buoy_detection_switch")
+  , nh_(nh)
+  , server_(ros::NodeHandle(nh_, "buoy_detection"))
+  , t1min_(0), t1max_(0), t2min_(0), t2max_(0), t3min_(0), t3max_(0)
+  , centerIdeal_(5)
+  , countAvg_(0)
+{
+  pub_ = hardware_commons::advertise<std_msgs::Float64MultiArray>(nh_, "/varun/ip/buoy", hardware_commons::LATEST);
+  if (!sensorBoard_.open())
+    ROS_ERROR("%s", sensorBoard_.error().c_str());
+  for (int m = 0; m < 5; m++)
+    r_[m] = 0;
+
+  nh_.getParam("buoy_detection/t1maxParam", t1max_);
+  nh_.getParam("buoy_detection/t1minParam", t1min_);
+  nh_.getParam("buoy_detection/t2maxParam", t2max_);
+  nh_.getParam("buoy_detection/t2minParam", t2min_);
+  nh_.getParam("buoy_detection/t3maxParam", t3max_);
+  nh_.getParam("buoy_detection/t3minParam", t3min_);
+
+  server_.setCallback(boost::bind(&BuoyPipeline::callback, this, _1, _2));
+}
+
+void BuoyPipeline::callback(task_buoy::buoyConfig &config, uint32_t level)
+{
+  t1min_ = config.t1min_param;
+  t1max_ = config.t1max_param;
+  t2min_ = config.t2min_param;
+  t2max_ = config.t2max_param;
+  t3min_ = config.t3min_param;
+  t3max_ = config.t3max_param;
+  ROS_INFO("Reconfigure Request : New parameters : %d %d %d %d %d %d", t1min_, t1max_, t2min_, t2max_, t3min_, t3max_);
+}
+
+void BuoyPipeline::process(const cv::Mat &frame)
+{
+  std_msgs::Float64MultiArray array;
+  cv::Mat hsv_frame, thresholded;
+
+  // Covert color space to HSV as it is much easier to filter colors in the HSV color-space.
+  cv::cvtColor(frame, hsv_frame, CV_BGR2HSV);
+  cv::Scalar hsv_min = cv::Scalar(t1min_, t2min_, t3min_, 0);
+  cv::Scalar hsv_max = cv::Scalar(t1max_, t2max_, t3max_, 0);
+  // Filter out colors which are out of range.
+  cv::inRange(hsv_frame, hsv_min, hsv_max, thresholded);
+
+  if (filters())
+  {
+    // Split image into its 3 one dimensional images
+    cv::Mat thresholded_hsv[3];
+    cv::split(hsv_frame, thresholded_hsv);
+    cv::inRange(thresholded_hsv[0], cv::Scalar(t1min_, 0, 0, 0), cv::Scalar(t1max_, 0, 0, 0), thresholded_hsv[0]);
+    cv::inRange(thresholded_hsv[1], cv::Scalar(t2min_, 0, 0, 0), cv::Scalar(t2max_, 0, 0, 0), thresholded_hsv[1]);
+    cv::inRange(thresholded_hsv[2], cv::Scalar(t3min_, 0, 0, 0), cv::Scalar(t3max_, 0, 0, 0), thresholded_hsv[2]);
+    show("F1", thresholded_hsv[0]);  // individual filters
+    show("F2", thresholded_hsv[1]);
+    show("F3", thresholded_hsv[2]);
+  }
+
+  cv::GaussianBlur(thresholded, thresholded, cv::Size(9, 9), 0, 0, 0);
+  show("After Color Filtering", thresholded);  // The stream after color filtering
+
+  // find contours
+  std::vector<std::vector<cv::Point> > contours;
+  cv::findContours(thresholded, contours, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE);  // Find the contours
+  if (contours.empty())
+  {
+    int x_cord = 320 - centerIdeal_[0].x;
+    int y_cord = -240 + centerIdeal_[0].y;
+    double side = 0;
+    if (x_cord < -270)
+      side = -2;  // top
+    else if (x_cord > 270)
+      side = -1;  // left_side
+    else if (y_cord > 200)
+      side = -3;  // bottom
+    else if (y_cord < -200)
+      side = -4;  // right_side
+    if (side != 0)
+      array.data.assign(4, side);
+    hardware_commons::trace::publish(pub_, array);
+    sensorBoard_.write(hardware_commons::BUOY, array.data.data(), array.data.size());
+    return;
+  }
+
+  double largest_area = 0;
+  int largest_contour_index = 0;
+  for (int i = 0; i < contours.size(); i++)  // iterate through each contour.
+  {
+    double a = cv::contourArea(contours[i], false);  //  Find the area of contour
+    if (a > largest_area)
+    {
+      largest_area = a;
+      largest_contour_index = i;  // Store the index of largest contour
+    }
+  }
+
+  cv::Point2f center;
+  float radius;
+  cv::minEnclosingCircle(contours[largest_contour_index], center, radius);
+  cv::Point2f pt;
+  pt.x = 320;  // size of my screen
+  pt.y = 240;
+
+  float r_avg = (r_[0] + r_[1] + r_[2] + r_[3] + r_[4]) / 5;
+  if ((radius < (r_avg + 10)) && (countAvg_ >= 5))
+  {
+    for (int m = 4; m > 0; m--)
+    {
+      r_[m] = r_[m - 1];
+      centerIdeal_[m] = centerIdeal_[m - 1];
+    }
+    r_[0] = radius;
+    centerIdeal_[0] = center;
+    countAvg_++;
+  }
+  else if (countAvg_ < 5)
+  {
+    r_[countAvg_] = radius;
+    centerIdeal_[countAvg_] = center;
+    countAvg_++;
+  }
+  else
+  {
+    countAvg_ = 0;
+  }
+
+  // the frame is shared with the other pipelines of the camera, the overlay goes on a copy
+  cv::Mat circles = frame.clone();
+  cv::circle(circles, centerIdeal_[0], r_[0], cv::Scalar(0, 250, 0), 1, 8, 0);  // minenclosing circle
+  cv::circle(circles, centerIdeal_[0], 4, cv::Scalar(0, 250, 0), -1, 8, 0);     // center is made on the screen
+  cv::circle(circles, pt, 4, cv::Scalar(150, 150, 150), -1, 8, 0);              // center of screen
+
+  if (r_[0] > 220)
+  {
+    array.data.assign(4, -5);
+  }
+  else
+  {
+    float distance;
+    distance = pow(radius / 7526.5, -.92678);  // function found using experiment
+    array.data.push_back(r_[0]);               // publish radius
+    array.data.push_back((320 - centerIdeal_[0].x));
+    array.data.push_back(-(240 - centerIdeal_[0].y));
+    array.data.push_back(distance);
+  }
+  show("circle", circles);        // Original stream with detected ball overlay
+  show("Contours", thresholded);  // The stream after color filtering
+  hardware_commons::trace::publish(pub_, array);
+  sensorBoard_.write(hardware_commons::BUOY, array.data.data(), array.data.size());
+}
+}  // namespace task_buoy
@@ -8,6 +8,7 @@
 #include <std_msgs/Float64MultiArray.h>
 #include <actionlib/server/simple_action_server.h>
 #include <actionlib/client/simple_action_client.h>
+#include <motion_commons/callback_group.h>
 #include <task_commons/buoyAction.h>
 #include <motion_commons/ForwardAction.h>
 #include <motion_commons/TurnAction.h>
@@ -19,6 +20,9 @@
 #include <motion_commons/UpwardActionFeedback.h>
 #include <motion_commons/UpwardActionResult.h>
 #include <motion_commons/SidewardActionResult.h>
+#include <hardware_commons/sensor_board.h>
+#include <task_commons/state_machine.h>
+#include <hardware_commons/queue_policy.h>
 #include <string>
 
 typedef actionlib::SimpleActionServer<task_commons::buoyAction> Server;
@@ -27,9 +31,24 @@ typedef actionlib::SimpleActionClient<motion_commons::SidewardAction> ClientSide
 typedef actionlib::SimpleActionClient<motion_commons::UpwardAction> ClientUpward;
 typedef actionlib::SimpleActionClient<motion_commons::TurnAction> ClientTurn;
 
+enum BuoyEvent
+{
+  PREEMPT,
+  SIDE_DONE,     // sideward goal finished, value is its Result
+  HEIGHT_DONE,   // upward goal on the camera finished
+  BUOY_REACHED,  // the detector lost the buoy right in front of the bot
+  HIT_TIME,      // the bot had time to hit the buoy
+  RISE_DONE      // upward goal on the pressure sensor finished
+};
+
 class TaskBuoyInnerClass
 {
 private:
+  // detector data, results of the motion goals, and goals and preempts of this server each have their own threads;
+  // the state machine runs on the action server's thread and only waits for its event queue
+  motion_commons::CallbackGroup sensors_;
+  motion_commons::CallbackGroup control_;
+  motion_commons::CallbackGroup action_;
   ros::NodeHandle nh_;
   Server buoy_server_;
   std::string action_name_;
@@ -39,13 +58,7 @@ private:
   task_commons::buoyFeedback feedback_;
   task_commons::buoyResult result_;
   ros::Subscriber sub_ip_;
-  ros::Subscriber yaw_sub_;
-  ros::Subscriber pressure_sensor_sub;
   ros::Publisher switch_buoy_detection;
-  ros::Publisher yaw_pub_;
-  ros::Publisher present_distance_;
-  ros::Publisher present_X_;
-  ros::Publisher present_Y_;
   ClientForward ForwardClient_;
   ClientSideward SidewardClient_;
   ClientUpward UpwardClient_;
@@ -54,32 +67,41 @@ private:
   motion_commons::SidewardGoal sidewardgoal;
   motion_commons::UpwardGoal upwardgoal;
   motion_commons::TurnGoal turngoal;
-  bool successBuoy, heightCenter, sideCenter, IP_stopped, heightGoal;
-  float present_depth;
+  hardware_commons::SensorBoard sensor_board_;
+  task_commons::StateMachine machine_;
+  task_commons::EventQueue events_;
+  int centering_;
+  bool buoyReached_;  // only touched by the state machine
 
 public:
   TaskBuoyInnerClass(std::string name, std::string node, std::string node1, std::string node2, std::string node3)
-    : buoy_server_(nh_, name, boost::bind(&TaskBuoyInnerClass::analysisCB, this, _1), false)
+    : sensors_("sensor")
+    , control_("control")
+    , action_("action")
+    , buoy_server_(action_.nodeHandle(), name, boost::bind(&TaskBuoyInnerClass::analysisCB, this, _1), false)
     , action_name_(name)
-    , ForwardClient_(node)
-    , SidewardClient_(node1)
-    , UpwardClient_(node2)
-    , TurnClient_(node3)
+    , ForwardClient_(control_.nodeHandle(), node, false)
+    , SidewardClient_(control_.nodeHandle(), node1, false)
+    , UpwardClient_(control_.nodeHandle(), node2, false)
+    , TurnClient_(control_.nodeHandle(), node3, false)
+    , machine_(name)
+    , events_(name + "/events")
   {
     ROS_INFO("inside constructor");
+    declareStates();
     buoy_server_.registerPreemptCallback(boost::bind(&TaskBuoyInnerClass::preemptCB, this));
 
-    switch_buoy_detection = nh_.advertise<std_msgs::Bool>("buoy_detection_switch", 1000);
-    present_X_ = nh_.advertise<std_msgs::Float64>("/varun/motion/y_distance", 1000);
-    present_Y_ = nh_.advertise<std_msgs::Float64>("/varun/motion/z_distance", 1000);
-    present_distance_ = nh_.advertise<std_msgs::Float64>("/varun/motion/x_distance", 1000);
-    yaw_pub_ = nh_.advertise<std_msgs::Float64>("/varun/motion/yaw", 1000);
-    sub_ip_ =
-        nh_.subscribe<std_msgs::Float64MultiArray>("/varun/ip/buoy", 1000, &TaskBuoyInnerClass::buoyNavigation, this);
-    yaw_sub_ = nh_.subscribe<std_msgs::Float64>("/varun/sensors/imu/yaw", 1000, &TaskBuoyInnerClass::yawCB, this);
-    pressure_sensor_sub =
-        nh_.subscribe<std_msgs::Float64>("/varun/sensors/pressure_sensor/depth",
-          1000, &TaskBuoyInnerClass::pressureCB, this);
+    switch_buoy_detection =
+        hardware_commons::advertise<std_msgs::Bool>(nh_, "buoy_detection_switch", hardware_commons::EVENTS);
+    // every reading is looked at for the -5 that ends the approach
+    sub_ip_ = hardware_commons::subscribe<std_msgs::Float64MultiArray>(sensors_.nodeHandle(), "/varun/ip/buoy",
+                                                                       hardware_commons::EVENTS,
+                                                                       &TaskBuoyInnerClass::buoyNavigation, this);
+    if (!sensor_board_.open())
+      ROS_ERROR("%s", sensor_board_.error().c_str());
+    sensors_.start();
+    control_.start();
+    action_.start();
     buoy_server_.start();
   }
 
@@ -87,16 +109,11 @@ public:
   {
   }
 
-  void yawCB(std_msgs::Float64 imu_data)
-  {
-    yaw_pub_.publish(imu_data);
-  }
-
-  void pressureCB(std_msgs::Float64 pressure_sensor_data)
+  // latest pressure sensor depth, the upward server reads it off the same board
+  float presentDepth()
   {
-    present_depth = pressure_sensor_data.data;
-    if (successBuoy)
-      present_Y_.publish(pressure_sensor_data);
+    hardware_commons::Reading reading;
+    return sensor_board_.read(hardware_commons::DEPTH, reading) ? reading.values[0] : 0;
   }
 
   void buoyNavigation(std_msgs::Float64MultiArray array)
@@ -105,84 +122,52 @@ public:
     data_Y_.data = array.data[2];
     data_distance_.data = array.data[3];
 
-    if (data_distance_.data > 0)
+    // the motion servers read the offsets off the sensor board themselves, while the distance is positive; at -1 to
+    // -4 the buoy is out of frame and they keep the last data
+    if (data_distance_.data == -5)
     {
-      present_distance_.publish(data_distance_);
-      present_X_.publish(data_X_);
-      present_Y_.publish(data_Y_);
-    }
-
-    // if distance is -1 to -4 then buoy is out of frame and the motion library will assume the last data.
-    else if (data_distance_.data == -5)
-    {
-      IP_stopped = true;
+      events_.post(BUOY_REACHED);
       stopBuoyDetection();
       ROS_INFO("Bot is in front of buoy, IP stopped.");
     }
-  }
 
-  void preemptCB(void)
-  {
-    // Not actually preempting the goal because Prakhar did it in analysisCB
-    ROS_INFO("Called when preempted from the client");
-  }
-
-  void spinThreadUpwardCamera()
-  {
-    ClientUpward &tempUpward = UpwardClient_;
-    tempUpward.waitForResult();
-    heightCenter = (*(tempUpward.getResult())).Result;
-    if (heightCenter)
+    if (buoy_server_.isActive())
     {
-      ROS_INFO("Bot is at height center");
-    }
-    else
-    {
-      ROS_INFO("Bot is not at height center, something went wrong");
+      // publish the feedback
+      feedback_.nosignificance = false;
+      buoy_server_.publishFeedback(feedback_);
+      ROS_INFO("x = %f, y = %f, front distance = %f", data_X_.data, data_Y_.data, data_distance_.data);
     }
   }
 
-  void spinThreadUpwardPressure()
+  void preemptCB(void)
   {
-    ClientUpward &tempUpward = UpwardClient_;
-    tempUpward.waitForResult();
-    heightGoal = (*(tempUpward.getResult())).Result;
-    if (heightGoal)
-    {
-      ROS_INFO("Bot is at desired height.");
-    }
-    else
-    {
-      ROS_INFO("Bot is not at desired height, something went wrong");
-    }
+    ROS_INFO("Called when preempted from the client");
+    // the motion goals are cancelled from here, each motion server zeroes its thrusters in its own preempt callback;
+    // the state machine may be busy with an entry action and only gets to PREEMPT after that
+    cancelMotion();
+    events_.post(PREEMPT);
   }
 
-  void spinThreadSidewardCamera()
+  void cancelMotion()
   {
-    ClientSideward &tempSideward = SidewardClient_;
-    tempSideward.waitForResult();
-    sideCenter = (*(tempSideward.getResult())).Result;
-    if (sideCenter)
-    {
-      ROS_INFO("Bot is at side center");
-    }
-    else
-    {
-      ROS_INFO("Bot is not at side center, something went wrong");
-    }
+    ForwardClient_.cancelAllGoals();
+    SidewardClient_.cancelAllGoals();
+    UpwardClient_.cancelAllGoals();
+    TurnClient_.cancelAllGoals();
   }
 
   void analysisCB(const task_commons::buoyGoalConstPtr goal)
   {
     ROS_INFO("Inside analysisCB");
-    heightCenter = false;
-    sideCenter = false;
-    successBuoy = false;
-    IP_stopped = false;
-    heightGoal = false;
-    ros::Rate looprate(12);
     if (!buoy_server_.isActive())
       return;
+    if (!goal->order)
+    {
+      result_.MotionCompleted = false;
+      buoy_server_.setAborted(result_);
+      return;
+    }
 
     ROS_INFO("Waiting for Forward server to start.");
     ForwardClient_.waitForServer();
@@ -190,12 +175,66 @@ public:
     UpwardClient_.waitForServer();
     TurnClient_.waitForServer();
 
+    events_.clear();
+    buoyReached_ = false;
+    if (!machine_.run(centering_, &events_))
+      buoy_server_.setAborted();
+  }
+
+  // the phases of the task, each waits for the event that ends it instead of polling a flag
+  void declareStates()
+  {
+    using task_commons::StateMachine;
+    using task_commons::succeeded;
+
+    int buoy = machine_.addState("buoy");
+    centering_ = machine_.addState("centering", buoy);
+    int sideAndHeight = machine_.addState("side_and_height", centering_);
+    int heightLeft = machine_.addState("height_left", centering_);
+    int sideLeft = machine_.addState("side_left", centering_);
+    int charging = machine_.addState("charging", buoy);
+    int approaching = machine_.addState("approaching", charging);
+    int hitting = machine_.addState("hitting", charging);
+    int rising = machine_.addState("rising", buoy);
+    int done = machine_.addState("succeeded", buoy);
+    int preempted = machine_.addState("preempted", buoy);
+    machine_.setFinal(done);
+    machine_.setFinal(preempted);
+
+    machine_.addTransition(buoy, PREEMPT, preempted);
+    // the detector can see the buoy up close before centering is over, it is stopped by then
+    machine_.addReaction(buoy, BUOY_REACHED, boost::bind(&TaskBuoyInnerClass::rememberBuoyReached, this));
+
+    machine_.onEntry(centering_, boost::bind(&TaskBuoyInnerClass::startCentering, this));
+    machine_.addTransition(sideAndHeight, SIDE_DONE, heightLeft, succeeded);
+    machine_.addTransition(sideAndHeight, HEIGHT_DONE, sideLeft, succeeded);
+    machine_.addTransition(heightLeft, HEIGHT_DONE, charging, succeeded);
+    machine_.addTransition(sideLeft, SIDE_DONE, charging, succeeded);
+    machine_.addReaction(centering_, SIDE_DONE, boost::bind(&TaskBuoyInnerClass::centeringFailed, this, "side"));
+    machine_.addReaction(centering_, HEIGHT_DONE, boost::bind(&TaskBuoyInnerClass::centeringFailed, this, "height"));
+
+    machine_.onEntry(approaching, boost::bind(&TaskBuoyInnerClass::startApproach, this));
+    machine_.addTransition(approaching, BUOY_REACHED, hitting);
+    machine_.onEntry(hitting, boost::bind(&TaskBuoyInnerClass::waitForHit, this));
+    machine_.addTransition(hitting, HIT_TIME, rising);
+    machine_.onExit(charging, boost::bind(&ClientForward::cancelGoal, &ForwardClient_));  // stop motion here
+
+    machine_.onEntry(rising, boost::bind(&TaskBuoyInnerClass::startRising, this));
+    machine_.addTransition(rising, RISE_DONE, done, StateMachine::Guard(),
+                           boost::bind(&TaskBuoyInnerClass::finishRising, this, _1));
+
+    machine_.onEntry(done, boost::bind(&TaskBuoyInnerClass::succeed, this));
+    machine_.onEntry(preempted, boost::bind(&TaskBuoyInnerClass::preempt, this));
+  }
+
+  void startCentering()
+  {
     TaskBuoyInnerClass::startBuoyDetection();
 
     sidewardgoal.Goal = 0;
     sidewardgoal.loop = 10;
-    SidewardClient_.sendGoal(sidewardgoal);
-    boost::thread spin_thread_sideward_camera(&TaskBuoyInnerClass::spinThreadSidewardCamera, this);
+    sidewardgoal.Source = "buoy[1]?3";
+    SidewardClient_.sendGoal(sidewardgoal, task_commons::ResultEvent(&events_, SIDE_DONE));
 
     // Stabilization of yaw
     turngoal.AngleToTurn = 0;
@@ -204,83 +243,71 @@ public:
 
     upwardgoal.Goal = 0;
     upwardgoal.loop = 10;
-    UpwardClient_.sendGoal(upwardgoal);
-    boost::thread spin_thread_upward_camera(&TaskBuoyInnerClass::spinThreadUpwardCamera, this);
+    upwardgoal.Source = "buoy[2]?3";
+    UpwardClient_.sendGoal(upwardgoal, task_commons::ResultEvent(&events_, HEIGHT_DONE));
+  }
 
-    while (goal->order)
-    {
-      if (buoy_server_.isPreemptRequested() || !ros::ok())
-      {
-        ROS_INFO("%s: Preempted", action_name_.c_str());
-        // set the action state to preempted
-        buoy_server_.setPreempted();
-        successBuoy = false;
-        break;
-      }
-      looprate.sleep();
-      if (heightCenter && sideCenter)
-      {
-        break;
-      }
-      // publish the feedback
-      feedback_.nosignificance = false;
-      buoy_server_.publishFeedback(feedback_);
-      ROS_INFO("x = %f, y = %f, front distance = %f", data_X_.data, data_Y_.data, data_distance_.data);
-      ros::spinOnce();
-    }
+  void centeringFailed(const char *axis)
+  {
+    ROS_INFO("Bot is not at %s center, something went wrong", axis);
+  }
+
+  void rememberBuoyReached()
+  {
+    buoyReached_ = true;
+  }
 
+  void startApproach()
+  {
     ROS_INFO("Bot is in center of buoy");
     forwardgoal.Goal = 0;
     forwardgoal.loop = 10;
+    forwardgoal.Source = "buoy[3]?3";
     ForwardClient_.sendGoal(forwardgoal);
+    if (buoyReached_)
+      events_.post(BUOY_REACHED);
+  }
 
-    while (goal->order)
-    {
-      if (buoy_server_.isPreemptRequested() || !ros::ok())
-      {
-        ROS_INFO("%s: Preempted", action_name_.c_str());
-        // set the action state to preempted
-        buoy_server_.setPreempted();
-        successBuoy = false;
-        break;
-      }
-      looprate.sleep();
-
-      if (IP_stopped)
-      {
-        successBuoy = true;
-        ROS_INFO("Waiting for hitting the buoy...");
-        sleep(1);
-        break;
-      }
-
-      feedback_.nosignificance = false;
-      buoy_server_.publishFeedback(feedback_);
-      ROS_INFO("x = %f, y = %f, front distance = %f", data_X_.data, data_Y_.data, data_distance_.data);
-      ros::spinOnce();
-    }
-
-    ForwardClient_.cancelGoal();  // stop motion here
+  void waitForHit()
+  {
+    ROS_INFO("Waiting for hitting the buoy...");
+    events_.postAfter(1, HIT_TIME);
+  }
 
-    upwardgoal.Goal = present_depth + 5;
+  void startRising()
+  {
+    upwardgoal.Goal = presentDepth() + 5;
     upwardgoal.loop = 10;
-    UpwardClient_.sendGoal(upwardgoal);
-    ROS_INFO("moving upward");
-    boost::thread spin_thread_upward_pressure(&TaskBuoyInnerClass::spinThreadUpwardPressure, this);
+    upwardgoal.Source = "depth[0]";
+    UpwardClient_.sendGoal(upwardgoal, task_commons::ResultEvent(&events_, RISE_DONE));
+    ROS_INFO("moving upward from depth %f", presentDepth());
+  }
 
-    while (!heightGoal)
-    {
-      ROS_INFO("present depth = %f", present_depth);
-      looprate.sleep();
-      ros::spinOnce();
-    }
+  void finishRising(const task_commons::Event &event)
+  {
+    result_.MotionCompleted = task_commons::succeeded(event);
+    if (result_.MotionCompleted)
+      ROS_INFO("Bot is at desired height.");
+    else
+      ROS_INFO("Bot is not at desired height, something went wrong");
+  }
 
-    result_.MotionCompleted = successBuoy && heightGoal;
+  void succeed()
+  {
     ROS_INFO("%s: Succeeded", action_name_.c_str());
     // set the action state to succeeded
     buoy_server_.setSucceeded(result_);
   }
 
+  void preempt()
+  {
+    ROS_INFO("%s: Preempted", action_name_.c_str());
+    // an entry action that ran after preemptCB may have sent a goal again, the yaw hold for one
+    cancelMotion();
+    // set the action state to preempted
+    buoy_server_.setPreempted();
+  }
+
   void startBuoyDetection()
   {
     std_msgs::Bool msg;
@@ -301,6 +328,6 @@ int main(int argc, char **argv)
   ros::init(argc, argv, "buoy_server");
   ROS_INFO("Waiting for Goal");
   TaskBuoyInnerClass taskBuoyObject(ros::this_node::getName(), "forward", "sideward", "upward", "turningXY");
-  ros::spin();
+  ros::waitForShutdown();
   return 0;
 }
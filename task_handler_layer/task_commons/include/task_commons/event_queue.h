@@ -0,0 +1,91 @@
+// Copyright 2016 AUV-IITK
+#ifndef TASK_COMMONS_EVENT_QUEUE_H
+#define TASK_COMMONS_EVENT_QUEUE_H
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <hardware_commons/queue_policy.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+/*! \file
+* \brief Events handed from the callbacks of a task server to the thread running its state machine
+*
+* Subscribers, the done callbacks of the motion clients and the preempt callback post; the executor blocks in wait()
+* and wakes up as soon as something arrives, there is no polling rate between a result and the transition it causes.
+*
+* An event posted while one with the same id still waits replaces it, keeping its place in the line, so a detector
+* that reports a sighting every frame while the machine is busy leaves one event behind and not a backlog: the queue
+* never holds more events than the task has ids. Its counts are on /diagnostics with the subscriber queues of the
+* node (hardware_commons/queue_policy.h) as a LATEST queue, replaced and cleared events count as dropped.
+*/
+namespace task_commons
+{
+struct Event
+{
+  int id;        // one of the events the task declares
+  double value;  // motion result, detector reading or whatever the event carries
+
+  Event() : id(0), value(0)
+  {
+  }
+  Event(int id, double value) : id(id), value(value)
+  {
+  }
+};
+
+class EventQueue
+{
+public:
+  // name is what /diagnostics calls the queue
+  explicit EventQueue(const std::string &name);
+
+  void post(int id, double value = 0);
+  // the event becomes visible to wait() after the given time, for timeouts and settling delays
+  void postAfter(double seconds, int id, double value = 0);
+  // oldest event, false if none arrived within timeout seconds
+  bool wait(Event *event, double timeout);
+  // drops pending and delayed events, called before a new goal starts
+  void clear();
+
+private:
+  struct Delayed
+  {
+    boost::system_time due;
+    Event event;
+  };
+
+  // with mutex_ held
+  void push(const Event &event);
+
+  boost::mutex mutex_;
+  boost::condition_variable changed_;
+  std::deque<Event> ready_;
+  std::vector<Delayed> delayed_;
+  hardware_commons::QueueCounters *counters_;
+};
+
+// done callback for SimpleActionClient::sendGoal, posts the event with the Result of the motion goal (0 when the goal
+// ended without one). actionlib calls it on the spinner thread delivering the result, nobody waits in waitForResult()
+class ResultEvent
+{
+public:
+  ResultEvent(EventQueue *events, int id) : events_(events), id_(id)
+  {
+  }
+
+  template <class State, class ResultConstPtr>
+  void operator()(const State &, const ResultConstPtr &result) const
+  {
+    events_->post(id_, result && result->Result);
+  }
+
+private:
+  EventQueue *events_;
+  int id_;
+};
+}  // namespace task_commons
+
+#endif  // TASK_COMMONS_EVENT_QUEUE_H
@@ -0,0 +1,99 @@
+// Copyright 2016 AUV-IITK
+#ifndef TASK_COMMONS_STATE_MACHINE_H
+#define TASK_COMMONS_STATE_MACHINE_H
+
+#include <task_commons/event_queue.h>
+#include <boost/function.hpp>
+#include <string>
+#include <vector>
+
+/*! \file
+* \brief Hierarchical state machine the task servers are declared with
+*
+* A task is a tree of states. Entering a state runs its entry action and then enters its initial child, so the active
+* configuration is always a leaf together with its ancestors. Events are offered to the leaf first and then to each
+* ancestor; the first transition of that state whose event matches and whose guard passes is taken. A transition
+* leaves every state up to the nearest ancestor holding both ends (exit actions, innermost first), runs its effect and
+* enters down to the target (entry actions, outermost first). A transition without a target only runs its effect.
+*
+* Actions run on the thread calling dispatch(), one event at a time. They must not dispatch themselves, anything they
+* want to happen next is posted to the queue and handled after the current transition completed.
+*/
+namespace task_commons
+{
+// true for the event a motion client posts when its goal finished with Result set
+inline bool succeeded(const Event &event)
+{
+  return event.value != 0;
+}
+
+class StateMachine
+{
+public:
+  typedef boost::function<void()> Action;
+  typedef boost::function<void(const Event &)> Effect;
+  typedef boost::function<bool(const Event &)> Guard;
+
+  static const int none = -1;
+
+  explicit StateMachine(const std::string &name);
+
+  // the first child added to a state is its initial one unless setInitial() says otherwise
+  int addState(const std::string &name, int parent = none);
+  void setInitial(int parent, int child);
+  // run() returns once a final state is entered
+  void setFinal(int state);
+  void onEntry(int state, const Action &action);
+  void onExit(int state, const Action &action);
+  // transitions of one state are tried in the order they were added
+  void addTransition(int from, int event, int to, const Guard &guard = Guard(), const Effect &effect = Effect());
+  void addReaction(int state, int event, const Effect &effect, const Guard &guard = Guard());
+
+  // drops whatever was active without running exit actions and enters state
+  void start(int state);
+  // false if no active state had a transition for the event
+  bool dispatch(const Event &event);
+  // start(), then dispatches the events of the queue until a final state is reached or ROS shuts down
+  bool run(int state, EventQueue *events);
+
+  bool finished() const;
+  bool isIn(int state) const;
+  int current() const
+  {
+    return active_;
+  }
+  const std::string &stateName(int state) const;
+
+private:
+  struct State
+  {
+    std::string name;
+    int parent;
+    int initial;
+    bool final;
+    Action entry;
+    Action exit;
+  };
+
+  struct Transition
+  {
+    int from;
+    int event;
+    int to;
+    Guard guard;
+    Effect effect;
+  };
+
+  // state is top or one of its descendants
+  bool contains(int top, int state) const;
+  void fire(int source, const Transition &transition, const Event &event);
+  void enter(int state);
+
+  std::string name_;
+  std::vector<State> states_;
+  std::vector<Transition> transitions_;
+  int active_;
+};
+}  // namespace task_commons
+
+#endif  // TASK_COMMONS_STATE_MACHINE_H
@@ -0,0 +1,207 @@
+// Copyright 2016 AUV-IITK
+#ifndef TASK_COMMONS_VISION_SCHEDULER_H
+#define TASK_COMMONS_VISION_SCHEDULER_H
+
+#include <task_commons/work_stealing_pool.h>
+#include <ros/ros.h>
+#include <image_transport/image_transport.h>
+#include <cv_bridge/cv_bridge.h>
+#include <sensor_msgs/Image.h>
+#include <std_msgs/Bool.h>
+#include <hardware_camera/ImagePair.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/*! \file
+* \brief Runs the detector pipelines of the tasks, only the ones a task server switched on
+*
+* The task servers keep starting and stopping detectors through the <detector>_switch topics (false starts, true
+* stops). A camera is subscribed while at least one pipeline on it is active and dropped again as soon as the last one
+* stops, an idle pipeline costs nothing, not even the conversion of the frame. Every frame is converted once and handed
+* to the active pipelines of its camera as separate tasks of a work stealing pool, so the pipelines of one task spread
+* over the cores. A pipeline gets one frame at a time; frames arriving while it is still busy replace each other and
+* only the newest is processed next.
+*
+* With ~pair_topic set, the frames of cameras that both have active pipelines come from the pairs camera_pub makes of
+* the front and the bottom camera: the two frames of a pair go to the pipelines of the cameras they were published for,
+* so a task watching both views (gate, then the line behind it) sees them as they were at one moment. The pair stream
+* is only subscribed while pipelines on two cameras are active, with one camera idle its own topic is cheaper. Which
+* cameras the pairs carry is learned from the pairs; the others, and all of them once no pair came for ~pair_timeout
+* seconds (a stalled or unplugged camera, 1 by default), are read from their image topics until pairs arrive again.
+*
+* The debug windows are drawn by the thread in spin(), highgui is not thread safe and the pipelines run on the pool.
+*
+* Pipelines run inside a span of the frame's trace (hardware_commons/trace.h). What they publish through
+* hardware_commons::trace::publish() or write to the sensor board carries the id of the frame it came from.
+*/
+namespace task_commons
+{
+// latest image of every debug window, filled by the pipelines and drawn by VisionScheduler::spin()
+class Display
+{
+public:
+  struct Trackbar
+  {
+    std::string window;
+    std::string name;
+    int *value;
+    int max;
+  };
+
+  explicit Display(bool enabled);
+
+  bool enabled() const
+  {
+    return enabled_;
+  }
+  // any thread, the image is copied
+  void show(const std::string &window, const cv::Mat &image);
+  // any thread, the trackbar is created with the next refresh(); value is written by the drawing thread
+  void trackbar(const std::string &window, const std::string &name, int *value, int max);
+  // drawing thread only, false once ESC was pressed in one of the windows
+  bool refresh();
+
+private:
+  void open(const std::string &window);
+
+  bool enabled_;
+  boost::mutex mutex_;
+  std::map<std::string, cv::Mat> images_;
+  std::vector<Trackbar> trackbars_;
+  std::set<std::string> windows_;  // drawing thread only
+};
+
+class Pipeline
+{
+public:
+  // camera is the image topic, switchTopic the Bool the task servers start and stop the detector with
+  Pipeline(const std::string &name, const std::string &camera, const std::string &switchTopic);
+  virtual ~Pipeline();
+
+  const std::string &name() const
+  {
+    return name_;
+  }
+  const std::string &camera() const
+  {
+    return camera_;
+  }
+  const std::string &switchTopic() const
+  {
+    return switchTopic_;
+  }
+
+  // the individual filter windows and calibration trackbars, to be set before the pipeline is handed to a scheduler
+  void showFilters(bool show)
+  {
+    filters_ = show;
+  }
+  // writes every frame the pipeline gets to <video>.avi
+  void record(const std::string &video);
+
+  // one frame, never called concurrently for the same pipeline; the frame is shared with the other pipelines
+  void run(const cv::Mat &frame);
+
+protected:
+  virtual void process(const cv::Mat &frame) = 0;
+
+  bool filters() const
+  {
+    return filters_;
+  }
+  // window names are prefixed with the pipeline name, several pipelines share one process
+  void show(const std::string &window, const cv::Mat &image);
+  // only created while the filters are shown
+  void trackbar(const std::string &window, const std::string &name, int *value, int max);
+
+private:
+  friend class VisionScheduler;
+  void attach(Display *display);
+
+  std::string name_;
+  std::string camera_;
+  std::string switchTopic_;
+  bool filters_;
+  cv::VideoWriter video_;
+  Display *display_;
+  std::vector<Display::Trackbar> trackbars_;  // requested before a display was attached
+
+  Pipeline(const Pipeline &);
+  Pipeline &operator=(const Pipeline &);
+};
+
+class VisionScheduler
+{
+public:
+  // ~threads (one per core), ~rate (the most frames per second a pipeline gets, 10), ~display (true), ~pair_topic
+  // (none) and ~pair_timeout (1 s) are read from the private namespace of the node
+  explicit VisionScheduler(const ros::NodeHandle &nh);
+  ~VisionScheduler();
+
+  // the pipeline stays idle until its switch topic starts it, unless active is set
+  void add(const boost::shared_ptr<Pipeline> &pipeline, bool active = false);
+  void activate(const std::string &name, bool active);
+  // handles the callbacks and draws the debug windows until ROS shuts down or ESC is pressed in a window
+  void spin();
+
+private:
+  struct Slot
+  {
+    boost::shared_ptr<Pipeline> pipeline;
+    const char *span;  // name of the pipeline in the trace
+    ros::Subscriber switchSub;
+    bool active;
+    bool busy;                        // a task of the pool owns the pipeline
+    cv_bridge::CvImageConstPtr next;  // newest frame that arrived while busy
+    ros::Time last;                   // when the pipeline was last handed a frame
+  };
+
+  struct Camera
+  {
+    std::string topic;
+    image_transport::Subscriber sub;
+    bool subscribed;  // to its own topic, while it has active pipelines and its frames do not come in pairs
+    int active;       // active pipelines on this camera
+    std::vector<Slot *> slots;
+  };
+
+  void switchCB(Slot *slot, const std_msgs::BoolConstPtr &msg);
+  void imageCB(Camera *camera, const sensor_msgs::ImageConstPtr &msg);
+  void pairCB(const hardware_camera::ImagePairConstPtr &msg);
+  void pairTimeoutCB(const ros::TimerEvent &event);
+  // pair stream and image topics for the pipelines active now, with mutex_ held
+  void subscribe(const ros::Time &now);
+  // hands the frame to the active pipelines of the camera, with mutex_ held
+  void dispatch(Camera *camera, const sensor_msgs::ImageConstPtr &msg, const ros::Time &now);
+  void setActive(Slot *slot, bool active);
+  void runSlot(Slot *slot, cv_bridge::CvImageConstPtr image);
+
+  ros::NodeHandle nh_;
+  image_transport::ImageTransport it_;
+  Display display_;
+  ros::Duration period_;
+
+  boost::mutex mutex_;  // guards the slots and cameras, taken by the callbacks and the pool
+  std::vector<boost::shared_ptr<Slot> > slots_;
+  std::map<std::string, boost::shared_ptr<Camera> > cameras_;
+  std::string pairTopic_;
+  ros::Duration pairTimeout_;
+  ros::Timer pairTimer_;
+  ros::Subscriber pairSub_;
+  bool pairSubscribed_;
+  bool pairStalled_;               // no pair for pairTimeout_, the pair cameras are read from their topics meanwhile
+  ros::Time lastPair_;             // when the newest pair arrived, or the stream was subscribed
+  std::set<std::string> paired_;  // image topics the pairs carry, as far as seen
+
+  // declared last, joined before the slots it works on go away
+  WorkStealingPool pool_;
+};
+}  // namespace task_commons
+
+#endif  // TASK_COMMONS_VISION_SCHEDULER_H
@@ -0,0 +1,68 @@
+// Copyright 2016 AUV-IITK
+#ifndef TASK_COMMONS_WORK_STEALING_POOL_H
+#define TASK_COMMONS_WORK_STEALING_POOL_H
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
+#include <vector>
+
+/*! \file
+* \brief Fixed set of worker threads the vision pipelines run on
+*
+* Every worker owns a deque. A task submitted by a worker goes to the back of its own deque and is picked up from
+* there again, the frame it just touched is still in that core's cache; tasks from other threads are dealt round robin.
+* A worker whose deque ran dry steals from the front of the others before it goes to sleep, so one slow pipeline never
+* keeps the frames of the others waiting while a core is idle.
+*/
+namespace task_commons
+{
+class WorkStealingPool
+{
+public:
+  typedef boost::function<void()> Task;
+
+  // 0 starts one worker per core
+  explicit WorkStealingPool(int threads = 0);
+  // runs the tasks still queued, then joins the workers
+  ~WorkStealingPool();
+
+  // tasks must not throw
+  void submit(const Task &task);
+  int size() const
+  {
+    return workers_.size();
+  }
+
+private:
+  struct Worker
+  {
+    boost::thread::id thread;
+    boost::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void work(int index);
+  // the back of the own deque, otherwise the front of the next one that has something
+  bool take(int index, Task *task);
+  // index of the calling worker, -1 for any other thread
+  int self() const;
+
+  std::vector<boost::shared_ptr<Worker> > workers_;
+  boost::thread_group threads_;
+
+  boost::mutex mutex_;  // guards the counters below and the sleep of idle workers
+  boost::condition_variable wake_;
+  int pending_;  // queued tasks no worker has claimed yet
+  int next_;
+  bool stopping_;
+
+  WorkStealingPool(const WorkStealingPool &);
+  WorkStealingPool &operator=(const WorkStealingPool &);
+};
+}  // namespace task_commons
+
+#endif  // TASK_COMMONS_WORK_STEALING_POOL_H
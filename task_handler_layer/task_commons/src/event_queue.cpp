@@ -0,0 +1,88 @@
+// Copyright 2016 AUV-IITK
+#include <task_commons/event_queue.h>
+
+namespace task_commons
+{
+EventQueue::EventQueue(const std::string &name)
+  : counters_(hardware_commons::queueCounters(name, hardware_commons::LATEST))
+{
+}
+
+void EventQueue::push(const Event &event)
+{
+  counters_->received();
+  for (size_t i = 0; i < ready_.size(); i++)
+    if (ready_[i].id == event.id)
+    {
+      ready_[i].value = event.value;
+      counters_->dropped();
+      return;
+    }
+  ready_.push_back(event);
+}
+
+void EventQueue::post(int id, double value)
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    push(Event(id, value));
+  }
+  changed_.notify_all();
+}
+
+void EventQueue::postAfter(double seconds, int id, double value)
+{
+  Delayed delayed;
+  delayed.due = boost::get_system_time() + boost::posix_time::microseconds(static_cast<int64_t>(seconds * 1e6));
+  delayed.event = Event(id, value);
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    delayed_.push_back(delayed);
+  }
+  changed_.notify_all();
+}
+
+bool EventQueue::wait(Event *event, double timeout)
+{
+  boost::system_time deadline =
+      boost::get_system_time() + boost::posix_time::microseconds(static_cast<int64_t>(timeout * 1e6));
+  boost::mutex::scoped_lock lock(mutex_);
+  while (true)
+  {
+    boost::system_time now = boost::get_system_time();
+    // delayed events that are due queue up behind the ones already waiting, in the order they were posted
+    boost::system_time wake = deadline;
+    for (size_t i = 0; i < delayed_.size();)
+    {
+      if (delayed_[i].due <= now)
+      {
+        push(delayed_[i].event);
+        delayed_.erase(delayed_.begin() + i);
+        continue;
+      }
+      if (delayed_[i].due < wake)
+        wake = delayed_[i].due;
+      i++;
+    }
+    if (!ready_.empty())
+    {
+      *event = ready_.front();
+      ready_.pop_front();
+      counters_->handled();
+      return true;
+    }
+    if (now >= deadline)
+      return false;
+    changed_.timed_wait(lock, wake);
+  }
+}
+
+void EventQueue::clear()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  for (size_t i = 0; i < ready_.size(); i++)
+    counters_->dropped();
+  ready_.clear();
+  delayed_.clear();
+}
+}  // namespace task_commons
@@ -0,0 +1,193 @@
+// Copyright 2016 AUV-IITK
+#include <task_commons/state_machine.h>
+#include <ros/ros.h>
+#include <string>
+#include <vector>
+
+namespace task_commons
+{
+const int StateMachine::none;
+
+StateMachine::StateMachine(const std::string &name) : name_(name), active_(none)
+{
+}
+
+int StateMachine::addState(const std::string &name, int parent)
+{
+  State state;
+  state.name = name;
+  state.parent = parent;
+  state.initial = none;
+  state.final = false;
+  states_.push_back(state);
+  int id = states_.size() - 1;
+  if (parent != none && states_[parent].initial == none)
+    states_[parent].initial = id;
+  return id;
+}
+
+void StateMachine::setInitial(int parent, int child)
+{
+  states_[parent].initial = child;
+}
+
+void StateMachine::setFinal(int state)
+{
+  states_[state].final = true;
+}
+
+void StateMachine::onEntry(int state, const Action &action)
+{
+  states_[state].entry = action;
+}
+
+void StateMachine::onExit(int state, const Action &action)
+{
+  states_[state].exit = action;
+}
+
+void StateMachine::addTransition(int from, int event, int to, const Guard &guard, const Effect &effect)
+{
+  Transition transition;
+  transition.from = from;
+  transition.event = event;
+  transition.to = to;
+  transition.guard = guard;
+  transition.effect = effect;
+  transitions_.push_back(transition);
+}
+
+void StateMachine::addReaction(int state, int event, const Effect &effect, const Guard &guard)
+{
+  addTransition(state, event, none, guard, effect);
+}
+
+void StateMachine::start(int state)
+{
+  active_ = none;
+  std::vector<int> path;
+  for (int s = state; s != none; s = states_[s].parent)
+    path.push_back(s);
+  for (int i = path.size() - 1; i > 0; i--)
+  {
+    active_ = path[i];
+    if (states_[active_].entry)
+      states_[active_].entry();
+  }
+  enter(state);
+  ROS_INFO("%s: started in %s", name_.c_str(), stateName(active_).c_str());
+}
+
+bool StateMachine::dispatch(const Event &event)
+{
+  for (int source = active_; source != none; source = states_[source].parent)
+    for (size_t i = 0; i < transitions_.size(); i++)
+    {
+      const Transition &transition = transitions_[i];
+      if (transition.from != source || transition.event != event.id || (transition.guard && !transition.guard(event)))
+        continue;
+      if (transition.to == none)
+      {
+        if (transition.effect)
+          transition.effect(event);
+      }
+      else
+      {
+        fire(source, transition, event);
+      }
+      return true;
+    }
+  return false;
+}
+
+bool StateMachine::run(int state, EventQueue *events)
+{
+  start(state);
+  Event event;
+  // the timeout only bounds how long a shutdown goes unnoticed, transitions happen as the events arrive
+  while (!finished() && ros::ok())
+    if (events->wait(&event, 0.1))
+      dispatch(event);
+  return finished();
+}
+
+bool StateMachine::finished() const
+{
+  return active_ != none && states_[active_].final;
+}
+
+bool StateMachine::isIn(int state) const
+{
+  for (int s = active_; s != none; s = states_[s].parent)
+    if (s == state)
+      return true;
+  return false;
+}
+
+const std::string &StateMachine::stateName(int state) const
+{
+  static const std::string noState = "none";
+  return state >= 0 && state < static_cast<int>(states_.size()) ? states_[state].name : noState;
+}
+
+bool StateMachine::contains(int top, int state) const
+{
+  for (int s = state; s != none; s = states_[s].parent)
+    if (s == top)
+      return true;
+  return false;
+}
+
+void StateMachine::fire(int source, const Transition &transition, const Event &event)
+{
+  int from = active_;
+  // the source itself is always left, a transition to itself restarts it; a target that already holds the source is
+  // kept and only restarted from its initial child
+  int common = states_[source].parent;
+  while (common != none && !contains(common, transition.to))
+    common = states_[common].parent;
+
+  while (active_ != common)
+  {
+    int leaving = active_;
+    active_ = states_[leaving].parent;
+    if (states_[leaving].exit)
+      states_[leaving].exit();
+  }
+
+  if (transition.effect)
+    transition.effect(event);
+
+  std::vector<int> path;
+  for (int s = transition.to; s != common; s = states_[s].parent)
+    path.push_back(s);
+  if (path.empty())
+  {
+    // the target is the common ancestor, everything below it was left
+    if (states_[transition.to].initial != none)
+      enter(states_[transition.to].initial);
+  }
+  else
+  {
+    for (int i = path.size() - 1; i > 0; i--)
+    {
+      active_ = path[i];
+      if (states_[active_].entry)
+        states_[active_].entry();
+    }
+    enter(transition.to);
+  }
+  ROS_INFO("%s: %s -> %s", name_.c_str(), stateName(from).c_str(), stateName(active_).c_str());
+}
+
+// runs the entry action of state and then drills down through the initial children
+void StateMachine::enter(int state)
+{
+  for (int s = state; s != none; s = states_[s].initial)
+  {
+    active_ = s;
+    if (states_[s].entry)
+      states_[s].entry();
+  }
+}
+}  // namespace task_commons
@@ -0,0 +1,363 @@
+// Copyright 2016 AUV-IITK
+#include <task_commons/vision_scheduler.h>
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/trace.h>
+#include <boost/bind.hpp>
+#include <exception>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace task_commons
+{
+Display::Display(bool enabled) : enabled_(enabled)
+{
+}
+
+void Display::show(const std::string &window, const cv::Mat &image)
+{
+  if (!enabled_)
+    return;
+  boost::mutex::scoped_lock lock(mutex_);
+  image.copyTo(images_[window]);
+}
+
+void Display::trackbar(const std::string &window, const std::string &name, int *value, int max)
+{
+  if (!enabled_)
+    return;
+  Trackbar trackbar = { window, name, value, max };
+  boost::mutex::scoped_lock lock(mutex_);
+  trackbars_.push_back(trackbar);
+}
+
+bool Display::refresh()
+{
+  if (!enabled_)
+    return true;
+  std::map<std::string, cv::Mat> images;
+  std::vector<Trackbar> trackbars;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    images.swap(images_);
+    trackbars.swap(trackbars_);
+  }
+  for (size_t i = 0; i < trackbars.size(); i++)
+  {
+    open(trackbars[i].window);
+    cv::createTrackbar(trackbars[i].name, trackbars[i].window, trackbars[i].value, trackbars[i].max);
+  }
+  for (std::map<std::string, cv::Mat>::iterator it = images.begin(); it != images.end(); ++it)
+  {
+    open(it->first);
+    cv::imshow(it->first, it->second);
+  }
+  // If ESC key pressed, Key=0x10001B under OpenCV 0.9.7(linux version),
+  // remove higher bits using AND operator
+  return (cv::waitKey(1) & 255) != 27;
+}
+
+void Display::open(const std::string &window)
+{
+  if (windows_.insert(window).second)
+    cv::namedWindow(window, cv::WINDOW_NORMAL);
+}
+
+Pipeline::Pipeline(const std::string &name, const std::string &camera, const std::string &switchTopic)
+  : name_(name), camera_(camera), switchTopic_(switchTopic), filters_(false), display_(0)
+{
+}
+
+Pipeline::~Pipeline()
+{
+}
+
+void Pipeline::record(const std::string &video)
+{
+  video_.open(video + ".avi", CV_FOURCC('D', 'I', 'V', 'X'), 9, cv::Size(640, 480));
+}
+
+void Pipeline::run(const cv::Mat &frame)
+{
+  if (video_.isOpened())
+    video_.write(frame);
+  process(frame);
+}
+
+void Pipeline::show(const std::string &window, const cv::Mat &image)
+{
+  if (display_)
+    display_->show(name_ + " " + window, image);
+}
+
+void Pipeline::trackbar(const std::string &window, const std::string &name, int *value, int max)
+{
+  Display::Trackbar trackbar = { name_ + " " + window, name, value, max };
+  if (!display_)
+    trackbars_.push_back(trackbar);
+  else if (filters_)
+    display_->trackbar(trackbar.window, trackbar.name, trackbar.value, trackbar.max);
+}
+
+void Pipeline::attach(Display *display)
+{
+  display_ = display;
+  for (size_t i = 0; filters_ && i < trackbars_.size(); i++)
+    display_->trackbar(trackbars_[i].window, trackbars_[i].name, trackbars_[i].value, trackbars_[i].max);
+  trackbars_.clear();
+}
+
+VisionScheduler::VisionScheduler(const ros::NodeHandle &nh)
+  : nh_(nh)
+  , it_(nh_)
+  , display_(ros::NodeHandle("~").param("display", true))
+  , pairSubscribed_(false)
+  , pairStalled_(false)
+  , pool_(ros::NodeHandle("~").param("threads", 0))
+{
+  double rate = 10, pairTimeout = 1;
+  ros::NodeHandle("~").getParam("rate", rate);
+  ros::NodeHandle("~").getParam("pair_topic", pairTopic_);
+  ros::NodeHandle("~").getParam("pair_timeout", pairTimeout);
+  period_ = ros::Duration(rate > 0 ? 1 / rate : 0);
+  pairTimeout_ = ros::Duration(pairTimeout);
+  ROS_INFO("vision scheduler: %d threads, at most %.1f frames/s per pipeline", pool_.size(), rate);
+  if (!pairTopic_.empty())
+  {
+    pairTimer_ = nh_.createTimer(ros::Duration(pairTimeout / 2), &VisionScheduler::pairTimeoutCB, this);
+    ROS_INFO("vision scheduler: frames of two active cameras from the pairs on %s", pairTopic_.c_str());
+  }
+}
+
+VisionScheduler::~VisionScheduler()
+{
+  // no new frames or switches; the pool finishes what it has before the slots are destroyed
+  boost::mutex::scoped_lock lock(mutex_);
+  for (std::map<std::string, boost::shared_ptr<Camera> >::iterator it = cameras_.begin(); it != cameras_.end(); ++it)
+    it->second->sub.shutdown();
+  pairTimer_.stop();
+  pairSub_.shutdown();
+  for (size_t i = 0; i < slots_.size(); i++)
+  {
+    slots_[i]->switchSub.shutdown();
+    slots_[i]->active = false;
+  }
+}
+
+void VisionScheduler::add(const boost::shared_ptr<Pipeline> &pipeline, bool active)
+{
+  boost::shared_ptr<Slot> slot(new Slot);
+  slot->pipeline = pipeline;
+  slot->span = hardware_commons::trace::intern(pipeline->name());
+  slot->active = false;
+  slot->busy = false;
+  pipeline->attach(&display_);
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    boost::shared_ptr<Camera> &camera = cameras_[pipeline->camera()];
+    if (!camera)
+    {
+      camera.reset(new Camera);
+      camera->topic = pipeline->camera();
+      camera->subscribed = false;
+      camera->active = 0;
+    }
+    camera->slots.push_back(slot.get());
+    slots_.push_back(slot);
+  }
+  slot->switchSub =
+      hardware_commons::subscribe<std_msgs::Bool>(nh_, pipeline->switchTopic(), hardware_commons::EVENTS,
+                                                  boost::bind(&VisionScheduler::switchCB, this, slot.get(), _1));
+  if (active)
+    setActive(slot.get(), true);
+}
+
+void VisionScheduler::activate(const std::string &name, bool active)
+{
+  Slot *slot = 0;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    for (size_t i = 0; i < slots_.size() && !slot; i++)
+      if (slots_[i]->pipeline->name() == name)
+        slot = slots_[i].get();
+  }
+  if (slot)
+    setActive(slot, active);
+  else
+    ROS_ERROR("vision scheduler: no pipeline %s", name.c_str());
+}
+
+void VisionScheduler::spin()
+{
+  // the callbacks only hand frames to the pool, which leaves this thread to draw the windows
+  ros::Rate rate(50);
+  while (ros::ok())
+  {
+    ros::spinOnce();
+    if (!display_.refresh())
+      break;
+    rate.sleep();
+  }
+}
+
+void VisionScheduler::switchCB(Slot *slot, const std_msgs::BoolConstPtr &msg)
+{
+  // the task servers publish false to start a detector and true to stop it
+  setActive(slot, !msg->data);
+}
+
+void VisionScheduler::setActive(Slot *slot, bool active)
+{
+  ros::Time now = ros::Time::now();
+  boost::mutex::scoped_lock lock(mutex_);
+  if (slot->active == active)
+    return;
+  slot->active = active;
+  if (!active)
+    slot->next.reset();
+
+  Camera &camera = *cameras_[slot->pipeline->camera()];
+  camera.active += active ? 1 : -1;
+  subscribe(now);
+  ROS_INFO("%s %s, %d active on %s", slot->pipeline->name().c_str(), active ? "started" : "stopped", camera.active,
+           camera.topic.c_str());
+}
+
+void VisionScheduler::subscribe(const ros::Time &now)
+{
+  // pairs while two cameras they may carry have active pipelines
+  int cameras = 0;
+  for (std::map<std::string, boost::shared_ptr<Camera> >::iterator it = cameras_.begin(); it != cameras_.end(); ++it)
+    if (it->second->active > 0 && (paired_.empty() || paired_.count(it->first)))
+      cameras++;
+  bool pairs = !pairTopic_.empty() && cameras >= 2;
+  if (pairs && !pairSubscribed_)
+  {
+    pairSub_ = hardware_commons::subscribe<hardware_camera::ImagePair>(
+        nh_, pairTopic_, hardware_commons::LATEST, boost::bind(&VisionScheduler::pairCB, this, _1));
+    pairSubscribed_ = true;
+    pairStalled_ = false;
+    lastPair_ = now;
+  }
+  else if (!pairs && pairSubscribed_)
+  {
+    pairSub_.shutdown();
+    pairSubscribed_ = false;
+  }
+
+  for (std::map<std::string, boost::shared_ptr<Camera> >::iterator it = cameras_.begin(); it != cameras_.end(); ++it)
+  {
+    Camera &camera = *it->second;
+    bool own = camera.active > 0 && !(pairSubscribed_ && !pairStalled_ && paired_.count(camera.topic));
+    if (own && !camera.subscribed)
+      camera.sub = it_.subscribe(camera.topic, 1, boost::bind(&VisionScheduler::imageCB, this, &camera, _1));
+    else if (!own && camera.subscribed)
+      camera.sub.shutdown();
+    camera.subscribed = own;
+  }
+}
+
+void VisionScheduler::imageCB(Camera *camera, const sensor_msgs::ImageConstPtr &msg)
+{
+  ros::Time now = ros::Time::now();
+  boost::mutex::scoped_lock lock(mutex_);
+  dispatch(camera, msg, now);
+}
+
+void VisionScheduler::pairCB(const hardware_camera::ImagePairConstPtr &msg)
+{
+  ros::Time now = ros::Time::now();
+  boost::mutex::scoped_lock lock(mutex_);
+  lastPair_ = now;
+  bool changed = pairStalled_;
+  if (pairStalled_)
+    ROS_INFO("vision scheduler: pairs on %s again", pairTopic_.c_str());
+  pairStalled_ = false;
+  for (size_t i = 0; i < msg->topics.size(); i++)
+    changed = paired_.insert(msg->topics[i]).second || changed;
+  if (changed)
+    subscribe(now);
+  for (size_t i = 0; pairSubscribed_ && i < msg->images.size() && i < msg->topics.size(); i++)
+  {
+    std::map<std::string, boost::shared_ptr<Camera> >::iterator camera = cameras_.find(msg->topics[i]);
+    if (camera == cameras_.end() || !camera->second->active || camera->second->subscribed)
+      continue;
+    // shares the pair, the pipelines read the frame where it is
+    dispatch(camera->second.get(), sensor_msgs::ImageConstPtr(msg, &msg->images[i]), now);
+  }
+}
+
+void VisionScheduler::pairTimeoutCB(const ros::TimerEvent &event)
+{
+  ros::Time now = ros::Time::now();
+  boost::mutex::scoped_lock lock(mutex_);
+  if (!pairSubscribed_ || pairStalled_ || now - lastPair_ < pairTimeout_)
+    return;
+  // one camera stalled or unplugged, the other one must not starve with it
+  ROS_WARN("vision scheduler: no pair on %s for %.1f s, reading the cameras from their topics", pairTopic_.c_str(),
+           (now - lastPair_).toSec());
+  pairStalled_ = true;
+  subscribe(now);
+}
+
+void VisionScheduler::dispatch(Camera *camera, const sensor_msgs::ImageConstPtr &msg, const ros::Time &now)
+{
+  cv_bridge::CvImageConstPtr image;
+  for (size_t i = 0; i < camera->slots.size(); i++)
+  {
+    Slot *slot = camera->slots[i];
+    if (!slot->active || now - slot->last < period_)
+      continue;
+    if (!image)
+    {
+      // converted once for all pipelines of the camera, they only read it
+      try
+      {
+        hardware_commons::trace::Span span("convert", msg->header.stamp.toNSec());
+        image = cv_bridge::toCvShare(msg, "bgr8");
+      }
+      catch (cv_bridge::Exception &e)
+      {
+        ROS_ERROR("Could not convert from '%s' to 'bgr8'.", msg->encoding.c_str());
+        return;
+      }
+    }
+    slot->last = now;
+    if (slot->busy)
+    {
+      slot->next = image;
+      continue;
+    }
+    slot->busy = true;
+    pool_.submit(boost::bind(&VisionScheduler::runSlot, this, slot, image));
+  }
+}
+
+void VisionScheduler::runSlot(Slot *slot, cv_bridge::CvImageConstPtr image)
+{
+  try
+  {
+    hardware_commons::trace::Span span(slot->span, image->header.stamp.toNSec());
+    slot->pipeline->run(image->image);
+  }
+  catch (const std::exception &e)
+  {
+    // one bad frame must neither take the worker down nor leave the pipeline marked busy
+    ROS_ERROR("%s: %s", slot->pipeline->name().c_str(), e.what());
+  }
+  image.reset();
+
+  boost::mutex::scoped_lock lock(mutex_);
+  if (slot->active && slot->next)
+  {
+    // submitted from the worker, so it stays on this core unless another one runs out of work first
+    pool_.submit(boost::bind(&VisionScheduler::runSlot, this, slot, slot->next));
+    slot->next.reset();
+  }
+  else
+  {
+    slot->busy = false;
+  }
+}
+}  // namespace task_commons
@@ -0,0 +1,108 @@
+// Copyright 2016 AUV-IITK
+#include <task_commons/work_stealing_pool.h>
+#include <boost/bind.hpp>
+
+namespace task_commons
+{
+WorkStealingPool::WorkStealingPool(int threads) : pending_(0), next_(0), stopping_(false)
+{
+  if (threads <= 0)
+    threads = boost::thread::hardware_concurrency();
+  if (threads <= 0)
+    threads = 1;
+  for (int i = 0; i < threads; i++)
+    workers_.push_back(boost::shared_ptr<Worker>(new Worker));
+  // a worker only looks up thread ids from inside a task, and no task can be submitted before this returns
+  for (int i = 0; i < threads; i++)
+    workers_[i]->thread = threads_.create_thread(boost::bind(&WorkStealingPool::work, this, i))->get_id();
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  threads_.join_all();
+}
+
+void WorkStealingPool::submit(const Task &task)
+{
+  int index = self();
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (index < 0)
+    {
+      index = next_;
+      next_ = (next_ + 1) % workers_.size();
+    }
+  }
+  {
+    boost::mutex::scoped_lock lock(workers_[index]->mutex);
+    workers_[index]->tasks.push_back(task);
+  }
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    pending_++;
+  }
+  // whoever wakes up first takes it, from its own deque or by stealing
+  wake_.notify_one();
+}
+
+void WorkStealingPool::work(int index)
+{
+  Task task;
+  while (true)
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while (pending_ == 0 && !stopping_)
+        wake_.wait(lock);
+      if (pending_ == 0)
+        return;
+      // claims one of the queued tasks, every claim has a task sitting in one of the deques
+      pending_--;
+    }
+    while (!take(index, &task))
+      boost::this_thread::yield();
+    task();
+    task.clear();
+  }
+}
+
+bool WorkStealingPool::take(int index, Task *task)
+{
+  {
+    Worker &own = *workers_[index];
+    boost::mutex::scoped_lock lock(own.mutex);
+    if (!own.tasks.empty())
+    {
+      *task = own.tasks.back();
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  for (size_t i = 1; i < workers_.size(); i++)
+  {
+    Worker &victim = *workers_[(index + i) % workers_.size()];
+    boost::mutex::scoped_lock lock(victim.mutex);
+    if (!victim.tasks.empty())
+    {
+      *task = victim.tasks.front();
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+int WorkStealingPool::self() const
+{
+  boost::thread::id id = boost::this_thread::get_id();
+  for (size_t i = 0; i < workers_.size(); i++)
+    if (workers_[i]->thread == id)
+      return i;
+  return -1;
+}
+}  // namespace task_commons
@@ -0,0 +1,41 @@
+// Copyright 2016 AUV-IITK
+#ifndef TASK_GATE_GATE_PIPELINE_H
+#define TASK_GATE_GATE_PIPELINE_H
+
+#include <task_commons/vision_scheduler.h>
+#include <dynamic_reconfigure/server.h>
+#include <task_gate/gateConfig.h>
+#include <hardware_commons/sensor_board.h>
+#include <opencv2/core/core.hpp>
+#include <ros/ros.h>
+
+/*! \file
+* \brief Finds the gate in the front camera
+*
+* Publishes the x and y offset of the centre of the gate from the centre of the screen on /varun/ip/gate, 0 0 while
+* nothing is seen. Nothing is published while the gate touches an edge of the frame.
+*/
+namespace task_gate
+{
+class GatePipeline : public task_commons::Pipeline
+{
+public:
+  explicit GatePipeline(const ros::NodeHandle &nh);
+
+protected:
+  void process(const cv::Mat &frame);
+
+private:
+  void callback(task_gate::gateConfig &config, uint32_t level);
+
+  ros::NodeHandle nh_;
+  ros::Publisher pub_;
+  // every detection also goes on the sensor board for the nodes on the vehicle
+  hardware_commons::SensorBoard sensorBoard_;
+  dynamic_reconfigure::Server<task_gate::gateConfig> server_;
+
+  int t1min_, t1max_, t2min_, t2max_, t3min_, t3max_;
+};
+}  // namespace task_gate
+
+#endif  // TASK_GATE_GATE_PIPELINE_H
@@ -6,6 +6,7 @@
 #include <task_commons/gateActionResult.h>
 #include <actionlib/client/simple_action_client.h>
 #include <actionlib/client/terminal_state.h>
+#include <hardware_commons/queue_policy.h>
 
 typedef actionlib::SimpleActionClient<task_commons::gateAction> Client;
 
@@ -14,11 +15,9 @@ task_commons::gateGoal goal;
 
 bool success = false;
 
-void spinThread()
+void doneCb(const actionlib::SimpleClientGoalState &state, const task_commons::gateResultConstPtr &result)
 {
-  Client &temp = *ptrClient;
-  temp.waitForResult();
-  success = (*(temp.getResult())).MotionCompleted;
+  success = result && result->MotionCompleted;
   if (success)
   {
     ROS_INFO("motion successful");
@@ -40,7 +39,8 @@ int main(int argc, char **argv)
 
   ros::NodeHandle nh;
   // here gate_server is the name of the node of the actionserver.
-  ros::Subscriber sub_ = nh.subscribe<task_commons::gateActionFeedback>("/gate_server/feedback", 1000, &forwardCb);
+  ros::Subscriber sub_ = hardware_commons::subscribe<task_commons::gateActionFeedback>(
+      nh, "/gate_server/feedback", hardware_commons::EVENTS, &forwardCb);
 
   Client testClient("gate_server");
   ptrClient = &testClient;
@@ -52,8 +52,7 @@ int main(int argc, char **argv)
 
   Client &can = *ptrClient;
   // send goal
-  can.sendGoal(goal);
-  boost::thread spin_thread(&spinThread);
+  can.sendGoal(goal, &doneCb);
   ros::spin();
   return 0;
 }
@@ -8,6 +8,7 @@
 #include <std_msgs/Float64MultiArray.h>
 #include <actionlib/server/simple_action_server.h>
 #include <actionlib/client/simple_action_client.h>
+#include <motion_commons/callback_group.h>
 #include <task_commons/gateAction.h>
 #include <motion_commons/ForwardAction.h>
 #include <motion_commons/TurnAction.h>
@@ -19,6 +20,8 @@
 #include <motion_commons/UpwardActionFeedback.h>
 #include <motion_commons/UpwardActionResult.h>
 #include <motion_commons/SidewardActionResult.h>
+#include <task_commons/state_machine.h>
+#include <hardware_commons/queue_policy.h>
 #include <string>
 
 typedef actionlib::SimpleActionServer<task_commons::gateAction> Server;
@@ -27,9 +30,22 @@ typedef actionlib::SimpleActionClient<motion_commons::SidewardAction> ClientSide
 typedef actionlib::SimpleActionClient<motion_commons::UpwardAction> ClientUpward;
 typedef actionlib::SimpleActionClient<motion_commons::TurnAction> ClientTurn;
 
+enum GateEvent
+{
+  PREEMPT,
+  SIDE_DONE,    // sideward goal finished, value is its Result
+  HEIGHT_DONE,  // upward goal finished
+  LINE_SEEN     // the line behind the gate is under the bot
+};
+
 class TaskGateInnerClass
 {
 private:
+  // detector data, results of the motion goals, and goals and preempts of this server each have their own threads;
+  // the state machine runs on the action server's thread and only waits for its event queue
+  motion_commons::CallbackGroup sensors_;
+  motion_commons::CallbackGroup control_;
+  motion_commons::CallbackGroup action_;
   ros::NodeHandle nh_;
   Server gate_server_;
   std::string action_name_;
@@ -39,13 +55,8 @@ private:
   task_commons::gateResult result_;
   ros::Subscriber sub_gate_;
   ros::Subscriber sub_line_;
-  ros::Subscriber yaw_sub_;
   ros::Publisher switch_gate_detection;
   ros::Publisher switch_line_detection;
-  ros::Publisher yaw_pub_;
-  ros::Publisher present_distance_;
-  ros::Publisher present_X_;
-  ros::Publisher present_Y_;
   ClientForward ForwardClient_;
   ClientSideward SidewardClient_;
   ClientUpward UpwardClient_;
@@ -54,31 +65,41 @@ private:
   motion_commons::SidewardGoal sidewardgoal;
   motion_commons::UpwardGoal upwardgoal;
   motion_commons::TurnGoal turngoal;
-  bool success_gate, heightCenter, sideCenter, isOrange, success_line;
+  task_commons::StateMachine machine_;
+  task_commons::EventQueue events_;
+  int centering_;
 
 public:
   TaskGateInnerClass(std::string name, std::string node, std::string node1, std::string node2, std::string node3)
-    : gate_server_(nh_, name, boost::bind(&TaskGateInnerClass::analysisCB, this, _1), false)
+    : sensors_("sensor")
+    , control_("control")
+    , action_("action")
+    , gate_server_(action_.nodeHandle(), name, boost::bind(&TaskGateInnerClass::analysisCB, this, _1), false)
     , action_name_(name)
-    , ForwardClient_(node)
-    , SidewardClient_(node1)
-    , UpwardClient_(node2)
-    , TurnClient_(node3)
+    , ForwardClient_(control_.nodeHandle(), node, false)
+    , SidewardClient_(control_.nodeHandle(), node1, false)
+    , UpwardClient_(control_.nodeHandle(), node2, false)
+    , TurnClient_(control_.nodeHandle(), node3, false)
+    , machine_(name)
+    , events_(name + "/events")
   {
     ROS_INFO("inside constructor");
+    declareStates();
     gate_server_.registerPreemptCallback(boost::bind(&TaskGateInnerClass::preemptCB, this));
 
-    switch_gate_detection = nh_.advertise<std_msgs::Bool>("gate_detection_switch", 1000);
-    switch_line_detection = nh_.advertise<std_msgs::Bool>("line_detection_switch", 1000);
-    present_X_ = nh_.advertise<std_msgs::Float64>("/varun/motion/y_distance", 1000);
-    present_Y_ = nh_.advertise<std_msgs::Float64>("/varun/motion/z_distance", 1000);
-    present_distance_ = nh_.advertise<std_msgs::Float64>("/varun/motion/x_distance", 1000);
-    yaw_pub_ = nh_.advertise<std_msgs::Float64>("/varun/motion/yaw", 1000);
-    sub_gate_ =
-        nh_.subscribe<std_msgs::Float64MultiArray>("/varun/ip/gate", 1000, &TaskGateInnerClass::gateNavigation, this);
-    yaw_sub_ = nh_.subscribe<std_msgs::Float64>("/varun/sensors/imu/yaw", 1000, &TaskGateInnerClass::yawCB, this);
-    sub_line_ =
-        nh_.subscribe<std_msgs::Bool>("lineDetection", 1000, &TaskGateInnerClass::lineDetectedListener, this);
+    switch_gate_detection =
+        hardware_commons::advertise<std_msgs::Bool>(nh_, "gate_detection_switch", hardware_commons::EVENTS);
+    switch_line_detection =
+        hardware_commons::advertise<std_msgs::Bool>(nh_, "line_detection_switch", hardware_commons::EVENTS);
+    sub_gate_ = hardware_commons::subscribe<std_msgs::Float64MultiArray>(sensors_.nodeHandle(), "/varun/ip/gate",
+                                                                         hardware_commons::LATEST,
+                                                                         &TaskGateInnerClass::gateNavigation, this);
+    sub_line_ = hardware_commons::subscribe<std_msgs::Bool>(sensors_.nodeHandle(), "lineDetection",
+                                                            hardware_commons::EVENTS,
+                                                            &TaskGateInnerClass::lineDetectedListener, this);
+    sensors_.start();
+    control_.start();
+    action_.start();
     gate_server_.start();
   }
 
@@ -86,74 +107,54 @@ public:
   {
   }
 
-  void yawCB(std_msgs::Float64 imu_data)
-  {
-    yaw_pub_.publish(imu_data);
-  }
-
   void gateNavigation(std_msgs::Float64MultiArray array)
   {
     data_X_.data = array.data[0];
     data_Y_.data = array.data[1];
-    present_X_.publish(data_X_);
-    present_Y_.publish(data_Y_);
+
+    if (gate_server_.isActive())
+    {
+      // publish the feedback
+      feedback_.nosignificance = false;
+      gate_server_.publishFeedback(feedback_);
+      ROS_INFO("x = %f, y = %f", data_X_.data, data_Y_.data);
+    }
   }
 
   void lineDetectedListener(std_msgs::Bool msg)
   {
     if (msg.data)
-      isOrange = true;
-    else
-      isOrange = false;
+      events_.post(LINE_SEEN);
   }
 
   void preemptCB(void)
   {
-    // Not actually preempting the goal because Prakhar did it in analysisCB
     ROS_INFO("Called when preempted from the client");
+    // the motion goals are cancelled from here, each motion server zeroes its thrusters in its own preempt callback;
+    // the state machine may be busy with an entry action and only gets to PREEMPT after that
+    cancelMotion();
+    events_.post(PREEMPT);
   }
 
-  void spinThreadUpward()
-  {
-    ClientUpward &tempUpward = UpwardClient_;
-    tempUpward.waitForResult();
-    heightCenter = (*(tempUpward.getResult())).Result;
-    if (heightCenter)
-    {
-      ROS_INFO("Bot is at height center");
-    }
-    else
-    {
-      ROS_INFO("Bot is not at height center, something went wrong");
-    }
-  }
-
-  void spinThreadSideward()
+  void cancelMotion()
   {
-    ClientSideward &tempSideward = SidewardClient_;
-    tempSideward.waitForResult();
-    sideCenter = (*(tempSideward.getResult())).Result;
-    if (sideCenter)
-    {
-      ROS_INFO("Bot is at side center");
-    }
-    else
-    {
-      ROS_INFO("Bot is not at side center, something went wrong");
-    }
+    ForwardClient_.cancelAllGoals();
+    SidewardClient_.cancelAllGoals();
+    UpwardClient_.cancelAllGoals();
+    TurnClient_.cancelAllGoals();
   }
 
   void analysisCB(const task_commons::gateGoalConstPtr goal)
   {
     ROS_INFO("Inside analysisCB");
-    heightCenter = false;
-    sideCenter = false;
-    isOrange = false;
-    success_line = false;
-    success_gate = false;
-    ros::Rate looprate(12);
     if (!gate_server_.isActive())
       return;
+    if (!goal->order)
+    {
+      result_.MotionCompleted = false;
+      gate_server_.setAborted(result_);
+      return;
+    }
 
     ROS_INFO("Waiting for Forward server to start.");
     ForwardClient_.waitForServer();
@@ -161,12 +162,55 @@ public:
     UpwardClient_.waitForServer();
     TurnClient_.waitForServer();
 
+    events_.clear();
+    if (!machine_.run(centering_, &events_))
+      gate_server_.setAborted();
+  }
+
+  // the phases of the task, each waits for the event that ends it instead of polling a flag
+  void declareStates()
+  {
+    using task_commons::succeeded;
+
+    int gate = machine_.addState("gate");
+    centering_ = machine_.addState("centering", gate);
+    int sideAndHeight = machine_.addState("side_and_height", centering_);
+    int heightLeft = machine_.addState("height_left", centering_);
+    int sideLeft = machine_.addState("side_left", centering_);
+    int crossing = machine_.addState("crossing", gate);
+    int done = machine_.addState("succeeded", gate);
+    int preempted = machine_.addState("preempted", gate);
+    machine_.setFinal(done);
+    machine_.setFinal(preempted);
+
+    machine_.addTransition(gate, PREEMPT, preempted);
+
+    machine_.onEntry(centering_, boost::bind(&TaskGateInnerClass::startCentering, this));
+    machine_.addTransition(sideAndHeight, SIDE_DONE, heightLeft, succeeded);
+    machine_.addTransition(sideAndHeight, HEIGHT_DONE, sideLeft, succeeded);
+    machine_.addTransition(heightLeft, HEIGHT_DONE, crossing, succeeded);
+    machine_.addTransition(sideLeft, SIDE_DONE, crossing, succeeded);
+    machine_.addReaction(centering_, SIDE_DONE, boost::bind(&TaskGateInnerClass::centeringFailed, this, "side"));
+    machine_.addReaction(centering_, HEIGHT_DONE, boost::bind(&TaskGateInnerClass::centeringFailed, this, "height"));
+    machine_.onExit(centering_, boost::bind(&TaskGateInnerClass::stopGateDetection, this));
+
+    machine_.onEntry(crossing, boost::bind(&TaskGateInnerClass::startCrossing, this));
+    machine_.addTransition(crossing, LINE_SEEN, done);
+    machine_.onExit(crossing, boost::bind(&TaskGateInnerClass::stopCrossing, this));
+
+    machine_.onEntry(done, boost::bind(&TaskGateInnerClass::succeed, this));
+    machine_.onEntry(preempted, boost::bind(&TaskGateInnerClass::preempt, this));
+  }
+
+  void startCentering()
+  {
     TaskGateInnerClass::startGateDetection();
 
+    // both offsets are read by the motion servers straight off the sensor board
     sidewardgoal.Goal = 0;
     sidewardgoal.loop = 10;
-    SidewardClient_.sendGoal(sidewardgoal);
-    boost::thread spin_thread_sideward(&TaskGateInnerClass::spinThreadSideward, this);
+    sidewardgoal.Source = "gate[0]";
+    SidewardClient_.sendGoal(sidewardgoal, task_commons::ResultEvent(&events_, SIDE_DONE));
 
     // Stabilization of yaw
     turngoal.AngleToTurn = 0;
@@ -175,74 +219,49 @@ public:
 
     upwardgoal.Goal = 0;
     upwardgoal.loop = 10;
-    UpwardClient_.sendGoal(upwardgoal);
-    boost::thread spin_thread_upward(&TaskGateInnerClass::spinThreadUpward, this);
+    upwardgoal.Source = "gate[1]";
+    UpwardClient_.sendGoal(upwardgoal, task_commons::ResultEvent(&events_, HEIGHT_DONE));
+  }
 
-    while (goal->order)
-    {
-      if (gate_server_.isPreemptRequested() || !ros::ok())
-      {
-        ROS_INFO("%s: Preempted", action_name_.c_str());
-        // set the action state to preempted
-        gate_server_.setPreempted();
-        success_gate = false;
-        break;
-      }
-      looprate.sleep();
-      if (heightCenter && sideCenter)
-      {
-        success_gate = true;
-        std_msgs::Float64 init_data;
-        init_data.data = 50;
-        present_distance_.publish(init_data);
-        break;
-      }
-      // publish the feedback
-      feedback_.nosignificance = false;
-      gate_server_.publishFeedback(feedback_);
-      ROS_INFO("x = %f, y = %f", data_X_.data, data_Y_.data);
-      ros::spinOnce();
-    }
+  void centeringFailed(const char *axis)
+  {
+    ROS_INFO("Bot is not at %s center, something went wrong", axis);
+  }
 
+  void startCrossing()
+  {
+    // no camera sees the way through the gate, the forward server counts down from where the goal puts it
     forwardgoal.Goal = 10;
     forwardgoal.loop = 10;
-    ForwardClient_.sendGoal(forwardgoal);  // stop motion here
-    TaskGateInnerClass::stopGateDetection();
-
+    forwardgoal.SetStart = true;
+    forwardgoal.Start = 50;
+    ForwardClient_.sendGoal(forwardgoal);
     TaskGateInnerClass::startLineDetection();
+  }
 
-    while (goal->order)
-    {
-      if (gate_server_.isPreemptRequested() || !ros::ok())
-      {
-        ROS_INFO("%s: Preempted", action_name_.c_str());
-        // set the action state to preempted
-        gate_server_.setPreempted();
-        success_gate = false;
-        break;
-      }
-      looprate.sleep();
-      if (isOrange)
-      {
-        success_line = true;
-        break;
-      }
-      // publish the feedback
-      feedback_.nosignificance = false;
-      gate_server_.publishFeedback(feedback_);
-      ROS_INFO("x = %f, y = %f", data_X_.data, data_Y_.data);
-      ros::spinOnce();
-    }
-
+  void stopCrossing()
+  {
     ForwardClient_.cancelGoal();  // stop motion here
     TaskGateInnerClass::stopLineDetection();
+  }
 
-    result_.MotionCompleted = success_gate && success_line;
+  void succeed()
+  {
+    result_.MotionCompleted = true;
     ROS_INFO("%s: Succeeded", action_name_.c_str());
     // set the action state to succeeded
     gate_server_.setSucceeded(result_);
   }
 
+  void preempt()
+  {
+    ROS_INFO("%s: Preempted", action_name_.c_str());
+    // an entry action that ran after preemptCB may have sent a goal again, the yaw hold for one
+    cancelMotion();
+    // set the action state to preempted
+    gate_server_.setPreempted();
+  }
+
   void startGateDetection()
   {
     std_msgs::Bool msg;
@@ -277,6 +296,6 @@ int main(int argc, char **argv)
   ros::init(argc, argv, "gate_server");
   ROS_INFO("Waiting for Goal");
   TaskGateInnerClass taskGateObject(ros::this_node::getName(), "forward", "sideward", "upward", "turningXY");
-  ros::spin();
+  ros::waitForShutdown();
   return 0;
 }
@@ -0,0 +1,48 @@
+// Copyright 2016 AUV-IITK
+#ifndef TASK_LINE_LINE_ANGLE_PIPELINE_H
+#define TASK_LINE_LINE_ANGLE_PIPELINE_H
+
+#include <task_commons/vision_scheduler.h>
+#include <hardware_commons/sensor_board.h>
+#include <opencv2/core/core.hpp>
+#include <ros/ros.h>
+
+/*! \file
+* \brief Angle of the line below the vehicle
+*
+* Publishes the angle of the orange strip in the bottom camera in degrees on /varun/ip/line_angle. The angle comes
+* from a Hough transform of the largest orange contour and is the one found on the previous frame.
+*/
+namespace task_line
+{
+class LineAnglePipeline : public task_commons::Pipeline
+{
+public:
+  explicit LineAnglePipeline(const ros::NodeHandle &nh);
+
+protected:
+  void process(const cv::Mat &frame);
+
+private:
+  // hough transform of the contour image, updates finalAngle_ and lineCount_
+  void houghLines(const cv::Mat &contours, const cv::Mat &frame);
+
+  ros::NodeHandle nh_;
+  ros::Publisher pub_;
+  // every detection also goes on the sensor board for the nodes on the vehicle
+  hardware_commons::SensorBoard sensorBoard_;
+
+  // parameters in param file should be nearly the same as the defaults, params for an orange strip
+  int t1min_, t1max_, t2min_, t2max_, t3min_, t3max_;
+  // params for hough line transform
+  int lineThresh_;
+  int minLineLength_;
+  int maxLineGap_;
+  double minDeviation_;
+
+  double finalAngle_;
+  int lineCount_;
+};
+}  // namespace task_line
+
+#endif  // TASK_LINE_LINE_ANGLE_PIPELINE_H
@@ -0,0 +1,36 @@
+// Copyright 2016 AUV-IITK
+#ifndef TASK_LINE_LINE_CENTRALIZE_PIPELINE_H
+#define TASK_LINE_LINE_CENTRALIZE_PIPELINE_H
+
+#include <task_commons/vision_scheduler.h>
+#include <hardware_commons/sensor_board.h>
+#include <opencv2/core/core.hpp>
+#include <ros/ros.h>
+
+/*! \file
+* \brief Position of the line below the vehicle
+*
+* Publishes the x and y offset of the centre of mass of the orange strip from the centre of the bottom camera on
+* /varun/ip/line_centralize, 0 0 while nothing is seen.
+*/
+namespace task_line
+{
+class LineCentralizePipeline : public task_commons::Pipeline
+{
+public:
+  explicit LineCentralizePipeline(const ros::NodeHandle &nh);
+
+protected:
+  void process(const cv::Mat &frame);
+
+private:
+  ros::NodeHandle nh_;
+  ros::Publisher pub_;
+  // every detection also goes on the sensor board for the nodes on the vehicle
+  hardware_commons::SensorBoard sensorBoard_;
+
+  int t1min_, t1max_, t2min_, t2max_, t3min_, t3max_;
+};
+}  // namespace task_line
+
+#endif  // TASK_LINE_LINE_CENTRALIZE_PIPELINE_H
@@ -0,0 +1,32 @@
+// Copyright 2016 AUV-IITK
+#ifndef TASK_LINE_LINE_DETECTION_PIPELINE_H
+#define TASK_LINE_LINE_DETECTION_PIPELINE_H
+
+#include <task_commons/vision_scheduler.h>
+#include <opencv2/core/core.hpp>
+#include <ros/ros.h>
+
+/*! \file
+* \brief Tells whether the line is below the vehicle
+*
+* Publishes true on /varun/ip/line_detection once enough of the bottom camera is orange, false otherwise.
+*/
+namespace task_line
+{
+class LineDetectionPipeline : public task_commons::Pipeline
+{
+public:
+  explicit LineDetectionPipeline(const ros::NodeHandle &nh);
+
+protected:
+  void process(const cv::Mat &frame);
+
+private:
+  ros::NodeHandle nh_;
+  ros::Publisher pub_;
+  // used for how much percent of the screen should be orange before deciding that a line is below
+  int percentage_;
+};
+}  // namespace task_line
+
+#endif  // TASK_LINE_LINE_DETECTION_PIPELINE_H
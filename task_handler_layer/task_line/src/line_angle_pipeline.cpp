@@ -0,0 +1,183 @@
+// Copyright 2016 AUV-IITK
+#include <task_line/line_angle_pipeline.h>
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/trace.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "std_msgs/Float64.h"
+#include <cmath>
+#include <vector>
+
+namespace task_line
+{
+namespace
+{
+double computeMean(const std::vector<double> &newAngles)
+{
+  double sum = 0;
+  for (size_t i = 0; i < newAngles.size(); i++)
+  {
+    sum = sum + newAngles[i];
+  }
+  return sum / newAngles.size();
+}
+
+// called when few lines are detected
+// to remove errors due to any stray results
+double computeMode(std::vector<double> *newAngles, double minDeviation)
+{
+  std::vector<double> &angles = *newAngles;
+  double mode = angles[0];
+  int freq = 1;
+  int tempFreq;
+  double diff;
+  for (int i = 0; i < angles.size(); i++)
+  {
+    tempFreq = 1;
+
+    for (int j = i + 1; j < angles.size(); j++)
+    {
+      diff = angles[j] - angles[i] > 0.0 ? angles[j] - angles[i] : angles[i] - angles[j];
+      if (diff <= minDeviation)
+      {
+        tempFreq++;
+        angles.erase(angles.begin() + j);
+        j = j - 1;
+      }
+    }
+
+    if (tempFreq >= freq)
+    {
+      mode = angles[i];
+      freq = tempFreq;
+    }
+  }
+
+  return mode;
+}
+}  // namespace
+
+LineAnglePipeline::LineAnglePipeline(const ros::NodeHandle &nh)
+  : task_commons::Pipeline("line_angle", "/varun/sensors/bottom_camera/image_raw", "line_angle_switch")
+  , nh_(nh)
+  , t1min_(0), t1max_(88), t2min_(89), t2max_(251), t3min_(0), t3max_(255)
+  , lineThresh_(60)
+  , minLineLength_(70)
+  , maxLineGap_(10)
+  , minDeviation_(0.02)
+  , finalAngle_(-1)
+  , lineCount_(0)
+{
+  pub_ = hardware_commons::advertise<std_msgs::Float64>(nh_, "/varun/ip/line_angle", hardware_commons::LATEST);
+  if (!sensorBoard_.open())
+    ROS_ERROR("%s", sensorBoard_.error().c_str());
+
+  trackbar("F1", "t1min", &t1min_, 260);
+  trackbar("F1", "t1max", &t1max_, 260);
+  trackbar("F2", "t2min", &t2min_, 260);
+  trackbar("F2", "t2max", &t2max_, 260);
+  trackbar("F3", "t3min", &t3min_, 260);
+  trackbar("F3", "t3max", &t3max_, 260);
+}
+
+void LineAnglePipeline::houghLines(const cv::Mat &contours, const cv::Mat &frame)
+{
+  std::vector<cv::Vec4i> lines;
+  cv::HoughLinesP(contours, lines, 1, CV_PI / 180, lineThresh_, minLineLength_, maxLineGap_);
+
+  cv::Mat imgLines(frame.size(), frame.type(), cv::Scalar(0, 0, 0));
+  std::vector<double> angles(lines.size());
+
+  lineCount_ = lines.size();
+  int j = 0;
+  for (size_t i = 0; i < lines.size(); i++)
+  {
+    cv::Vec4i l = lines[i];
+    cv::line(imgLines, cv::Point(l[0], l[1]), cv::Point(l[2], l[3]), cv::Scalar(0, 255, 0), 1, CV_AA);
+    if ((l[2] == l[0]) || (l[1] == l[3])) continue;
+    angles[j] = atan(static_cast<double>(l[2] - l[0]) / (l[1] - l[3]));
+    j++;
+  }
+
+  show("LINES", imgLines + frame);
+
+  // if num of lines are large than one or two stray lines won't affect the mean
+  // much
+  // but if they are small in number than mode has to be taken to save the error
+  // due to those stray line
+  if (lines.size() > 0 && lines.size() < 10)
+    finalAngle_ = computeMode(&angles, minDeviation_);
+  else if (lines.size() > 0)
+    finalAngle_ = computeMean(angles);
+}
+
+void LineAnglePipeline::process(const cv::Mat &frame)
+{
+  cv::Mat hsv_frame, thresholded;
+
+  // Covert color space to HSV as it is much easier to filter colors in the HSV color-space.
+  cv::cvtColor(frame, hsv_frame, CV_BGR2HSV);
+  cv::Scalar hsv_min = cv::Scalar(t1min_, t2min_, t3min_, 0);
+  cv::Scalar hsv_max = cv::Scalar(t1max_, t2max_, t3max_, 0);
+  // Filter out colors which are out of range.
+  cv::inRange(hsv_frame, hsv_min, hsv_max, thresholded);
+
+  if (filters())
+  {
+    // Split image into its 3 one dimensional images
+    cv::Mat thresholded_hsv[3];
+    cv::split(hsv_frame, thresholded_hsv);
+    cv::inRange(thresholded_hsv[0], cv::Scalar(t1min_, 0, 0, 0), cv::Scalar(t1max_, 0, 0, 0), thresholded_hsv[0]);
+    cv::inRange(thresholded_hsv[1], cv::Scalar(t2min_, 0, 0, 0), cv::Scalar(t2max_, 0, 0, 0), thresholded_hsv[1]);
+    cv::inRange(thresholded_hsv[2], cv::Scalar(t3min_, 0, 0, 0), cv::Scalar(t3max_, 0, 0, 0), thresholded_hsv[2]);
+    show("F1", thresholded_hsv[0]);  // individual filters
+    show("F2", thresholded_hsv[1]);
+    show("F3", thresholded_hsv[2]);
+  }
+
+  cv::GaussianBlur(thresholded, thresholded, cv::Size(9, 9), 0, 0, 0);
+  show("After Color Filtering", thresholded);  // The stream after color filtering
+
+  // find contours
+  std::vector<std::vector<cv::Point> > contours;
+  cv::findContours(thresholded, contours, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE);  // Find the contours in the image
+  std_msgs::Float64 msg;
+  if (contours.empty())
+  {
+    msg.data = -finalAngle_ * (180 / 3.14) + 90;
+    hardware_commons::trace::publish(pub_, msg);
+    sensorBoard_.write(hardware_commons::LINE_ANGLE, msg.data);
+    return;
+  }
+
+  double largest_area = 0;
+  int largest_contour_index = 0;
+  for (int i = 0; i < contours.size(); i++)  // iterate through each contour.
+  {
+    double a = cv::contourArea(contours[i], false);  //  Find the area of contour
+    if (a > largest_area)
+    {
+      largest_area = a;
+      largest_contour_index = i;  // Store the index of largest contour
+    }
+  }
+
+  cv::Mat Drawing(thresholded.rows, thresholded.cols, CV_8UC1, cv::Scalar::all(0));
+  std::vector<cv::Vec4i> hierarchy;
+  cv::Scalar color(255, 255, 255);
+  cv::drawContours(Drawing, contours, largest_contour_index, color, 2, 8, hierarchy);
+  show("Contours", Drawing);
+
+  /*
+  msg.data never takes positive 90
+  when the angle is 90 it will show -90
+  -------------TO BE CORRECTED-------------
+  */
+  msg.data = -finalAngle_ * (180 / 3.14);
+  if (lineCount_ > 0)
+  {
+    hardware_commons::trace::publish(pub_, msg);
+    sensorBoard_.write(hardware_commons::LINE_ANGLE, msg.data);
+  }
+  houghLines(Drawing, frame);
+}
+}  // namespace task_line
@@ -0,0 +1,100 @@
+// Copyright 2016 AUV-IITK
+#include <task_line/line_centralize_pipeline.h>
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/trace.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <std_msgs/Float64MultiArray.h>
+#include <vector>
+
+namespace task_line
+{
+LineCentralizePipeline::LineCentralizePipeline(const ros::NodeHandle &nh)
+  : task_commons::Pipeline("line_centralize", "/varun/sensors/bottom_camera/image_raw", "line_centralize_switch")
+  , nh_(nh)
+  , t1min_(1), t1max_(25), t2min_(95), t2max_(183), t3min_(195), t3max_(230)
+{
+  pub_ = hardware_commons::advertise<std_msgs::Float64MultiArray>(nh_, "/varun/ip/line_centralize", hardware_commons::LATEST);
+  if (!sensorBoard_.open())
+    ROS_ERROR("%s", sensorBoard_.error().c_str());
+
+  trackbar("F1", "t1min", &t1min_, 260);
+  trackbar("F1", "t1max", &t1max_, 260);
+  trackbar("F2", "t2min", &t2min_, 260);
+  trackbar("F2", "t2max", &t2max_, 260);
+  trackbar("F3", "t3min", &t3min_, 260);
+  trackbar("F3", "t3max", &t3max_, 260);
+}
+
+void LineCentralizePipeline::process(const cv::Mat &frame)
+{
+  std_msgs::Float64MultiArray array;
+  cv::Mat hsv_frame, thresholded;
+
+  // Covert color space to HSV as it is much easier to filter colors in the HSV color-space.
+  cv::cvtColor(frame, hsv_frame, CV_BGR2HSV);
+  cv::Scalar hsv_min = cv::Scalar(t1min_, t2min_, t3min_, 0);
+  cv::Scalar hsv_max = cv::Scalar(t1max_, t2max_, t3max_, 0);
+  // Filter out colors which are out of range.
+  cv::inRange(hsv_frame, hsv_min, hsv_max, thresholded);
+
+  if (filters())
+  {
+    // Split image into its 3 one dimensional images
+    cv::Mat thresholded_hsv[3];
+    cv::split(hsv_frame, thresholded_hsv);
+    cv::inRange(thresholded_hsv[0], cv::Scalar(t1min_, 0, 0, 0), cv::Scalar(t1max_, 0, 0, 0), thresholded_hsv[0]);
+    cv::inRange(thresholded_hsv[1], cv::Scalar(t2min_, 0, 0, 0), cv::Scalar(t2max_, 0, 0, 0), thresholded_hsv[1]);
+    cv::inRange(thresholded_hsv[2], cv::Scalar(t3min_, 0, 0, 0), cv::Scalar(t3max_, 0, 0, 0), thresholded_hsv[2]);
+    show("F1", thresholded_hsv[0]);  // individual filters
+    show("F2", thresholded_hsv[1]);
+    show("F3", thresholded_hsv[2]);
+  }
+
+  cv::GaussianBlur(thresholded, thresholded, cv::Size(9, 9), 0, 0, 0);
+  show("After Color Filtering", thresholded);  // The stream after color filtering
+
+  // find contours
+  std::vector<std::vector<cv::Point> > contours;
+  cv::findContours(thresholded, contours, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE);  // Find the contours
+  if (contours.empty())
+  {
+    array.data.push_back(0);
+    array.data.push_back(0);
+    hardware_commons::trace::publish(pub_, array);
+    sensorBoard_.write(hardware_commons::LINE_CENTRALIZE, array.data.data(), array.data.size());
+    return;
+  }
+
+  double largest_area = 0;
+  int largest_contour_index = 0;
+  for (int i = 0; i < contours.size(); i++)  // iterate through each contour.
+  {
+    double a = cv::contourArea(contours[i], false);  //  Find the area of contour
+    if (a > largest_area)
+    {
+      largest_area = a;
+      largest_contour_index = i;  // Store the index of largest contour
+    }
+  }
+
+  // Convex HULL
+  cv::Mat Drawing(thresholded.rows, thresholded.cols, CV_8UC1, cv::Scalar::all(0));
+  std::vector<std::vector<cv::Point> > hull(1);
+  cv::convexHull(cv::Mat(contours[largest_contour_index]), hull[0], false);
+  cv::Moments mu = cv::moments(hull[0], false);
+  std::vector<cv::Vec4i> hierarchy;
+  cv::Point2f center_of_mass = cv::Point2f(mu.m10 / mu.m00, mu.m01 / mu.m00);
+  cv::drawContours(Drawing, hull, 0, cv::Scalar(255, 255, 255), 2, 8, hierarchy);
+
+  // the frame is shared with the other pipelines of the camera, the overlay goes on a copy
+  cv::Mat com = frame.clone();
+  cv::circle(com, center_of_mass, 5, cv::Scalar(0, 250, 0), -1, 8, 1);
+  show("COM", com);
+  show("Contours", Drawing);
+
+  array.data.push_back((320 - center_of_mass.x));
+  array.data.push_back((240 - center_of_mass.y));
+  hardware_commons::trace::publish(pub_, array);
+  sensorBoard_.write(hardware_commons::LINE_CENTRALIZE, array.data.data(), array.data.size());
+}
+}  // namespace task_line
@@ -6,6 +6,7 @@
 #include <task_commons/lineActionResult.h>
 #include <actionlib/client/simple_action_client.h>
 #include <actionlib/client/terminal_state.h>
+#include <hardware_commons/queue_policy.h>
 
 typedef actionlib::SimpleActionClient<task_commons::lineAction> Client;
 
@@ -14,11 +15,9 @@ task_commons::lineGoal goal;
 
 bool success = false;
 
-void spinThread()
+void doneCb(const actionlib::SimpleClientGoalState &state, const task_commons::lineResultConstPtr &result)
 {
-  Client &temp = *ptrClient;
-  temp.waitForResult();
-  success = (*(temp.getResult())).MotionCompleted;
+  success = result && result->MotionCompleted;
   if (success)
   {
     ROS_INFO("motion successful");
@@ -40,8 +39,8 @@ int main(int argc, char **argv)
 
   ros::NodeHandle nh;
   // here line_server is the name of the node of the actionserver.
-  ros::Subscriber sub_ =
-      nh.subscribe<task_commons::lineActionFeedback>("/line_server/feedback", 1000, &forwardCb);
+  ros::Subscriber sub_ = hardware_commons::subscribe<task_commons::lineActionFeedback>(
+      nh, "/line_server/feedback", hardware_commons::EVENTS, &forwardCb);
 
   Client testClient("line_server");
   ptrClient = &testClient;
@@ -56,8 +55,7 @@ int main(int argc, char **argv)
   // ROS_INFO("Goal Cancelled");
   Client &can = *ptrClient;
   // send goal
-  can.sendGoal(goal);
-  boost::thread spin_thread(&spinThread);
+  can.sendGoal(goal, &doneCb);
   ros::spin();
   return 0;
 }
@@ -0,0 +1,42 @@
+// Copyright 2016 AUV-IITK
+#include <task_line/line_detection_pipeline.h>
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/trace.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <std_msgs/Bool.h>
+
+namespace task_line
+{
+LineDetectionPipeline::LineDetectionPipeline(const ros::NodeHandle &nh)
+  : task_commons::Pipeline("line_detection", "/varun/sensors/bottom_camera/image_raw", "line_detection_switch")
+  , nh_(nh)
+  , percentage_(5)
+{
+  pub_ = hardware_commons::advertise<std_msgs::Bool>(nh_, "/varun/ip/line_detection", hardware_commons::LATEST);
+  trackbar("red_hue_image", "percentage", &percentage_, 100);
+}
+
+void LineDetectionPipeline::process(const cv::Mat &frame)
+{
+  cv::Size size(640, 480);  // the dst image size,e.g.100x100
+  cv::Mat resizeimage;      // dst image
+  cv::Mat bgr_image;
+  cv::resize(frame, resizeimage, size);  // resize image
+  // detect red color here
+  cv::medianBlur(resizeimage, bgr_image, 3);  // blur to reduce noise
+  // Convert input image to HSV
+  cv::Mat hsv_image;
+  cv::cvtColor(bgr_image, hsv_image, cv::COLOR_BGR2HSV);
+  // keep only red color
+  cv::Mat red_hue_image;
+  cv::inRange(hsv_image, cv::Scalar(0, 100, 100), cv::Scalar(179, 255, 255), red_hue_image);
+  cv::GaussianBlur(red_hue_image, red_hue_image, cv::Size(9, 9), 2, 2);  // gaussian blur to remove false positives
+  show("red_hue_image", red_hue_image);
+
+  // a major portion of the image has red color, Note : here the size of image is 640X480 = 307200.
+  std_msgs::Bool msg;
+  msg.data = cv::countNonZero(red_hue_image) > 3072 * percentage_;
+  hardware_commons::trace::publish(pub_, msg);
+  ROS_INFO("%s", msg.data ? "found line" : "no line");
+}
+}  // namespace task_line
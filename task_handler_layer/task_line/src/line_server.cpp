@@ -4,10 +4,10 @@
 #include <std_msgs/Float32.h>
 #include <std_msgs/Int32.h>
 #include <std_msgs/String.h>
-#include <std_msgs/Float64MultiArray.h>
 #include <std_msgs/Bool.h>
 #include <actionlib/server/simple_action_server.h>
 #include <actionlib/client/simple_action_client.h>
+#include <motion_commons/callback_group.h>
 #include <actionlib/client/terminal_state.h>
 #include <task_commons/lineAction.h>
 #include <motion_commons/ForwardAction.h>
@@ -19,6 +19,9 @@
 #include <motion_commons/SidewardActionResult.h>
 #include <motion_commons/ForwardActionResult.h>
 #include <motion_commons/TurnActionResult.h>
+#include <task_commons/state_machine.h>
+#include <hardware_commons/queue_policy.h>
+#include <boost/thread/mutex.hpp>
 #include <string>
 
 typedef actionlib::SimpleActionServer<task_commons::lineAction> Server;
@@ -26,62 +29,79 @@ typedef actionlib::SimpleActionClient<motion_commons::ForwardAction> Client_Forw
 typedef actionlib::SimpleActionClient<motion_commons::SidewardAction> Client_Sideward;
 typedef actionlib::SimpleActionClient<motion_commons::TurnAction> Client_Turn;
 
+enum LineEvent
+{
+  PREEMPT,
+  LINE_SEEN,   // the detector found the orange line under the bot
+  SIDE_DONE,   // sideward goal finished, value is its Result
+  FRONT_DONE,  // forward goal finished
+  TURN_DONE    // turn goal finished
+};
+
 class TaskLineInnerClass
 {
 private:
+  // detector data, results of the motion goals, and goals and preempts of this server each have their own threads;
+  // the state machine runs on the action server's thread and only waits for its event queue
+  motion_commons::CallbackGroup sensors_;
+  motion_commons::CallbackGroup control_;
+  motion_commons::CallbackGroup action_;
   ros::NodeHandle nh_;
   Server line_server_;
   std::string action_name_;
   task_commons::lineFeedback feedback_;
   task_commons::lineResult result_;
   ros::Subscriber detection_data;
-  ros::Subscriber yaw_sub;
-  ros::Subscriber centralize_data;
   ros::Subscriber angle_data;
   ros::Publisher switch_centralize;
   ros::Publisher switch_angle;
   ros::Publisher switch_detection;
-  ros::Publisher present_X_;
-  ros::Publisher present_Y_;
-  ros::Publisher yaw_pub_;
   Client_Forward ForwardClient_;
   Client_Sideward SidewardClient_;
   Client_Turn TurnClient_;
   motion_commons::ForwardGoal forwardgoal;
   motion_commons::SidewardGoal sidewardgoal;
   motion_commons::TurnGoal turngoal;
-  std_msgs::Float64 data_X_;
-  std_msgs::Float64 data_Y_;
   std_msgs::Float64 angle_goal;
-  bool isOrange, success, FrontCenter, SideCenter, LineAlign;
+  boost::mutex angleMutex_;  // angle_goal is written on the sensor thread and read by the state machine
+  task_commons::StateMachine machine_;
+  task_commons::EventQueue events_;
+  int searching_;
 
 public:
   TaskLineInnerClass(std::string name, std::string node, std::string node1,
                      std::string node2)
-    :  // here we are defining the server, third argument is optional
-    line_server_(nh_, name, boost::bind(&TaskLineInnerClass::analysisCB, this, _1), false)
+    : sensors_("sensor")
+    , control_("control")
+    , action_("action")
+    , line_server_(action_.nodeHandle(), name, boost::bind(&TaskLineInnerClass::analysisCB, this, _1), false)
     , action_name_(name)
-    , ForwardClient_(node)
-    , TurnClient_(node1)
-    , SidewardClient_(node2)
+    , ForwardClient_(control_.nodeHandle(), node, false)
+    , TurnClient_(control_.nodeHandle(), node1, false)
+    , SidewardClient_(control_.nodeHandle(), node2, false)
+    , machine_(name)
+    , events_(name + "/events")
   {
     ROS_INFO("inside constructor");
+    declareStates();
     line_server_.registerPreemptCallback(boost::bind(&TaskLineInnerClass::preemptCB, this));
-    present_X_ = nh_.advertise<std_msgs::Float64>("/varun/motion/y_distance", 1000);
-    present_Y_ = nh_.advertise<std_msgs::Float64>("/varun/motion/x_distance", 1000);
-    switch_detection = nh_.advertise<std_msgs::Bool>("line_detection_switch", 1000);
-    switch_angle = nh_.advertise<std_msgs::Bool>("line_angle_switch", 1000);
-    switch_centralize = nh_.advertise<std_msgs::Bool>("line_centralize_switch", 1000);
-    yaw_pub_ = nh_.advertise<std_msgs::Float64>("/varun/motion/yaw", 1000);
-
-    detection_data = nh_.subscribe<std_msgs::Bool>("/varun/ip/line_detection", 1000,
-                                                   &TaskLineInnerClass::lineDetectedListener, this);
-    yaw_sub = nh_.subscribe<std_msgs::Float64>("/varun/sensors/imu/yaw", 1000, &TaskLineInnerClass::yawCB, this);
-    centralize_data = nh_.subscribe<std_msgs::Float64MultiArray>("/varun/ip/line_centralize", 1000,
-                                                                 &TaskLineInnerClass::lineCentralizeListener, this);
-    angle_data =
-        nh_.subscribe<std_msgs::Float64>("/varun/ip/line_angle", 1000, &TaskLineInnerClass::lineAngleListener, this);
-
+    switch_detection =
+        hardware_commons::advertise<std_msgs::Bool>(nh_, "line_detection_switch", hardware_commons::EVENTS);
+    switch_angle = hardware_commons::advertise<std_msgs::Bool>(nh_, "line_angle_switch", hardware_commons::EVENTS);
+    switch_centralize =
+        hardware_commons::advertise<std_msgs::Bool>(nh_, "line_centralize_switch", hardware_commons::EVENTS);
+
+    // a sighting becomes an event, the next frame not seeing the line must not take its place
+    detection_data = hardware_commons::subscribe<std_msgs::Bool>(sensors_.nodeHandle(), "/varun/ip/line_detection",
+                                                                 hardware_commons::EVENTS,
+                                                                 &TaskLineInnerClass::lineDetectedListener, this);
+    angle_data = hardware_commons::subscribe<std_msgs::Float64>(sensors_.nodeHandle(), "/varun/ip/line_angle",
+                                                                hardware_commons::LATEST,
+                                                                &TaskLineInnerClass::lineAngleListener, this);
+
+    sensors_.start();
+    control_.start();
+    action_.start();
     line_server_.start();
   }
 
@@ -89,99 +109,116 @@ public:
   {
   }
 
-  void yawCB(std_msgs::Float64 imu_data)
-  {
-    yaw_pub_.publish(imu_data);
-  }
-
   void lineDetectedListener(std_msgs::Bool msg)
   {
     if (msg.data)
-      isOrange = true;
-    else
-      isOrange = false;
-  }
-
-  void lineCentralizeListener(std_msgs::Float64MultiArray array)
-  {
-    data_X_.data = array.data[0];
-    data_Y_.data = array.data[1];
-    present_X_.publish(data_X_);
-    present_Y_.publish(data_Y_);
+      events_.post(LINE_SEEN);
   }
 
   void lineAngleListener(std_msgs::Float64 msg)
   {
-    angle_goal.data = msg.data;
-  }
-
-  void spinThreadSidewardCamera()
-  {
-    Client_Sideward &tempSideward = SidewardClient_;
-    tempSideward.waitForResult();
-    SideCenter = (*(tempSideward.getResult())).Result;
-    if (SideCenter)
-    {
-      ROS_INFO("Bot is at side center");
-    }
-    else
     {
-      ROS_INFO("Bot is not at side center, something went wrong");
-      ros::shutdown();
+      boost::mutex::scoped_lock lock(angleMutex_);
+      angle_goal.data = msg.data;
     }
-  }
 
-  void spinThreadForwardCamera()
-  {
-    Client_Forward &tempForward = ForwardClient_;
-    tempForward.waitForResult();
-    FrontCenter = (*(tempForward.getResult())).Result;
-    if (FrontCenter)
+    if (line_server_.isActive())
     {
-      ROS_INFO("Bot is at Front center");
-    }
-    else
-    {
-      ROS_INFO("Bot is not at Front center, something went wrong");
-      ros::shutdown();
+      // publish the feedback
+      feedback_.AngleRemaining = msg.data;
+      line_server_.publishFeedback(feedback_);
+      ROS_INFO("angle remaining = %f", msg.data);
     }
   }
 
-  void spinThreadTurnCamera()
+  void preemptCB(void)
   {
-    Client_Turn &tempTurn = TurnClient_;
-    tempTurn.waitForResult();
-    LineAlign = (*(tempTurn.getResult())).Result;
-    if (LineAlign)
-    {
-      ROS_INFO("Bot is at side center");
-    }
+    ROS_INFO("Called when preempted from the client");
+    // the motion goals are cancelled from here, each motion server zeroes its thrusters in its own preempt callback;
+    // the state machine may be busy with an entry action and only gets to PREEMPT after that
+    cancelMotion();
+    events_.post(PREEMPT);
   }
 
-  void preemptCB(void)
+  void cancelMotion()
   {
-    // Not actually preempting the goal because Shibhansh did it in analysisCB
-    ROS_INFO("Called when preempted from the client");
+    ForwardClient_.cancelAllGoals();
+    SidewardClient_.cancelAllGoals();
+    TurnClient_.cancelAllGoals();
   }
 
   void analysisCB(const task_commons::lineGoalConstPtr goal)
   {
     ROS_INFO("Inside analysisCB");
-    success = true;
-    isOrange = false;
-    LineAlign = false;
-    FrontCenter = false;
-    SideCenter = false;
-    ros::Rate looprate(12);
-
     if (!line_server_.isActive())
       return;
+    if (!goal->order)
+    {
+      result_.MotionCompleted = false;
+      line_server_.setAborted(result_);
+      return;
+    }
 
     ROS_INFO("Waiting for Forward server to start.");
     ForwardClient_.waitForServer();
     SidewardClient_.waitForServer();
     TurnClient_.waitForServer();
 
+    events_.clear();
+    if (!machine_.run(searching_, &events_))
+      line_server_.setAborted();
+  }
+
+  // the phases of the task, each waits for the event that ends it instead of polling a flag
+  void declareStates()
+  {
+    using task_commons::succeeded;
+
+    int line = machine_.addState("line");
+    searching_ = machine_.addState("searching", line);
+    int centralizing = machine_.addState("centralizing", line);
+    int frontAndSide = machine_.addState("front_and_side", centralizing);
+    int sideLeft = machine_.addState("side_left", centralizing);
+    int frontLeft = machine_.addState("front_left", centralizing);
+    int aligning = machine_.addState("aligning", line);
+    int turning = machine_.addState("turning", aligning);
+    int done = machine_.addState("succeeded", line);
+    int preempted = machine_.addState("preempted", line);
+    int failed = machine_.addState("failed", line);
+    machine_.setFinal(done);
+    machine_.setFinal(preempted);
+    machine_.setFinal(failed);
+
+    machine_.addTransition(line, PREEMPT, preempted);
+
+    machine_.onEntry(searching_, boost::bind(&TaskLineInnerClass::startSearching, this));
+    machine_.addTransition(searching_, LINE_SEEN, centralizing);
+    machine_.onExit(searching_, boost::bind(&TaskLineInnerClass::stopSearching, this));
+
+    machine_.onEntry(centralizing, boost::bind(&TaskLineInnerClass::startCentralizing, this));
+    machine_.addTransition(frontAndSide, FRONT_DONE, sideLeft, succeeded);
+    machine_.addTransition(frontAndSide, SIDE_DONE, frontLeft, succeeded);
+    machine_.addTransition(sideLeft, SIDE_DONE, aligning, succeeded);
+    machine_.addTransition(frontLeft, FRONT_DONE, aligning, succeeded);
+    // a motion server that gave up leaves the bot off the line, there is no point in aligning
+    machine_.addTransition(centralizing, FRONT_DONE, failed);
+    machine_.addTransition(centralizing, SIDE_DONE, failed);
+    machine_.onExit(centralizing, boost::bind(&TaskLineInnerClass::centralize_switch_off, this));
+
+    machine_.onEntry(aligning, boost::bind(&TaskLineInnerClass::startAligning, this));
+    machine_.onEntry(turning, boost::bind(&TaskLineInnerClass::sendAngleGoal, this));
+    machine_.addTransition(turning, TURN_DONE, done, boost::bind(&TaskLineInnerClass::aligned, this, _1));
+    // not there yet or the turn failed, turn by what the detector sees now
+    machine_.addTransition(turning, TURN_DONE, turning);
+    machine_.onExit(aligning, boost::bind(&TaskLineInnerClass::angle_switch_off, this));
+
+    machine_.onEntry(done, boost::bind(&TaskLineInnerClass::succeed, this));
+    machine_.onEntry(preempted, boost::bind(&TaskLineInnerClass::preempt, this));
+    machine_.onEntry(failed, boost::bind(&TaskLineInnerClass::fail, this));
+  }
+
+  void startSearching()
+  {
     TaskLineInnerClass::detection_switch_on();
 
     // Stabilization of yaw
@@ -192,124 +229,83 @@ public:
     // send initial data to forward.
     forwardgoal.Goal = 100;
     forwardgoal.loop = 10;
+    forwardgoal.Source = "";
     ForwardClient_.sendGoal(forwardgoal);
+    ROS_INFO("searching line");
+  }
 
-    while (goal->order)
-    {
-      if (line_server_.isPreemptRequested() || !ros::ok())
-      {
-        ROS_INFO("%s: Preempted", action_name_.c_str());
-        // set the action state to preempted
-        line_server_.setPreempted();
-        success = false;
-        break;
-      }
-      looprate.sleep();
-
-      if (isOrange)
-      {
-        // stop will happen outside while loop so if preempted then too it will
-        // stop
-        break;
-      }
-      // publish the feedback
-
-      feedback_.AngleRemaining = angle_goal.data;
-      line_server_.publishFeedback(feedback_);
-      ROS_INFO("searching line");
-      ros::spinOnce();
-    }
-
+  void stopSearching()
+  {
     ForwardClient_.cancelGoal();  // stop motion here
     TaskLineInnerClass::detection_switch_off();
+  }
 
+  void startCentralizing()
+  {
     TaskLineInnerClass::centralize_switch_on();
 
+    // the motion servers track the offsets of the line straight off the sensor board
     sidewardgoal.Goal = 0;
     sidewardgoal.loop = 10;
-    SidewardClient_.sendGoal(sidewardgoal);
-    boost::thread spin_thread_sideward_camera(&TaskLineInnerClass::spinThreadSidewardCamera, this);
+    sidewardgoal.Source = "line_centralize[0]";
+    SidewardClient_.sendGoal(sidewardgoal, task_commons::ResultEvent(&events_, SIDE_DONE));
 
     forwardgoal.Goal = 0;
     forwardgoal.loop = 10;
-    ForwardClient_.sendGoal(forwardgoal);
-    boost::thread spin_thread_forward_camera(&TaskLineInnerClass::spinThreadForwardCamera, this);
-
-    while (goal->order)
-    {
-      if (line_server_.isPreemptRequested() || !ros::ok())
-      {
-        ROS_INFO("%s: Preempted", action_name_.c_str());
-        // set the action state to preempted
-        line_server_.setPreempted();
-        success = false;
-        break;
-      }
-      looprate.sleep();
-      if (FrontCenter && SideCenter)
-      {
-        ROS_INFO("Line has been centralized.");
-        break;
-      }
-      // publish the feedback
-      feedback_.AngleRemaining = angle_goal.data;
-      line_server_.publishFeedback(feedback_);
-      ROS_INFO("x = %f, y = %f", data_X_.data, data_Y_.data);
-      ros::spinOnce();
-    }
-
-    TaskLineInnerClass::centralize_switch_off();
+    forwardgoal.Source = "line_centralize[1]";
+    ForwardClient_.sendGoal(forwardgoal, task_commons::ResultEvent(&events_, FRONT_DONE));
+  }
 
+  void startAligning()
+  {
+    ROS_INFO("Line has been centralized.");
     TaskLineInnerClass::angle_switch_on();
-
     TurnClient_.cancelGoal();  // stopped stablisation
+  }
 
-    turngoal.AngleToTurn = angle_goal.data;
+  void sendAngleGoal()
+  {
+    turngoal.AngleToTurn = lineAngle();
+    ROS_INFO("sending the angle goal %f", turngoal.AngleToTurn);
     turngoal.loop = 10;
-    TurnClient_.sendGoal(turngoal);
-    boost::thread spin_thread_turn_camera(&TaskLineInnerClass::spinThreadTurnCamera, this);
+    TurnClient_.sendGoal(turngoal, task_commons::ResultEvent(&events_, TURN_DONE));
+  }
 
-    while (goal->order)
-    {
-      if (line_server_.isPreemptRequested() || !ros::ok())
-      {
-        ROS_INFO("%s: Preempted", action_name_.c_str());
-        // set the action state to preempted
-        line_server_.setPreempted();
-        success = false;
-        break;
-      }
-      looprate.sleep();
-      if (LineAlign)
-      {
-        if (angle_goal.data <= 5.0 && angle_goal.data >= -5.0)
-        {
-          ROS_INFO("line is aligned.");
-          break;
-        }
-        else
-        {
-          ROS_INFO("resending the angle goal.");
-          turngoal.AngleToTurn = angle_goal.data;
-          turngoal.loop = 10;
-          TurnClient_.sendGoal(turngoal);
-        }
-      }
-      // publish the feedback
-      feedback_.AngleRemaining = angle_goal.data;
-      line_server_.publishFeedback(feedback_);
-      ROS_INFO("angle remaining = %f", angle_goal.data);
-      ros::spinOnce();
-    }
+  bool aligned(const task_commons::Event &event)
+  {
+    double angle = lineAngle();
+    return task_commons::succeeded(event) && angle <= 5.0 && angle >= -5.0;
+  }
 
-    if (success)
-    {
-      isOrange = false;
-      result_.MotionCompleted = success;
-      ROS_INFO("%s: Succeeded", action_name_.c_str());
-      // set the action state to succeeded
-      line_server_.setSucceeded(result_);
-    }
+  double lineAngle()
+  {
+    boost::mutex::scoped_lock lock(angleMutex_);
+    return angle_goal.data;
+  }
+
+  void succeed()
+  {
+    ROS_INFO("line is aligned.");
+    result_.MotionCompleted = true;
+    ROS_INFO("%s: Succeeded", action_name_.c_str());
+    // set the action state to succeeded
+    line_server_.setSucceeded(result_);
+  }
+
+  void preempt()
+  {
+    ROS_INFO("%s: Preempted", action_name_.c_str());
+    // an entry action that ran after preemptCB may have sent a goal again, the yaw hold for one
+    cancelMotion();
+    // set the action state to preempted
+    line_server_.setPreempted();
+  }
+
+  void fail()
+  {
+    ROS_INFO("Bot is not at line center, something went wrong");
+    result_.MotionCompleted = false;
+    line_server_.setAborted(result_);
   }
 
   void detection_switch_on()
@@ -365,6 +361,6 @@ int main(int argc, char **argv)
   TaskLineInnerClass taskLineObject(ros::this_node::getName(), "forward", "turningXY", "sideward");
   // ROS_INFO("Waiting for master command");
 
-  ros::spin();
+  ros::waitForShutdown();
   return 0;
 }
@@ -0,0 +1,41 @@
+// Copyright 2016 AUV-IITK
+#ifndef TASK_TORPEDO_TORPEDO_PIPELINE_H
+#define TASK_TORPEDO_TORPEDO_PIPELINE_H
+
+#include <task_commons/vision_scheduler.h>
+#include <dynamic_reconfigure/server.h>
+#include <task_torpedo/torpedoConfig.h>
+#include <hardware_commons/sensor_board.h>
+#include <opencv2/core/core.hpp>
+#include <ros/ros.h>
+
+/*! \file
+* \brief Finds the torpedo target in the front camera
+*
+* Publishes the x and y offset of the centre of the target from the centre of the screen and the width of its
+* bounding box on /varun/ip/torpedo, 0 0 while nothing is seen.
+*/
+namespace task_torpedo
+{
+class TorpedoPipeline : public task_commons::Pipeline
+{
+public:
+  explicit TorpedoPipeline(const ros::NodeHandle &nh);
+
+protected:
+  void process(const cv::Mat &frame);
+
+private:
+  void callback(task_torpedo::torpedoConfig &config, uint32_t level);
+
+  ros::NodeHandle nh_;
+  ros::Publisher pub_;
+  // every detection also goes on the sensor board for the nodes on the vehicle
+  hardware_commons::SensorBoard sensorBoard_;
+  dynamic_reconfigure::Server<task_torpedo::torpedoConfig> server_;
+
+  int t1min_, t1max_, t2min_, t2max_, t3min_, t3max_;
+};
+}  // namespace task_torpedo
+
+#endif  // TASK_TORPEDO_TORPEDO_PIPELINE_H
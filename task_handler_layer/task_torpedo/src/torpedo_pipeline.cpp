@@ -0,0 +1,127 @@
+// Copyright 2016 AUV-IITK
+#include <task_torpedo/torpedo_pipeline.h>
+#include <hardware_commons/queue_policy.h>
+#include <hardware_commons/trace.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "std_msgs/Float64MultiArray.h"
+#include <boost/bind.hpp>
+#include <cstdlib>
+#include <vector>
+
+namespace task_torpedo
+{
+TorpedoPipeline::TorpedoPipeline(const ros::NodeHandle &nh)
+  : task_commons::Pipeline("torpedo_detection", "/varun/sensors/front_camera/image_raw", "torpedo_detection_switch")
+  , nh_(nh)
+  , server_(ros::NodeHandle(nh_, "torpedo_detection"))
+  , t1min_(0), t1max_(0), t2min_(0), t2max_(0), t3min_(0), t3max_(0)
+{
+  pub_ = hardware_commons::advertise<std_msgs::Float64MultiArray>(nh_, "/varun/ip/torpedo", hardware_commons::LATEST);
+  if (!sensorBoard_.open())
+    ROS_ERROR("%s", sensorBoard_.error().c_str());
+
+  nh_.getParam("torpedo_detection/t1maxParam", t1max_);
+  nh_.getParam("torpedo_detection/t1minParam", t1min_);
+  nh_.getParam("torpedo_detection/t2maxParam", t2max_);
+  nh_.getParam("torpedo_detection/t2minParam", t2min_);
+  nh_.getParam("torpedo_detection/t3maxParam", t3max_);
+  nh_.getParam("torpedo_detection/t3minParam", t3min_);
+
+  server_.setCallback(boost::bind(&TorpedoPipeline::callback, this, _1, _2));
+}
+
+void TorpedoPipeline::callback(task_torpedo::torpedoConfig &config, uint32_t level)
+{
+  t1min_ = config.t1min_param;
+  t1max_ = config.t1max_param;
+  t2min_ = config.t2min_param;
+  t2max_ = config.t2max_param;
+  t3min_ = config.t3min_param;
+  t3max_ = config.t3max_param;
+  ROS_INFO("Reconfigure Request : New parameters : %d %d %d %d %d %d ", t1min_, t1max_, t2min_, t2max_, t3min_, t3max_);
+}
+
+void TorpedoPipeline::process(const cv::Mat &frame)
+{
+  std_msgs::Float64MultiArray array;
+  cv::Mat hsv_frame, thresholded;
+
+  // Covert color space to HSV as it is much easier to filter colors in the HSV color-space.
+  cv::cvtColor(frame, hsv_frame, CV_BGR2HSV);
+  cv::Scalar hsv_min = cv::Scalar(t1min_, t2min_, t3min_, 0);
+  cv::Scalar hsv_max = cv::Scalar(t1max_, t2max_, t3max_, 0);
+  // Filter out colors which are out of range.
+  cv::inRange(hsv_frame, hsv_min, hsv_max, thresholded);
+
+  if (filters())
+  {
+    // Split image into its 3 one dimensional images
+    cv::Mat thresholded_hsv[3];
+    cv::split(hsv_frame, thresholded_hsv);
+    cv::inRange(thresholded_hsv[0], cv::Scalar(t1min_, 0, 0, 0), cv::Scalar(t1max_, 0, 0, 0), thresholded_hsv[0]);
+    cv::inRange(thresholded_hsv[1], cv::Scalar(t2min_, 0, 0, 0), cv::Scalar(t2max_, 0, 0, 0), thresholded_hsv[1]);
+    cv::inRange(thresholded_hsv[2], cv::Scalar(t3min_, 0, 0, 0), cv::Scalar(t3max_, 0, 0, 0), thresholded_hsv[2]);
+    show("F1", thresholded_hsv[0]);  // individual filters
+    show("F2", thresholded_hsv[1]);
+    show("F3", thresholded_hsv[2]);
+  }
+
+  cv::GaussianBlur(thresholded, thresholded, cv::Size(9, 9), 0, 0, 0);
+  show("After Color Filtering", thresholded);  // The stream after color filtering
+
+  // find contours
+  std::vector<std::vector<cv::Point> > contours;
+  cv::findContours(thresholded, contours, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE);  // Find the contours in the image
+  if (contours.empty())
+  {
+    array.data.push_back(0);
+    array.data.push_back(0);
+    hardware_commons::trace::publish(pub_, array);
+    sensorBoard_.write(hardware_commons::TORPEDO, array.data.data(), array.data.size());
+    return;
+  }
+
+  double largest_area = 0;
+  int largest_contour_index = 0;
+  for (int i = 0; i < contours.size(); i++)  // iterate through each contour.
+  {
+    double a = cv::contourArea(contours[i], false);  //  Find the area of contour
+    if (a > largest_area)
+    {
+      largest_area = a;
+      largest_contour_index = i;  // Store the index of largest contour
+    }
+  }
+
+  cv::Mat Drawing(thresholded.rows, thresholded.cols, CV_8UC1, cv::Scalar::all(0));
+  std::vector<cv::Vec4i> hierarchy;
+  cv::Scalar color(255, 255, 255);
+  cv::Rect boundRect = cv::boundingRect(cv::Mat(contours[largest_contour_index]));
+  cv::rectangle(Drawing, boundRect.tl(), boundRect.br(), color, 2, 8, 0);
+
+  cv::Point center;
+  center.x = (boundRect.br().x + boundRect.tl().x) / 2;
+  center.y = (boundRect.tl().y + boundRect.br().y) / 2;
+
+  cv::drawContours(Drawing, contours, largest_contour_index, color, 2, 8, hierarchy);
+
+  // the frame is shared with the other pipelines of the camera, the overlay goes on a copy
+  cv::Mat frame_mat = frame.clone();
+  cv::Point2f screen_center;
+  screen_center.x = 320;  // size of my screen
+  screen_center.y = 240;
+
+  cv::circle(frame_mat, center, 5, cv::Scalar(0, 250, 0), -1, 8, 1);
+  cv::rectangle(frame_mat, boundRect.tl(), boundRect.br(), color, 2, 8, 0);
+  cv::circle(frame_mat, screen_center, 4, cv::Scalar(150, 150, 150), -1, 8, 0);  // center of screen
+
+  show("Contours", Drawing);
+  show("RealPic", frame_mat);
+
+  array.data.push_back((320 - center.x));
+  array.data.push_back(-(240 - center.y));
+  array.data.push_back(std::abs(boundRect.br().x - boundRect.tl().x));  // width of the target
+  hardware_commons::trace::publish(pub_, array);
+  sensorBoard_.write(hardware_commons::TORPEDO, array.data.data(), array.data.size());
+}
+}  // namespace task_torpedo
@@ -0,0 +1,28 @@
+// Copyright 2016 AUV-IITK
+#include <ros/ros.h>
+#include <task_commons/vision_scheduler.h>
+#include <task_buoy/buoy_pipeline.h>
+#include <task_gate/gate_pipeline.h>
+#include <task_line/line_angle_pipeline.h>
+#include <task_line/line_centralize_pipeline.h>
+#include <task_line/line_detection_pipeline.h>
+#include <task_torpedo/torpedo_pipeline.h>
+#include <boost/shared_ptr.hpp>
+
+// every detector of the vehicle in one process; all of them start idle and only the ones a task server switches on
+// subscribe to their camera and get time on the pool
+int main(int argc, char *argv[])
+{
+  ros::init(argc, argv, "vision_scheduler");
+  ros::NodeHandle n;
+
+  task_commons::VisionScheduler scheduler(n);
+  scheduler.add(boost::shared_ptr<task_commons::Pipeline>(new task_buoy::BuoyPipeline(n)));
+  scheduler.add(boost::shared_ptr<task_commons::Pipeline>(new task_gate::GatePipeline(n)));
+  scheduler.add(boost::shared_ptr<task_commons::Pipeline>(new task_torpedo::TorpedoPipeline(n)));
+  scheduler.add(boost::shared_ptr<task_commons::Pipeline>(new task_line::LineDetectionPipeline(n)));
+  scheduler.add(boost::shared_ptr<task_commons::Pipeline>(new task_line::LineAnglePipeline(n)));
+  scheduler.add(boost::shared_ptr<task_commons::Pipeline>(new task_line::LineCentralizePipeline(n)));
+  scheduler.spin();
+  return 0;
+}
@@ -10,6 +10,10 @@
   # build action lib header files
   catkin_make --pkg motion_commons &&
   catkin_make --pkg task_commons &&
+  catkin_make roslint_task_commons &&
+  # sensor board used by the hardware, motion and task nodes
+  catkin_make --pkg hardware_commons &&
+  catkin_make roslint_hardware_commons &&
   # building rest of the pkgs and lint checking
   # motion library
   catkin_make --pkg motion_forward &&
@@ -27,6 +31,11 @@
   catkin_make roslint_task_gate &&
   catkin_make --pkg task_line &&
   catkin_make roslint_task_line &&
+  catkin_make --pkg task_torpedo &&
+  catkin_make roslint_task_torpedo &&
+  # detectors of all the task packages in one node
+  catkin_make --pkg task_vision &&
+  catkin_make roslint_task_vision &&
   # build master layer
   catkin_make --pkg the_master &&
   catkin_make roslint_the_master &&